@@ -5,6 +5,15 @@
 #include "path.h"
 #include <iostream>
 
+#ifdef CHOWDREN_ASSET_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define ASSET_FILENAME "./Assets.dat"
+
 static bool assets_initialized = false;
 
 static unsigned int image_offsets[IMAGE_ARRAY_SIZE];
@@ -12,13 +21,15 @@ static unsigned int sound_offsets[SOUND_ARRAY_SIZE];
 static unsigned int font_offsets[FONT_ARRAY_SIZE];
 static unsigned int shader_offsets[SHADER_ARRAY_SIZE];
 static unsigned int file_offsets[FILE_ARRAY_SIZE];
+static unsigned int atlas_offsets[ATLAS_ARRAY_SIZE];
 
 static unsigned int * asset_offsets[] = {
     image_offsets,
     sound_offsets,
     font_offsets,
     shader_offsets,
-    file_offsets
+    file_offsets,
+    atlas_offsets
 };
 
 void read_offsets(FileStream & stream, int count, unsigned int * array)
@@ -42,6 +53,7 @@ void init_assets(FSFile & fp)
     read_offsets(stream, FONT_COUNT, font_offsets);
     read_offsets(stream, SHADER_COUNT, shader_offsets);
     read_offsets(stream, FILE_COUNT, file_offsets);
+    read_offsets(stream, ATLAS_COUNT, atlas_offsets);
 }
 
 // AssetFile
@@ -51,9 +63,61 @@ AssetFile::AssetFile()
 {
 }
 
+#ifdef CHOWDREN_ASSET_MMAP
+
+// the mapping is shared by all AssetFile instances and lives until exit.
+// pages are only read in when an asset is accessed
+static const unsigned char * asset_map = NULL;
+static size_t asset_map_size = 0;
+
+static void map_assets()
+{
+    static bool mapped = false;
+    if (mapped)
+        return;
+    mapped = true;
+
+    int fd = ::open(ASSET_FILENAME, O_RDONLY);
+    if (fd == -1)
+        return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void * data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            asset_map = (const unsigned char*)data;
+            asset_map_size = st.st_size;
+        }
+    }
+    ::close(fd);
+}
+
+const unsigned char * AssetFile::read_view(size_t size)
+{
+    size_t pos = tell();
+    if (asset_map == NULL || pos > asset_map_size ||
+        asset_map_size - pos < size)
+        return NULL;
+    seek(pos + size);
+    return asset_map + pos;
+}
+
+const unsigned char * AssetFile::get_view(size_t * size)
+{
+    size_t pos = tell();
+    if (asset_map == NULL || pos > asset_map_size)
+        return NULL;
+    *size = asset_map_size - pos;
+    return asset_map + pos;
+}
+
+#endif
+
 void AssetFile::open()
 {
-    FSFile::open("./Assets.dat", "r");
+    FSFile::open(ASSET_FILENAME, "r");
+#ifdef CHOWDREN_ASSET_MMAP
+    map_assets();
+#endif
 }
 
 void AssetFile::set_item(int index, AssetType type)
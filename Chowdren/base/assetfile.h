@@ -11,8 +11,15 @@
 #define SOUND_ARRAY_SIZE OFFSET_SIZE(SOUND_COUNT)
 #define SHADER_ARRAY_SIZE OFFSET_SIZE(SHADER_COUNT)
 #define FILE_ARRAY_SIZE OFFSET_SIZE(FILE_COUNT)
+#define ATLAS_ARRAY_SIZE OFFSET_SIZE(ATLAS_COUNT)
 #define INVALID_ASSET_ID ((unsigned int)(-1))
 
+// map Assets.dat into memory, so loaders can decode directly from the file
+// data instead of reading it into temporary buffers first
+#if defined(__linux) && !defined(CHOWDREN_NO_ASSET_MMAP)
+#define CHOWDREN_ASSET_MMAP
+#endif
+
 class AssetFile : public FSFile
 {
 public:
@@ -22,13 +29,22 @@ public:
         SOUND_DATA,
         FONT_DATA,
         SHADER_DATA,
-        FILE_DATA
+        FILE_DATA,
+        ATLAS_DATA
     };
 
     AssetFile();
     void open();
     using FSFile::open;
     void set_item(int index, AssetType type);
+
+#ifdef CHOWDREN_ASSET_MMAP
+    // returns the size bytes at the current position and skips past them.
+    // NULL if the file could not be mapped
+    const unsigned char * read_view(size_t size);
+    // returns the data from the current position to the end of the file
+    const unsigned char * get_view(size_t * size);
+#endif
 };
 
 // for temporary files
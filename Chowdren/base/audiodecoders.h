@@ -17,6 +17,60 @@ void swap(T &val1, T &val2)
     val1 ^= val2;
 }
 
+// what a decoder reads from: either a file positioned at the start of the
+// sound, or the sound data itself (e.g. a view into the mapped asset file)
+class SoundInput
+{
+public:
+    FSFile * fp;
+    const unsigned char * data;
+    size_t size;
+    size_t pos;
+
+    SoundInput(FSFile & fp)
+    : fp(&fp), data(NULL), size(0), pos(0)
+    {
+    }
+
+    SoundInput(const unsigned char * data, size_t size)
+    : fp(NULL), data(data), size(size), pos(0)
+    {
+    }
+
+    size_t read(void * out, size_t len)
+    {
+        if (fp != NULL)
+            return fp->read(out, len);
+        len = std::min(len, size - pos);
+        memcpy(out, data + pos, len);
+        pos += len;
+        return len;
+    }
+
+    bool seek(size_t v, int origin = SEEK_SET)
+    {
+        if (fp != NULL)
+            return fp->seek(v, origin);
+        if (origin == SEEK_CUR)
+            v += pos;
+        else if (origin == SEEK_END)
+            v = size - v;
+        if (v > size) {
+            pos = size;
+            return false;
+        }
+        pos = v;
+        return true;
+    }
+
+    size_t tell()
+    {
+        if (fp != NULL)
+            return fp->tell();
+        return pos;
+    }
+};
+
 class SoundDecoder
 {
 public:
@@ -44,7 +98,7 @@ ov_callbacks callbacks = {
 class OggDecoder : public SoundDecoder
 {
 public:
-    FSFile & fp;
+    SoundInput fp;
     size_t start;
     size_t pos;
     size_t size;
@@ -52,10 +106,10 @@ public:
     vorbis_info * ogg_info;
     int ogg_bitstream;
 
-    OggDecoder(FSFile & fp, size_t size)
+    OggDecoder(const SoundInput & fp, size_t size)
     : ogg_info(NULL), ogg_bitstream(0), size(size), fp(fp)
     {
-        start = fp.tell();
+        start = this->fp.tell();
         pos = 0;
         if (ov_open_callbacks((void*)this, &ogg_file, NULL, 0, callbacks) != 0)
             return;
@@ -153,7 +207,7 @@ long tell_func(void *fp)
     return file->pos;
 }
 
-inline unsigned int read_le32(FSFile & file)
+inline unsigned int read_le32(SoundInput & file)
 {
     unsigned char buffer[4];
     if (!file.read((char*)buffer, 4))
@@ -161,7 +215,7 @@ inline unsigned int read_le32(FSFile & file)
     return buffer[0] | (buffer[1]<<8) | (buffer[2]<<16) | (buffer[3]<<24);
 }
 
-inline unsigned short read_le16(FSFile & file)
+inline unsigned short read_le16(SoundInput & file)
 {
     unsigned char buffer[2];
     if (!file.read((char*)buffer, 2))
@@ -172,7 +226,7 @@ inline unsigned short read_le16(FSFile & file)
 class WavDecoder : public SoundDecoder
 {
 private:
-    FSFile & file;
+    SoundInput file;
     int sample_size;
     int block_align;
     long data_start;
@@ -180,7 +234,7 @@ private:
     size_t rem_len;
 
 public:
-    WavDecoder(FSFile & fp, size_t size)
+    WavDecoder(const SoundInput & fp, size_t size)
     : file(fp), data_start(0)
     {
         unsigned char buffer[25];
@@ -292,7 +346,8 @@ public:
     }
 };
 
-SoundDecoder * create_decoder(FSFile & fp, Media::AudioType type, size_t size)
+SoundDecoder * create_decoder(const SoundInput & fp, Media::AudioType type,
+                              size_t size)
 {
     SoundDecoder * decoder;
     if (type == Media::WAV)
@@ -0,0 +1,276 @@
+#include "benchmark.h"
+
+#ifdef CHOWDREN_BENCHMARK
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <iostream>
+#include "manager.h"
+#include "platform.h"
+#include "types.h"
+
+#ifdef CHOWDREN_ASSARRAY_STORE
+#include "objects/assarray.h"
+#endif
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+struct InputEvent
+{
+    unsigned int frame;
+    bool mouse;
+    int key;
+    bool state;
+};
+
+bool Benchmark::enabled = false;
+bool Benchmark::recording = false;
+bool Benchmark::draw = true;
+int Benchmark::frame_index = 0;
+
+static unsigned int frame_count = 0;
+static unsigned int current_frame = 0;
+static const char * input_filename = NULL;
+static const char * output_filename = NULL;
+static FILE * record_file = NULL;
+
+static vector<InputEvent> input_events;
+static unsigned int input_pos = 0;
+
+static double timer_start[Benchmark::TIMER_COUNT];
+static double frame_times[Benchmark::TIMER_COUNT];
+static vector<double> samples[Benchmark::TIMER_COUNT];
+
+static void print_usage()
+{
+    std::cout << "Usage: --benchmark <frame index> <frame count> "
+                 "[--input <file>] [--record-input <file>] [--no-draw] "
+                 "[--output <file>]" << std::endl;
+    std::cout << "       --benchmark-assarray <key count>" << std::endl;
+}
+
+void Benchmark::parse_args(int argc, char ** argv)
+{
+    for (int i = 1; i < argc; i++) {
+        const char * arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--benchmark") == 0 && i + 2 < argc) {
+            enabled = true;
+            frame_index = atoi(argv[++i]);
+            frame_count = atoi(argv[++i]);
+        } else if (strcmp(arg, "--input") == 0 && has_value) {
+            input_filename = argv[++i];
+        } else if (strcmp(arg, "--record-input") == 0 && has_value) {
+            recording = true;
+            input_filename = argv[++i];
+        } else if (strcmp(arg, "--output") == 0 && has_value) {
+            output_filename = argv[++i];
+        } else if (strcmp(arg, "--no-draw") == 0) {
+            draw = false;
+        } else if (strcmp(arg, "--benchmark-assarray") == 0 && has_value) {
+#ifdef CHOWDREN_ASSARRAY_STORE
+            AssociateArray::run_benchmark(atoi(argv[++i]));
+#else
+            std::cout << "Associate array not used" << std::endl;
+#endif
+            exit(EXIT_SUCCESS);
+        } else if (strcmp(arg, "--benchmark") == 0) {
+            print_usage();
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (!enabled)
+        recording = false;
+    if (recording)
+        draw = true;
+}
+
+static void load_input_log()
+{
+    FILE * fp = fopen(input_filename, "r");
+    if (fp == NULL) {
+        std::cout << "Could not open input log " << input_filename
+            << std::endl;
+        return;
+    }
+    unsigned int frame;
+    char type;
+    int key, state;
+    while (fscanf(fp, "%u %c %d %d", &frame, &type, &key, &state) == 4) {
+        InputEvent event;
+        event.frame = frame;
+        event.mouse = type == 'm';
+        event.key = key;
+        event.state = state != 0;
+        input_events.push_back(event);
+    }
+    fclose(fp);
+}
+
+void Benchmark::init(GameManager & manager)
+{
+    manager.fps_limit.dt = 1.0 / manager.fps_limit.framerate;
+    if (input_filename == NULL)
+        return;
+    if (!recording) {
+        load_input_log();
+        return;
+    }
+    record_file = fopen(input_filename, "w");
+    if (record_file == NULL)
+        std::cout << "Could not open input log " << input_filename
+            << std::endl;
+}
+
+void Benchmark::begin(Timer timer)
+{
+    if (!enabled)
+        return;
+    timer_start[timer] = platform_get_time();
+}
+
+void Benchmark::end(Timer timer)
+{
+    if (!enabled)
+        return;
+    frame_times[timer] += platform_get_time() - timer_start[timer];
+}
+
+void Benchmark::replay_input(GameManager & manager)
+{
+    while (input_pos < input_events.size()) {
+        InputEvent & event = input_events[input_pos];
+        if (event.frame > current_frame)
+            break;
+        input_pos++;
+        if (event.mouse)
+            manager.on_mouse(event.key, event.state);
+        else
+            manager.on_key(event.key, event.state);
+    }
+}
+
+void Benchmark::record_input(bool mouse, int key, bool state)
+{
+    if (record_file == NULL)
+        return;
+    fprintf(record_file, "%u %c %d %d\n", current_frame, mouse ? 'm' : 'k',
+            key, int(state));
+}
+
+bool Benchmark::finish_frame(GameManager & manager)
+{
+    if (!enabled)
+        return false;
+
+    // update_frame includes the clean-up
+    frame_times[UPDATE] -= frame_times[CLEAN];
+    for (int i = 0; i < TIMER_COUNT; i++) {
+        samples[i].push_back(frame_times[i]);
+        frame_times[i] = 0.0;
+    }
+    current_frame++;
+
+    // recording runs at the normal speed, but with the same fixed frame
+    // time as the replay
+    if (recording)
+        manager.fps_limit.finish();
+    manager.fps_limit.dt = 1.0 / manager.fps_limit.framerate;
+    return true;
+}
+
+bool Benchmark::is_done()
+{
+    return enabled && current_frame >= frame_count;
+}
+
+static size_t get_peak_memory()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+                              sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize / 1024;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+static void write_timer(FILE * fp, const char * name, vector<double> & values,
+                        bool last)
+{
+    double total = 0.0;
+    for (unsigned int i = 0; i < values.size(); i++)
+        total += values[i];
+    std::sort(values.begin(), values.end());
+
+    double min = 0.0, median = 0.0, p99 = 0.0;
+    int count = values.size();
+    if (count > 0) {
+        min = values[0];
+        median = values[count / 2];
+        int index = int(ceil(count * 0.99)) - 1;
+        p99 = values[std::max(0, std::min(count - 1, index))];
+    }
+
+    fprintf(fp, "    \"%s\": {\"min\": %.4f, \"median\": %.4f, "
+                "\"p99\": %.4f, \"total\": %.4f}%s\n",
+            name, min * 1000.0, median * 1000.0, p99 * 1000.0,
+            total * 1000.0, last ? "" : ",");
+}
+
+void Benchmark::write_results()
+{
+    if (record_file != NULL) {
+        fclose(record_file);
+        record_file = NULL;
+    }
+    if (!enabled)
+        return;
+
+    FILE * fp = stdout;
+    if (output_filename != NULL) {
+        fp = fopen(output_filename, "w");
+        if (fp == NULL) {
+            std::cout << "Could not open " << output_filename << std::endl;
+            fp = stdout;
+        }
+    }
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "    \"frame_index\": %d,\n", frame_index);
+    fprintf(fp, "    \"frames\": %u,\n", current_frame);
+    fprintf(fp, "    \"draw\": %s,\n", draw ? "true" : "false");
+    fprintf(fp, "    \"peak_memory_kb\": %lu,\n",
+            (unsigned long)get_peak_memory());
+    write_timer(fp, "update_ms", samples[UPDATE], false);
+    write_timer(fp, "draw_ms", samples[DRAW], false);
+    write_timer(fp, "clean_ms", samples[CLEAN], true);
+    fprintf(fp, "}\n");
+
+    if (fp != stdout)
+        fclose(fp);
+}
+
+#endif // CHOWDREN_BENCHMARK
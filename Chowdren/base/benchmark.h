@@ -0,0 +1,80 @@
+#ifndef CHOWDREN_BENCHMARK_H
+#define CHOWDREN_BENCHMARK_H
+
+#include "chowconfig.h"
+
+// Deterministic benchmark runner, enabled with the use_benchmark config
+// option (desktop only).
+//
+//     game --benchmark <frame index> <frame count> [options]
+//
+//     --input <file>         replay an input log
+//     --record-input <file>  play normally in a visible window and write the
+//                            keyboard and mouse buttons to an input log
+//     --no-draw              skip drawing. the hidden window is still
+//                            created, since textures and collision masks
+//                            are made on upload
+//     --output <file>        write the results there instead of stdout
+//
+//     game --benchmark-assarray <key count>
+//
+// times associate array loading, saving and prefix queries on generated
+// keys, writes the results to stdout and exits.
+//
+// The frame time is fixed to 1/framerate, the random seed is fixed and
+// the game runs as fast as possible. Frames are drawn to the offscreen
+// screen FBO of a hidden window and never presented, with a glFinish
+// at the end of each draw. Mouse positions are not part of the input log.
+//
+// The results are written as JSON with the min/median/p99/total times for
+// update (without clean-up), draw and clean-up (Frame::clean_instances) in
+// milliseconds, and the peak resident memory in kilobytes.
+
+#if defined(CHOWDREN_BENCHMARK) && (!defined(CHOWDREN_IS_DESKTOP) || \
+                                    defined(CHOWDREN_IS_EMSCRIPTEN))
+#undef CHOWDREN_BENCHMARK
+#endif
+
+#ifdef CHOWDREN_BENCHMARK
+
+class GameManager;
+
+namespace Benchmark
+{
+    enum Timer
+    {
+        UPDATE = 0,
+        DRAW,
+        CLEAN,
+        TIMER_COUNT
+    };
+
+    // running a benchmark, either replaying or recording
+    extern bool enabled;
+    extern bool recording;
+    extern bool draw;
+    extern int frame_index;
+
+    void parse_args(int argc, char ** argv);
+    void init(GameManager & manager);
+    void begin(Timer timer);
+    void end(Timer timer);
+    void replay_input(GameManager & manager);
+    void record_input(bool mouse, int key, bool state);
+    // returns true if the frame pacing was taken care of
+    bool finish_frame(GameManager & manager);
+    bool is_done();
+    void write_results();
+}
+
+#define BENCHMARK_BEGIN(x) Benchmark::begin(Benchmark::x)
+#define BENCHMARK_END(x) Benchmark::end(Benchmark::x)
+
+#else
+
+#define BENCHMARK_BEGIN(x)
+#define BENCHMARK_END(x)
+
+#endif
+
+#endif // CHOWDREN_BENCHMARK_H
@@ -41,6 +41,26 @@ public:
     {
         data[index / WORD_SIZE] |= 1UL << (index % WORD_SIZE);
     }
+
+    // returns the WORD_SIZE bits starting at bit 'index' of a row that is
+    // 'count' words long. bits past the end of the row are zero
+    static word_t get_word(const word_t * row, int count, int index)
+    {
+        int i = index / WORD_SIZE;
+        int shift = index % WORD_SIZE;
+        word_t value = row[i] >> shift;
+        if (shift != 0 && i + 1 < count)
+            value |= row[i + 1] << (WORD_SIZE - shift);
+        return value;
+    }
+
+    // mask with the lowest n bits set
+    static word_t get_low_mask(int n)
+    {
+        if (n >= WORD_SIZE)
+            return ~word_t(0);
+        return (word_t(1) << n) - 1;
+    }
 };
 
 #define GET_BITARRAY_PAD(N) ((((N) % BaseBitArray::WORD_SIZE) == 0) ? 0 : 1)
@@ -1,6 +1,7 @@
 #include "func.h"
 #include "callback.h"
 #include "box2dext.h"
+#include "render.h"
 
 void DestructionListener::SayGoodbye(b2Joint *joint)
 {
@@ -244,6 +245,7 @@ bool ContactFilter::RayCollide(rayUserData* userData, b2Shape* shape)
 void DebugDraw::DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color)
 {
 #ifdef CHOWDREN_IS_DESKTOP
+    Render::begin_external();
     glColor3f(color.r, color.g, color.b);
     glBegin(GL_LINE_LOOP);
     for (int32 i = 0; i < vertexCount; ++i)
@@ -251,12 +253,14 @@ void DebugDraw::DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2C
         glVertex2f(vertices[i].x*rdPtr->scale, vertices[i].y*rdPtr->scale);
     }
     glEnd();
+    Render::end_external();
 #endif
 }
 
 void DebugDraw::DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color)
 {
 #ifdef CHOWDREN_IS_DESKTOP
+    Render::begin_external();
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glColor4f(0.5f * color.r, 0.5f * color.g, 0.5f * color.b, 0.5f);
@@ -275,12 +279,14 @@ void DebugDraw::DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount, cons
         glVertex2f(vertices[i].x*rdPtr->scale, vertices[i].y*rdPtr->scale);
     }
     glEnd();
+    Render::end_external();
 #endif
 }
 
 void DebugDraw::DrawCircle(const b2Vec2& center, float32 radius, const b2Color& color)
 {
 #ifdef CHOWDREN_IS_DESKTOP
+    Render::begin_external();
     const float32 k_segments = 16.0f;
     const float32 k_increment = 2.0f * b2_pi / k_segments;
     float32 theta = 0.0f;
@@ -293,12 +299,14 @@ void DebugDraw::DrawCircle(const b2Vec2& center, float32 radius, const b2Color&
         theta += k_increment;
     }
     glEnd();
+    Render::end_external();
 #endif
 }
 
 void DebugDraw::DrawSolidCircle(const b2Vec2& center, float32 radius, const b2Vec2& axis, const b2Color& color)
 {
 #ifdef CHOWDREN_IS_DESKTOP
+    Render::begin_external();
     const float32 k_segments = 16.0f;
     const float32 k_increment = 2.0f * b2_pi / k_segments;
     float32 theta = 0.0f;
@@ -331,23 +339,27 @@ void DebugDraw::DrawSolidCircle(const b2Vec2& center, float32 radius, const b2Ve
     glVertex2f(center.x*rdPtr->scale, center.y*rdPtr->scale);
     glVertex2f(p.x*rdPtr->scale, p.y*rdPtr->scale);
     glEnd();
+    Render::end_external();
 #endif
 }
 
 void DebugDraw::DrawSegment(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color)
 {
 #ifdef CHOWDREN_IS_DESKTOP
+    Render::begin_external();
     glColor3f(color.r, color.g, color.b);
     glBegin(GL_LINES);
     glVertex2f(p1.x*rdPtr->scale, p1.y*rdPtr->scale);
     glVertex2f(p2.x*rdPtr->scale, p2.y*rdPtr->scale);
     glEnd();
+    Render::end_external();
 #endif
 }
 
 void DebugDraw::DrawXForm(const b2XForm& xf)
 {
 #ifdef CHOWDREN_IS_DESKTOP
+    Render::begin_external();
     b2Vec2 p1 = xf.position, p2;
     const float32 k_axisScale = 0.4f;
     glBegin(GL_LINES);
@@ -363,6 +375,7 @@ void DebugDraw::DrawXForm(const b2XForm& xf)
     glVertex2f(p2.x*rdPtr->scale, p2.y*rdPtr->scale);
 
     glEnd();
+    Render::end_external();
 #endif
 }
 
@@ -1,7 +1,9 @@
 #include "broadphase.h"
 
-#ifdef USE_AABB_TREE
+#if defined(USE_AABB_TREE)
 #include "broadphase/aabbtree.cpp"
-#else
+#elif defined(USE_UNIFORM_GRID)
 #include "broadphase/grid.cpp"
+#else
+#include "broadphase/hashgrid.cpp"
 #endif
@@ -2,13 +2,17 @@
 #define CHOWDREN_BROADPHASE_H
 
 // #define USE_AABB_TREE
+// #define USE_UNIFORM_GRID
 
-#ifdef USE_AABB_TREE
+#if defined(USE_AABB_TREE)
 #include "broadphase/aabbtree.h"
 typedef AABBTree Broadphase;
-#else
+#elif defined(USE_UNIFORM_GRID)
 #include "broadphase/grid.h"
 typedef UniformGrid Broadphase;
+#else
+#include "broadphase/hashgrid.h"
+typedef SpatialHash Broadphase;
 #endif
 
 #endif // CHOWDREN_BROADPHASE_H
@@ -0,0 +1,183 @@
+// Standalone benchmark for the broadphase implementations.
+//
+// Simulates a layer with static backdrop tiles and moving instances, where a
+// part of the instances live outside of the frame, and compares UniformGrid
+// against SpatialHash. Build with -DBUILD_BENCHMARKS=ON, or by hand:
+//
+//     g++ -O2 -I.. -I../include benchmark.cpp -o broadphase_benchmark
+//
+// Usage: broadphase_benchmark [instances] [steps] [outside percentage]
+
+#ifndef CHOWDREN_BROADPHASE_BENCHMARK
+#define CHOWDREN_BROADPHASE_BENCHMARK
+#endif
+
+#include "broadphase/grid.cpp"
+#include "broadphase/hashgrid.cpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define FRAME_WIDTH 4096
+#define FRAME_HEIGHT 2048
+#define STATIC_COUNT 4000
+
+struct BenchObject
+{
+    int box[4];
+    int vx, vy;
+    int proxy;
+};
+
+static unsigned int rand_state;
+
+static int next_rand(int max)
+{
+    rand_state = rand_state * 1103515245u + 12345u;
+    return int((rand_state >> 8) % (unsigned int)max);
+}
+
+static double get_time()
+{
+    return double(clock()) / double(CLOCKS_PER_SEC);
+}
+
+struct CountCallback
+{
+    int * box;
+    int candidates;
+    int hits;
+
+    CountCallback(int * box)
+    : box(box), candidates(0), hits(0)
+    {
+    }
+
+    bool on_callback(void * data)
+    {
+        candidates++;
+        BenchObject * obj = (BenchObject*)data;
+        if (obj->box[0] < box[2] && obj->box[2] > box[0] &&
+            obj->box[1] < box[3] && obj->box[3] > box[1])
+            hits++;
+        return true;
+    }
+};
+
+static void init_broadphase(UniformGrid & grid)
+{
+    grid.init(FRAME_WIDTH, FRAME_HEIGHT);
+}
+
+static void init_broadphase(SpatialHash & hash)
+{
+    hash.init();
+}
+
+static void create_objects(vector<BenchObject> & objects, int count,
+                           int outside, bool is_static)
+{
+    objects.resize(count);
+    for (int i = 0; i < count; i++) {
+        BenchObject & obj = objects[i];
+        int x, y;
+        if (!is_static && next_rand(100) < outside) {
+            // spawned off-playfield, e.g. bullets or enemies waiting to
+            // enter the frame
+            x = next_rand(FRAME_WIDTH * 3) - FRAME_WIDTH;
+            y = next_rand(FRAME_HEIGHT) - FRAME_HEIGHT - 64;
+        } else {
+            x = next_rand(FRAME_WIDTH);
+            y = next_rand(FRAME_HEIGHT);
+        }
+        int size = 16 + next_rand(48);
+        obj.box[0] = x;
+        obj.box[1] = y;
+        obj.box[2] = x + size;
+        obj.box[3] = y + size;
+        obj.vx = next_rand(9) - 4;
+        obj.vy = next_rand(9) - 4;
+        if (is_static)
+            obj.vx = obj.vy = 0;
+    }
+}
+
+template <typename T>
+static void run(const char * name, int count, int steps, int outside)
+{
+    rand_state = 1234;
+    vector<BenchObject> statics, objects;
+    create_objects(statics, STATIC_COUNT, outside, true);
+    create_objects(objects, count, outside, false);
+
+    T * broadphase = new T;
+    init_broadphase(*broadphase);
+
+    double start = get_time();
+    for (int i = 0; i < int(statics.size()); i++)
+        statics[i].proxy = broadphase->add_static(&statics[i],
+                                                  statics[i].box);
+    for (int i = 0; i < int(objects.size()); i++)
+        objects[i].proxy = broadphase->add(&objects[i], objects[i].box);
+    double add_time = get_time() - start;
+
+    double move_time = 0.0;
+    double query_time = 0.0;
+    int64_t candidates = 0;
+    int64_t hits = 0;
+
+    for (int step = 0; step < steps; step++) {
+        start = get_time();
+        for (int i = 0; i < int(objects.size()); i++) {
+            BenchObject & obj = objects[i];
+            obj.box[0] += obj.vx;
+            obj.box[1] += obj.vy;
+            obj.box[2] += obj.vx;
+            obj.box[3] += obj.vy;
+            broadphase->move(obj.proxy, obj.box);
+        }
+        double t = get_time();
+        move_time += t - start;
+
+        for (int i = 0; i < int(objects.size()); i++) {
+            BenchObject & obj = objects[i];
+            CountCallback callback(obj.box);
+            // query() returns the static items too
+            broadphase->query(obj.box, callback);
+            candidates += callback.candidates;
+            hits += callback.hits;
+        }
+        query_time += get_time() - t;
+    }
+
+    start = get_time();
+    for (int i = 0; i < int(objects.size()); i++)
+        broadphase->remove(objects[i].proxy);
+    double remove_time = get_time() - start;
+
+    delete broadphase;
+
+    printf("%-12s add %8.2f ms  move %8.2f ms  query %8.2f ms  "
+           "remove %8.2f ms  candidates %lld  hits %lld\n",
+           name, add_time * 1000.0, move_time * 1000.0, query_time * 1000.0,
+           remove_time * 1000.0, (long long)candidates, (long long)hits);
+}
+
+int main(int argc, char ** argv)
+{
+    int count = 5000;
+    int steps = 200;
+    int outside = 25;
+    if (argc > 1)
+        count = atoi(argv[1]);
+    if (argc > 2)
+        steps = atoi(argv[2]);
+    if (argc > 3)
+        outside = atoi(argv[3]);
+
+    printf("%d instances, %d static, %d steps, %d%% outside of frame\n",
+           count, STATIC_COUNT, steps, outside);
+    run<UniformGrid>("UniformGrid", count, steps, outside);
+    run<SpatialHash>("SpatialHash", count, steps, outside);
+    return 0;
+}
@@ -1,6 +1,8 @@
 #include "broadphase/grid.h"
+#ifndef CHOWDREN_BROADPHASE_BENCHMARK
 #include "manager.h"
 #include "frame.h"
+#endif
 
 inline int div_ceil(int x, int y)
 {
@@ -12,10 +14,17 @@ UniformGrid::UniformGrid()
 {
 }
 
+#ifndef CHOWDREN_BROADPHASE_BENCHMARK
 void UniformGrid::init()
 {
-    width = div_ceil(manager.frame->width, GRID_SIZE);
-    height = div_ceil(manager.frame->height, GRID_SIZE);
+    init(manager.frame->width, manager.frame->height);
+}
+#endif
+
+void UniformGrid::init(int frame_width, int frame_height)
+{
+    width = div_ceil(frame_width, GRID_SIZE);
+    height = div_ceil(frame_height, GRID_SIZE);
     grid = new GridItemList[width*height];
 }
 
@@ -48,6 +48,7 @@ public:
     UniformGrid();
     ~UniformGrid();
     void init();
+    void init(int frame_width, int frame_height);
     int add(void * data, int v[4]);
     int add_static(void * data, int v[4]);
     void move(int proxy, int v[4]);
@@ -0,0 +1,255 @@
+#include "broadphase/hashgrid.h"
+#include <algorithm>
+
+#define HASH_TABLE_SIZE 256
+
+SpatialHash::SpatialHash()
+: cell_size(CHOWDREN_BROADPHASE_CELL_SIZE), query_id(0), cell_count(0)
+{
+    table.resize(HASH_TABLE_SIZE, -1);
+    table_mask = HASH_TABLE_SIZE - 1;
+}
+
+void SpatialHash::init()
+{
+    init(CHOWDREN_BROADPHASE_CELL_SIZE);
+}
+
+void SpatialHash::init(int cell_size)
+{
+    this->cell_size = cell_size;
+    query_id = 0;
+    store.clear();
+    free_list.clear();
+    cells.clear();
+    free_cells.clear();
+    cell_count = 0;
+    table.clear();
+    table.resize(HASH_TABLE_SIZE, -1);
+    table_mask = HASH_TABLE_SIZE - 1;
+}
+
+void SpatialHash::clear()
+{
+    vector<HashCell>::iterator it;
+    for (it = cells.begin(); it != cells.end(); ++it)
+        it->items.clear();
+    free_cells.clear();
+    for (int i = int(cells.size()) - 1; i >= 0; i--)
+        free_cells.push_back(i);
+    cell_count = 0;
+    std::fill(table.begin(), table.end(), -1);
+
+    // live proxies are no longer in any cell
+    vector<HashItem>::iterator item;
+    for (item = store.begin(); item != store.end(); ++item) {
+        item->box[0] = item->box[2] = 0;
+        item->box[1] = item->box[3] = 0;
+    }
+}
+
+void SpatialHash::grow_table()
+{
+    unsigned int size = table.size() * 2;
+    table.clear();
+    table.resize(size, -1);
+    table_mask = size - 1;
+
+    for (int index = 0; index < int(cells.size()); index++) {
+        HashCell & cell = cells[index];
+        if (cell.items.empty())
+            continue;
+        unsigned int i = hash(cell.x, cell.y) & table_mask;
+        while (table[i] != -1)
+            i = (i + 1) & table_mask;
+        table[i] = index;
+    }
+}
+
+int SpatialHash::create_cell(int x, int y)
+{
+    // keep the load factor at or below 1/2
+    if ((unsigned int)(cell_count + 1) * 2 > table.size())
+        grow_table();
+
+    int index;
+    if (free_cells.empty()) {
+        index = cells.size();
+        cells.emplace_back();
+    } else {
+        index = free_cells.back();
+        free_cells.pop_back();
+    }
+
+    HashCell & cell = cells[index];
+    cell.x = x;
+    cell.y = y;
+    cell.static_items = 0;
+    cell_count++;
+
+    unsigned int i = hash(x, y) & table_mask;
+    while (table[i] != -1)
+        i = (i + 1) & table_mask;
+    table[i] = index;
+    return index;
+}
+
+void SpatialHash::release_cell(int index)
+{
+    HashCell & cell = cells[index];
+    unsigned int i = hash(cell.x, cell.y) & table_mask;
+    while (table[i] != index)
+        i = (i + 1) & table_mask;
+
+    // backward shift deletion, so probe chains stay intact without
+    // tombstones
+    unsigned int j = i;
+    while (true) {
+        j = (j + 1) & table_mask;
+        int other = table[j];
+        if (other == -1)
+            break;
+        HashCell & other_cell = cells[other];
+        unsigned int k = hash(other_cell.x, other_cell.y) & table_mask;
+        bool in_place;
+        if (i <= j)
+            in_place = i < k && k <= j;
+        else
+            in_place = i < k || k <= j;
+        if (in_place)
+            continue;
+        table[i] = other;
+        i = j;
+    }
+    table[i] = -1;
+
+    free_cells.push_back(index);
+    cell_count--;
+}
+
+void SpatialHash::insert_proxy(int x, int y, int proxy, int flags)
+{
+    int index = find_cell(x, y);
+    if (index == -1)
+        index = create_cell(x, y);
+    HashCell & cell = cells[index];
+    if (flags & HashItem::STATIC) {
+        cell.items.insert(cell.items.begin() + cell.static_items, proxy);
+        cell.static_items++;
+    } else
+        cell.items.push_back(proxy);
+}
+
+void SpatialHash::remove_proxy(int x, int y, int proxy, int flags)
+{
+    int index = find_cell(x, y);
+    if (index == -1)
+        return;
+    HashCell & cell = cells[index];
+    vector<int>::iterator it;
+    if (flags & HashItem::STATIC) {
+        for (it = cell.items.begin(); it != cell.items.end(); ++it) {
+            if (*it != proxy)
+                continue;
+            cell.items.erase(it);
+            cell.static_items--;
+            break;
+        }
+    } else {
+        for (it = cell.items.begin() + cell.static_items;
+             it != cell.items.end(); ++it) {
+            if (*it != proxy)
+                continue;
+            *it = cell.items.back();
+            cell.items.pop_back();
+            break;
+        }
+    }
+    if (cell.items.empty())
+        release_cell(index);
+}
+
+int SpatialHash::create_proxy(void * data, int v[4], int flags)
+{
+    int index;
+    if (free_list.empty()) {
+        index = store.size();
+        store.emplace_back();
+    } else {
+        index = free_list.back();
+        free_list.pop_back();
+    }
+
+    HashItem & item = store[index];
+    item.last_query_id = query_id;
+    item.data = data;
+    item.flags = flags;
+    get_box(v, item.box);
+
+    for (int y = item.box[1]; y < item.box[3]; y++)
+    for (int x = item.box[0]; x < item.box[2]; x++) {
+        insert_proxy(x, y, index, flags);
+    }
+
+    return index;
+}
+
+int SpatialHash::add(void * data, int v[4])
+{
+    return create_proxy(data, v, 0);
+}
+
+int SpatialHash::add_static(void * data, int v[4])
+{
+    return create_proxy(data, v, HashItem::STATIC);
+}
+
+void SpatialHash::remove(int proxy)
+{
+    HashItem & item = store[proxy];
+
+    for (int y = item.box[1]; y < item.box[3]; y++)
+    for (int x = item.box[0]; x < item.box[2]; x++) {
+        remove_proxy(x, y, proxy, item.flags);
+    }
+
+    item.data = NULL;
+    free_list.push_back(proxy);
+}
+
+inline bool in_cell_box(int x, int y, int box[4])
+{
+    return x >= box[0] && x < box[2] && y >= box[1] && y < box[3];
+}
+
+void SpatialHash::move(int proxy, int v[4])
+{
+    int box[4];
+    get_box(v, box);
+
+    HashItem & item = store[proxy];
+    if (box[0] == item.box[0] && box[1] == item.box[1] &&
+        box[2] == item.box[2] && box[3] == item.box[3])
+        return;
+
+    // remove from cells the proxy is leaving
+    for (int y = item.box[1]; y < item.box[3]; y++)
+    for (int x = item.box[0]; x < item.box[2]; x++) {
+        if (in_cell_box(x, y, box))
+            continue;
+        remove_proxy(x, y, proxy, item.flags);
+    }
+
+    // add to cells the proxy is entering
+    for (int y = box[1]; y < box[3]; y++)
+    for (int x = box[0]; x < box[2]; x++) {
+        if (in_cell_box(x, y, item.box))
+            continue;
+        insert_proxy(x, y, proxy, item.flags);
+    }
+
+    item.box[0] = box[0];
+    item.box[1] = box[1];
+    item.box[2] = box[2];
+    item.box[3] = box[3];
+}
@@ -0,0 +1,217 @@
+#ifndef CHOWDREN_HASHGRID_H
+#define CHOWDREN_HASHGRID_H
+
+#include "../types.h"
+
+// Unbounded spatial hash. Cells are only allocated where proxies actually
+// are, so objects outside the frame do not pile up in the border cells like
+// with UniformGrid. Can be overridden from the game config (add_defines).
+#ifndef CHOWDREN_BROADPHASE_CELL_SIZE
+#define CHOWDREN_BROADPHASE_CELL_SIZE 256
+#endif
+
+struct HashItem
+{
+    enum Flags
+    {
+        STATIC = 1 << 0
+    };
+
+    void * data;
+    // cell range, [box[0], box[2]) x [box[1], box[3])
+    int box[4];
+    int last_query_id;
+    int flags;
+
+    HashItem()
+    {
+    }
+};
+
+struct HashCell
+{
+    int x, y;
+    // static proxies are kept at the front of the list
+    int static_items;
+    // empty when the cell is on the free list
+    vector<int> items;
+
+    HashCell()
+    : static_items(0)
+    {
+    }
+};
+
+class SpatialHash
+{
+public:
+    int cell_size;
+    int query_id;
+
+    // proxies, indexed by proxy id
+    vector<HashItem> store;
+    vector<int> free_list;
+
+    // live and free cells. freed cells keep their item capacity, so cells
+    // that are repeatedly entered and left do not reallocate
+    vector<HashCell> cells;
+    vector<int> free_cells;
+    int cell_count;
+
+    // open addressing table (linear probing) of indexes into cells, -1 for
+    // empty slots. size is always a power of two
+    vector<int> table;
+    unsigned int table_mask;
+
+    SpatialHash();
+    void init();
+    void init(int cell_size);
+    int add(void * data, int v[4]);
+    int add_static(void * data, int v[4]);
+    void move(int proxy, int v[4]);
+    void remove(int proxy);
+    void clear();
+
+    template <typename T>
+    bool query_static(int v[4], T & callback);
+
+    template <typename T>
+    bool query_static(int proxy, T & callback);
+
+    template <typename T>
+    bool query(int v[4], T & callback);
+
+private:
+    int create_proxy(void * data, int v[4], int flags);
+    void get_box(int v[4], int box[4]);
+    int get_cell(int value);
+    static unsigned int hash(int x, int y);
+    int find_cell(int x, int y);
+    int create_cell(int x, int y);
+    void release_cell(int index);
+    void grow_table();
+    void insert_proxy(int x, int y, int proxy, int flags);
+    void remove_proxy(int x, int y, int proxy, int flags);
+
+    template <typename T>
+    bool query_box(int box[4], T & callback, bool only_static);
+
+    template <typename T>
+    bool query_cell(HashCell & cell, T & callback, bool only_static);
+};
+
+inline int SpatialHash::get_cell(int value)
+{
+    // floor division, so negative coordinates get their own cells
+    if (value >= 0)
+        return value / cell_size;
+    return (value + 1) / cell_size - 1;
+}
+
+inline void SpatialHash::get_box(int v[4], int box[4])
+{
+    box[0] = get_cell(v[0]);
+    box[1] = get_cell(v[1]);
+    box[2] = get_cell(v[2]) + 1;
+    box[3] = get_cell(v[3]) + 1;
+}
+
+inline unsigned int SpatialHash::hash(int x, int y)
+{
+    unsigned int h = (unsigned int)x * 0x8da6b343u;
+    h ^= (unsigned int)y * 0xd8163841u;
+    return h ^ (h >> 15);
+}
+
+inline int SpatialHash::find_cell(int x, int y)
+{
+    unsigned int i = hash(x, y) & table_mask;
+    while (true) {
+        int index = table[i];
+        if (index == -1)
+            return -1;
+        HashCell & cell = cells[index];
+        if (cell.x == x && cell.y == y)
+            return index;
+        i = (i + 1) & table_mask;
+    }
+}
+
+template <typename T>
+inline bool SpatialHash::query_cell(HashCell & cell, T & callback,
+                                    bool only_static)
+{
+    int count;
+    if (only_static)
+        count = cell.static_items;
+    else
+        count = int(cell.items.size());
+
+    for (int i = 0; i < count; ++i) {
+        HashItem & item = store[cell.items[i]];
+        if (item.last_query_id == query_id)
+            continue;
+        item.last_query_id = query_id;
+        if (!callback.on_callback(item.data))
+            return false;
+    }
+    return true;
+}
+
+template <typename T>
+inline bool SpatialHash::query_box(int box[4], T & callback, bool only_static)
+{
+    query_id++;
+
+    int64_t area = int64_t(box[2] - box[0]) * int64_t(box[3] - box[1]);
+    if (area > int64_t(cell_count)) {
+        // large query, e.g. a view with a small cell size. cheaper to walk
+        // the live cells than to probe every cell in the range
+        vector<HashCell>::iterator it;
+        for (it = cells.begin(); it != cells.end(); ++it) {
+            HashCell & cell = *it;
+            if (cell.items.empty())
+                continue;
+            if (cell.x < box[0] || cell.x >= box[2] ||
+                cell.y < box[1] || cell.y >= box[3])
+                continue;
+            if (!query_cell(cell, callback, only_static))
+                return false;
+        }
+        return true;
+    }
+
+    for (int y = box[1]; y < box[3]; y++)
+    for (int x = box[0]; x < box[2]; x++) {
+        int index = find_cell(x, y);
+        if (index == -1)
+            continue;
+        if (!query_cell(cells[index], callback, only_static))
+            return false;
+    }
+    return true;
+}
+
+template <typename T>
+inline bool SpatialHash::query_static(int v[4], T & callback)
+{
+    int box[4];
+    get_box(v, box);
+    return query_box(box, callback, true);
+}
+
+template <typename T>
+inline bool SpatialHash::query_static(int proxy, T & callback)
+{
+    return query_box(store[proxy].box, callback, true);
+}
+
+template <typename T>
+inline bool SpatialHash::query(int v[4], T & callback)
+{
+    int box[4];
+    get_box(v, box);
+    return query_box(box, callback, false);
+}
+
+#endif // CHOWDREN_HASHGRID_H
@@ -1,9 +1,9 @@
 #include "collision.h"
 #include "gencol.cpp"
 
-bool collide_direct(CollisionBase * a, CollisionBase * b, int * aabb_2)
+bool collide_direct(CollisionBase * a, int * aabb_1,
+                    CollisionBase * b, int * aabb_2)
 {
-    int * aabb_1 = a->aabb;
     if (!collides(aabb_1, aabb_2))
         return false;
 
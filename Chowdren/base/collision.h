@@ -417,12 +417,16 @@ public:
     int dest_x, dest_y, src_x, src_y, src_width, src_height;
     Color color;
     Image * image;
+    // broadphase proxy, position in the Background list and paste order
+    int proxy;
+    int index;
+    unsigned int order;
 
     BackgroundItem(Image * img, int dest_x, int dest_y, int src_x, int src_y,
                    int src_width, int src_height, const Color & color)
     : dest_x(dest_x), dest_y(dest_y), src_x(src_x), src_y(src_y),
       src_width(src_width), src_height(src_height), image(img), color(color),
-      CollisionBase(BACKGROUND_ITEM, 0)
+      CollisionBase(BACKGROUND_ITEM, 0), proxy(-1), index(-1), order(0)
     {
         aabb[0] = dest_x;
         aabb[1] = dest_y;
@@ -436,11 +440,37 @@ public:
     }
 };
 
-bool collide_direct(CollisionBase * a, CollisionBase * b, int * aabb_2);
+// the pixel tests only depend on the AABBs, so a collision can be tested
+// at any position by passing a different aabb_1/aabb_2
+bool collide_direct(CollisionBase * a, int * aabb_1,
+                    CollisionBase * b, int * aabb_2);
+
+inline bool collide_direct(CollisionBase * a, CollisionBase * b, int * aabb_2)
+{
+    return collide_direct(a, a->aabb, b, aabb_2);
+}
 
 inline bool collide(CollisionBase * a, CollisionBase * b)
 {
-    return collide_direct(a, b, b->aabb);
+    return collide_direct(a, a->aabb, b, b->aabb);
+}
+
+inline void offset_aabb(CollisionBase * a, int dx, int dy, int aabb[4])
+{
+    aabb[0] = a->aabb[0] + dx;
+    aabb[1] = a->aabb[1] + dy;
+    aabb[2] = a->aabb[2] + dx;
+    aabb[3] = a->aabb[3] + dy;
+}
+
+// tests 'a' as if it was moved by (dx, dy). does not touch the instance,
+// the collision cache or the broadphase
+inline bool collide_offset(CollisionBase * a, int dx, int dy,
+                           CollisionBase * b)
+{
+    int aabb[4];
+    offset_aabb(a, dx, dy, aabb);
+    return collide_direct(a, aabb, b, b->aabb);
 }
 
 inline bool collide_box(FrameObject * a, int v[4])
@@ -84,7 +84,10 @@ Font::Font(const char * face, int size, bool bold, bool italic, bool underline)
 // Background
 
 Background::Background()
+: paste_count(0)
 {
+    items_broadphase.init();
+    col_broadphase.init();
 }
 
 void clear_back_vec(BackgroundItems & items)
@@ -108,38 +111,80 @@ void Background::reset(bool clear_items)
     if (clear_items) {
         clear_back_vec(col_items);
         clear_back_vec(items);
+        items_broadphase.init();
+        col_broadphase.init();
+        paste_count = 0;
     }
 }
 
-void Background::destroy_at(int x, int y)
+void Background::add_item(BackgroundItems & list, Broadphase & broadphase,
+                          BackgroundItem * item)
 {
-    BackgroundItems::iterator it = items.begin();
-    while (it != items.end()) {
-        BackgroundItem * item = *it;
-        if (collides(item->dest_x, item->dest_y,
-                     item->dest_x + item->src_width,
-                     item->dest_y + item->src_height,
-                     x, y, x+1, y+1)) {
-            delete item;
-            it = items.erase(it);
-        } else {
-            ++it;
-        }
+    item->order = paste_count++;
+    item->index = list.size();
+    item->proxy = broadphase.add_static(item, item->aabb);
+    list.push_back(item);
+}
+
+void Background::remove_item(BackgroundItems & list, Broadphase & broadphase,
+                             BackgroundItem * item)
+{
+    broadphase.remove(item->proxy);
+    BackgroundItem * last = list.back();
+    list[item->index] = last;
+    last->index = item->index;
+    list.pop_back();
+    delete item;
+}
+
+struct BackgroundQuery
+{
+    BackgroundItems & list;
+    int * aabb;
+
+    BackgroundQuery(BackgroundItems & list, int * aabb)
+    : list(list), aabb(aabb)
+    {
+    }
+
+    bool on_callback(void * data)
+    {
+        BackgroundItem * item = (BackgroundItem*)data;
+        if (collides(item->aabb, aabb))
+            list.push_back(item);
+        return true;
     }
-    it = col_items.begin();
-    while (it != col_items.end()) {
+};
+
+static BackgroundItems background_query;
+
+void Background::destroy_at(BackgroundItems & list, Broadphase & broadphase,
+                            int x, int y, int box[4])
+{
+    int v[4] = {x, y, x+1, y+1};
+    background_query.clear();
+    BackgroundQuery callback(background_query, v);
+    broadphase.query_static(v, callback);
+    BackgroundItems::const_iterator it;
+    for (it = background_query.begin(); it != background_query.end(); ++it) {
         BackgroundItem * item = *it;
-        if (collides(item->dest_x, item->dest_y,
-                     item->dest_x + item->src_width,
-                     item->dest_y + item->src_height,
-                     x, y, x+1, y+1)) {
-            delete item;
-            it = col_items.erase(it);
-        } else
-            ++it;
+        box[0] = std::min(box[0], item->aabb[0]);
+        box[1] = std::min(box[1], item->aabb[1]);
+        box[2] = std::max(box[2], item->aabb[2]);
+        box[3] = std::max(box[3], item->aabb[3]);
+        remove_item(list, broadphase, item);
     }
 }
 
+bool Background::destroy_at(int x, int y, int box[4])
+{
+    box[0] = box[1] = 0x7FFFFFFF;
+    box[2] = box[3] = -0x7FFFFFFF;
+    destroy_at(items, items_broadphase, x, y, box);
+    destroy_at(col_items, col_broadphase, x, y, box);
+    return box[0] <= box[2];
+}
+
 void Background::paste(Image * img, int dest_x, int dest_y,
                        int src_x, int src_y, int src_width, int src_height,
                        int collision_type, const Color & color)
@@ -162,7 +207,7 @@ void Background::paste(Image * img, int dest_x, int dest_y,
                                                    color);
         if (collision_type == 3)
             item->flags |= (LADDER_OBSTACLE | BOX_COLLISION);
-        col_items.push_back(item);
+        add_item(col_items, col_broadphase, item);
 #ifndef CHOWDREN_OBSTACLE_IMAGE
         return;
 #endif
@@ -171,45 +216,76 @@ void Background::paste(Image * img, int dest_x, int dest_y,
     if (color.a == 0 || color.a == 1)
         return;
 
-    items.push_back(new BackgroundItem(img, dest_x, dest_y,
-                                       src_x, src_y,
-                                       src_width, src_height,
-                                       color));
+    add_item(items, items_broadphase,
+             new BackgroundItem(img, dest_x, dest_y, src_x, src_y,
+                                src_width, src_height, color));
+}
+
+inline bool sort_paste_comp(BackgroundItem * a, BackgroundItem * b)
+{
+    return a->order < b->order;
 }
 
 void Background::draw(int v[4])
 {
+    background_query.clear();
+    BackgroundQuery callback(background_query, v);
+    items_broadphase.query_static(v, callback);
+
+    // draw in paste order
+    std::sort(background_query.begin(), background_query.end(),
+              sort_paste_comp);
     BackgroundItems::const_iterator it;
-    for (it = items.begin(); it != items.end(); ++it) {
-        BackgroundItem * item = *it;
-        if (!collides(item->aabb, v))
-            continue;
-        item->draw();
-    }
+    for (it = background_query.begin(); it != background_query.end(); ++it)
+        (*it)->draw();
 }
 
-CollisionBase * Background::collide(CollisionBase * a)
+struct BackgroundCollideCallback
 {
-    BackgroundItems::iterator it;
-    for (it = col_items.begin(); it != col_items.end(); ++it) {
-        BackgroundItem * item = *it;
-        if (::collide(a, item))
-            return item;
+    CollisionBase * col;
+    int * aabb;
+    bool skip_ladders;
+    BackgroundItem * other;
+
+    BackgroundCollideCallback(CollisionBase * col, int * aabb,
+                              bool skip_ladders)
+    : col(col), aabb(aabb), skip_ladders(skip_ladders), other(NULL)
+    {
     }
-    return NULL;
+
+    // the broadphase returns the items in any order, so keep looking for
+    // the first pasted one
+    bool on_callback(void * data)
+    {
+        BackgroundItem * item = (BackgroundItem*)data;
+        if (other != NULL && item->order >= other->order)
+            return true;
+        if (skip_ladders && item->flags & LADDER_OBSTACLE)
+            return true;
+        if (!collide_direct(col, aabb, item, item->aabb))
+            return true;
+        other = item;
+        return true;
+    }
+};
+
+CollisionBase * Background::collide(CollisionBase * a)
+{
+    BackgroundCollideCallback callback(a, a->aabb, false);
+    col_broadphase.query_static(a->aabb, callback);
+    return callback.other;
 }
 
 CollisionBase * Background::overlaps(CollisionBase * a)
 {
-    BackgroundItems::iterator it;
-    for (it = col_items.begin(); it != col_items.end(); ++it) {
-        BackgroundItem * item = *it;
-        if (item->flags & LADDER_OBSTACLE)
-            continue;
-        if (::collide(a, item))
-            return item;
-    }
-    return NULL;
+    return overlaps(a, a->aabb);
+}
+
+CollisionBase * Background::overlaps(CollisionBase * a, int * aabb)
+{
+    BackgroundCollideCallback callback(a, aabb, true);
+    col_broadphase.query_static(aabb, callback);
+    return callback.other;
 }
 
 // Layer
@@ -245,6 +321,12 @@ void Layer::reset()
     off_x = off_y = 0;
     scroll_x = scroll_y = 0;
     back = NULL;
+#ifdef CHOWDREN_LAYER_CACHE
+    cache.clear();
+#endif
+    draw_list.clear();
+    draw_stamp = 0;
+    draw_sorted = true;
 
     update_position();
 #ifdef CHOWDREN_IS_3DS
@@ -432,6 +514,8 @@ void Layer::remove_background_object(FrameObject * instance)
         background_instances.erase(it);
         break;
     }
+    remove_draw_object(instance);
+    invalidate_static(instance);
 }
 
 // means we can store about 20,000 objects in both directions
@@ -530,6 +614,46 @@ void Layer::reset_depth()
 void Layer::remove_object(FrameObject * instance)
 {
     instances.erase(LayerInstances::s_iterator_to(*instance));
+    remove_draw_object(instance);
+}
+
+void Layer::remove_draw_object(FrameObject * instance)
+{
+    // the instance is merged back in at its new depth on the next draw
+    int index = instance->draw_index;
+    if (index == -1)
+        return;
+    instance->draw_index = -1;
+    if (index < int(draw_list.size()) && draw_list[index] == instance)
+        draw_list[index] = NULL;
+}
+
+void Layer::invalidate_draw_list()
+{
+    // for when the order of the instances changed as a whole
+    draw_sorted = false;
+}
+
+void Layer::invalidate_static(FrameObject * instance, int dx, int dy)
+{
+#ifdef CHOWDREN_LAYER_CACHE
+    // covers both the old and the new area when moving by dx, dy
+    int box[4];
+    if (instance->collision != NULL) {
+        for (int i = 0; i < 4; i++)
+            box[i] = instance->collision->aabb[i];
+    } else {
+        box[0] = instance->x;
+        box[1] = instance->y;
+        box[2] = instance->x + instance->width;
+        box[3] = instance->y + instance->height;
+    }
+    box[0] += std::min(dx, 0);
+    box[1] += std::min(dy, 0);
+    box[2] += std::max(dx, 0);
+    box[3] += std::max(dy, 0);
+    cache.invalidate(box);
+#endif
 }
 
 void Layer::set_level(FrameObject * instance, int new_index)
@@ -561,6 +685,9 @@ void Layer::destroy_backgrounds()
     if (back == NULL)
         return;
     back->reset();
+#ifdef CHOWDREN_LAYER_CACHE
+    cache.invalidate();
+#endif
 }
 
 void Layer::destroy_backgrounds(int x, int y, bool fine)
@@ -568,7 +695,14 @@ void Layer::destroy_backgrounds(int x, int y, bool fine)
     if (fine)
         std::cout << "Destroy backgrounds at " << x << ", " << y <<
             " (" << fine << ") not implemented" << std::endl;
-    back->destroy_at(x, y);
+    if (back == NULL)
+        return;
+    int box[4];
+    if (!back->destroy_at(x, y, box))
+        return;
+#ifdef CHOWDREN_LAYER_CACHE
+    cache.invalidate(box);
+#endif
 }
 
 struct BackgroundCallback
@@ -628,15 +762,19 @@ void Layer::paste(Image * img, int dest_x, int dest_y,
         back = new Background;
     back->paste(img, dest_x, dest_y, src_x, src_y,
                 src_width, src_height, collision_type, color);
+#ifdef CHOWDREN_LAYER_CACHE
+    int box[4] = {dest_x, dest_y, dest_x + src_width, dest_y + src_height};
+    cache.invalidate(box);
+#endif
 }
 
 struct DrawCallback
 {
-    FlatObjectList & list;
+    Layer * layer;
     int * aabb;
 
-    DrawCallback(FlatObjectList & list, int v[4])
-    : list(list), aabb(v)
+    DrawCallback(Layer * layer, int v[4])
+    : layer(layer), aabb(v)
     {
     }
 
@@ -647,7 +785,12 @@ struct DrawCallback
             return true;
         if (!collide_box(item, aabb))
             return true;
-        list.push_back(item);
+        item->draw_stamp = layer->draw_stamp;
+        int index = item->draw_index;
+        if (index != -1 && index < int(layer->draw_list.size()) &&
+            layer->draw_list[index] == item)
+            return true;
+        layer->draw_added.push_back(item);
         return true;
     }
 };
@@ -666,6 +809,47 @@ inline void sort_depth(FlatObjectList & list)
     std::sort(list.begin(), list.end(), sort_depth_comp);
 }
 
+void Layer::update_draw_list(int v[4])
+{
+    draw_stamp++;
+    draw_added.clear();
+    DrawCallback callback(this, v);
+    broadphase.query(v, callback);
+
+    // drop instances that were removed or left the view, keeping the order
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < draw_list.size(); i++) {
+        FrameObject * obj = draw_list[i];
+        if (obj == NULL)
+            continue;
+        if (obj->draw_stamp != draw_stamp) {
+            obj->draw_index = -1;
+            continue;
+        }
+        draw_list[count++] = obj;
+    }
+    draw_list.resize(count);
+
+    if (!draw_added.empty()) {
+        draw_list.insert(draw_list.end(), draw_added.begin(),
+                         draw_added.end());
+        if (draw_sorted) {
+            // only the new instances need sorting
+            FlatObjectList::iterator middle = draw_list.begin() + count;
+            std::sort(middle, draw_list.end(), sort_depth_comp);
+            std::inplace_merge(draw_list.begin(), middle, draw_list.end(),
+                               sort_depth_comp);
+        }
+    }
+    if (!draw_sorted) {
+        sort_depth(draw_list);
+        draw_sorted = true;
+    }
+
+    for (unsigned int i = 0; i < draw_list.size(); i++)
+        draw_list[i]->draw_index = i;
+}
+
 void Layer::draw(int display_x, int display_y)
 {
     if (!visible)
@@ -709,25 +893,29 @@ void Layer::draw(int display_x, int display_y)
     int v[4] = {x1, y1, x2, y2};
 #endif
 
-    static FlatObjectList draw_list;
-    draw_list.clear();
-    DrawCallback callback(draw_list, v);
-    broadphase.query(v, callback);
+    update_draw_list(v);
 
-    sort_depth(draw_list);
+    // background instances and pasted items, either directly or baked
+    bool draw_static = true;
+#ifdef CHOWDREN_LAYER_CACHE
+    PROFILE_BEGIN(Layer_draw_cache);
+    draw_static = !cache.draw(this, v);
+    PROFILE_END();
+#endif
 
     FlatObjectList::const_iterator it;
     for (it = draw_list.begin(); it != draw_list.end(); ++it) {
         FrameObject * obj = *it;
         if (!(obj->flags & BACKGROUND))
             break;
-        obj->draw();
+        if (draw_static)
+            obj->draw();
     }
 
     PROFILE_BEGIN(Layer_draw_pasted);
 
     // draw pasted items
-    if (back != NULL)
+    if (back != NULL && draw_static)
         back->draw(v);
 
     PROFILE_END();
@@ -974,19 +1162,34 @@ int Frame::get_instance_count()
     return size;
 }
 
+static vector<ObjectList*> destroyed_lists;
+
 void Frame::clean_instances()
 {
     FlatObjectList::const_iterator it;
     for (it = destroyed_instances.begin(); it != destroyed_instances.end();
          ++it) {
         FrameObject * instance = *it;
-        INSTANCE_MAP.items[instance->id].remove(instance);
+        ObjectList & list = INSTANCE_MAP.items[instance->id];
+        if (!list.has_destroyed) {
+            list.has_destroyed = true;
+            destroyed_lists.push_back(&list);
+        }
         if (instance->flags & BACKGROUND)
             instance->layer->remove_background_object(instance);
         else
             instance->layer->remove_object(instance);
-        instance->dealloc();
     }
+
+    // compact each list once, instead of shifting it for every instance
+    vector<ObjectList*>::iterator list;
+    for (list = destroyed_lists.begin(); list != destroyed_lists.end(); ++list)
+        (*list)->remove_destroyed();
+    destroyed_lists.clear();
+
+    for (it = destroyed_instances.begin(); it != destroyed_instances.end();
+         ++it)
+        (*it)->dealloc();
     destroyed_instances.clear();
 }
 
@@ -998,6 +1201,10 @@ void Frame::load_static_images()
 {
 }
 
+void Frame::prefetch_images(int index)
+{
+}
+
 bool Frame::update()
 {
     frame_time += manager.dt;
@@ -1022,7 +1229,9 @@ bool Frame::update()
         PROFILE_END();
 
         PROFILE_BEGIN(clean_instances);
+        BENCHMARK_BEGIN(CLEAN);
         clean_instances();
+        BENCHMARK_END(CLEAN);
         PROFILE_END();
     }
 
@@ -1054,6 +1263,10 @@ void Frame::draw(int remote)
 
     PROFILE_END();
 
+#ifdef CHOWDREN_LAYER_CACHE
+    LayerCache::begin_frame();
+#endif
+
     vector<Layer>::iterator it;
     for (it = layers.begin(); it != layers.end(); ++it) {
         Layer & layer = *it;
@@ -1132,7 +1345,7 @@ void Frame::set_object_layer(FrameObject * instance, int new_layer)
         std::cout << "Cannot move background object layer" << std::endl;
         return;
     }
-    new_layer = clamp(new_layer, 0, layers.size()-1);
+    new_layer = clamp(new_layer, 0, int(layers.size())-1);
     Layer * layer = &layers[new_layer];
     if (layer == instance->layer)
         return;
@@ -1178,10 +1391,10 @@ void Frame::reset()
 // FrameObject
 
 FrameObject::FrameObject(int x, int y, int type_id)
-: x(x), y(y), id(type_id), flags(SCROLL | VISIBLE), effect(Render::NONE),
-  alterables(NULL), shader_parameters(NULL), direction(0),
-  movement(NULL), movements(NULL), movement_count(0), collision(NULL),
-  collision_flags(0)
+: x(x), y(y), layer(NULL), id(type_id), flags(SCROLL | VISIBLE),
+  effect(Render::NONE), alterables(NULL), shader_parameters(NULL),
+  direction(0), movement(NULL), movements(NULL), movement_count(0),
+  collision(NULL), draw_index(-1), draw_stamp(0), collision_flags(0)
 {
 #ifdef CHOWDREN_USE_BOX2D
     body = -1;
@@ -1214,17 +1427,23 @@ FrameObject::~FrameObject()
 #ifndef CHOWDREN_USE_DIRECT_RENDERER
 void FrameObject::draw_image(Image * img, int x, int y, Color c)
 {
+    // effects expect 0..1 texcoords and may sample around the image, so
+    // keep such images out of the atlas
+    if (effect != Render::NONE)
+        img->set_standalone();
     img->upload_texture();
     int x1 = x - img->hotspot_x;
     int y1 = y - img->hotspot_y;
     int x2 = x1 + img->width;
     int y2 = y1 + img->height;
     if (effect == Render::NONE) {
-        Render::draw_tex(x1, y1, x2, y2, c, img->tex);
+        Render::draw_tex(x1, y1, x2, y2, c, img->tex,
+                         img->tex_x1, img->tex_y1, img->tex_x2, img->tex_y2);
         return;
     }
     Render::set_effect(effect, this, img->width, img->height);
-    Render::draw_tex(x1, y1, x2, y2, c, img->tex);
+    Render::draw_tex(x1, y1, x2, y2, c, img->tex,
+                     img->tex_x1, img->tex_y1, img->tex_x2, img->tex_y2);
     Render::disable_effect();
 }
 
@@ -1235,6 +1454,7 @@ void FrameObject::draw_image(Image * img, int x, int y, Color c, float angle,
         img->draw(x, y, c, angle, x_scale, y_scale);
         return;
     }
+    img->set_standalone();
     Render::set_effect(effect, this, img->width, img->height);
     img->draw(x, y, c, angle, x_scale, y_scale);
     Render::disable_effect();
@@ -1251,6 +1471,7 @@ void FrameObject::draw_image(Image * img, int x, int y, Color c, float angle,
         img->draw_flip_x(x, y, c, angle, x_scale, y_scale);
         return;
     }
+    img->set_standalone();
     Render::set_effect(effect, this, img->width, img->height);
     img->draw_flip_x(x, y, c, angle, x_scale, y_scale);
     Render::disable_effect();
@@ -1282,6 +1503,8 @@ void FrameObject::set_position(int new_x, int new_y)
 {
     if (new_x == x && new_y == y)
         return;
+    if (flags & BACKGROUND && layer != NULL)
+        layer->invalidate_static(this, new_x - x, new_y - y);
     if (collision == NULL) {
         x = new_x;
         y = new_y;
@@ -1308,6 +1531,8 @@ void FrameObject::set_x(int new_x)
     new_x -= layer->off_x;
     if (x == new_x)
         return;
+    if (flags & BACKGROUND)
+        layer->invalidate_static(this, new_x - x, 0);
     if (collision == NULL) {
         x = new_x;
         return;
@@ -1324,6 +1549,8 @@ void FrameObject::set_y(int new_y)
     new_y -= layer->off_y;
     if (y == new_y)
         return;
+    if (flags & BACKGROUND)
+        layer->invalidate_static(this, 0, new_y - y);
     if (collision == NULL) {
         y = new_y;
         return;
@@ -1348,6 +1575,9 @@ void FrameObject::set_visible(bool value)
         flags |= VISIBLE;
     else
         flags &= ~VISIBLE;
+
+    if (flags & BACKGROUND && layer != NULL)
+        layer->invalidate_static(this);
 }
 
 void FrameObject::set_blend_color(int color)
@@ -1355,6 +1585,8 @@ void FrameObject::set_blend_color(int color)
     int a = blend_color.a;
     blend_color = Color(color);
     blend_color.a = a;
+    if (flags & BACKGROUND && layer != NULL)
+        layer->invalidate_static(this);
 }
 
 void FrameObject::set_layer(int index)
@@ -1364,6 +1596,13 @@ void FrameObject::set_layer(int index)
 
 void FrameObject::flash(float value) {}
 void FrameObject::draw() {}
+
+#ifdef CHOWDREN_LAYER_CACHE
+bool FrameObject::can_bake()
+{
+    return false;
+}
+#endif
 void FrameObject::set_direction(int value, bool set_movement)
 {
     direction = value & 31;
@@ -1388,7 +1627,21 @@ bool FrameObject::mouse_over()
     return collide(&col1, collision);
 }
 
+static inline int * get_overlap_aabb(FrameObject * obj)
+{
+#ifdef CHOWDREN_DEFER_COLLISIONS
+    if (obj->flags & DEFER_COLLISIONS)
+        return ((Active*)obj)->old_aabb;
+#endif
+    return obj->collision->aabb;
+}
+
 bool FrameObject::overlaps(FrameObject * other)
+{
+    return overlaps(other, 0, 0);
+}
+
+bool FrameObject::overlaps(FrameObject * other, int dx, int dy)
 {
     if (flags & INACTIVE || other->flags & INACTIVE)
         return false;
@@ -1401,24 +1654,18 @@ bool FrameObject::overlaps(FrameObject * other)
         return false;
     if (other->layer != layer)
         return false;
-#ifdef CHOWDREN_DEFER_COLLISIONS
-    int * other_aabb;
-    if (other->flags & DEFER_COLLISIONS)
-        other_aabb = ((Active*)other)->old_aabb;
-    else
-        other_aabb = other_col->aabb;
-    return collide_direct(collision, other_col, other_aabb);
-#else
-    return collide(collision, other_col);
-#endif
+    int aabb[4];
+    offset_aabb(collision, dx, dy, aabb);
+    return collide_direct(collision, aabb, other_col, get_overlap_aabb(other));
 }
 
 struct BackgroundOverlapCallback
 {
     CollisionBase * collision;
+    int * aabb;
 
-    BackgroundOverlapCallback(CollisionBase * collision)
-    : collision(collision)
+    BackgroundOverlapCallback(CollisionBase * collision, int * aabb)
+    : collision(collision), aabb(aabb)
     {
     }
 
@@ -1432,7 +1679,7 @@ struct BackgroundOverlapCallback
             return true;
         if (other->flags & LADDER_OBSTACLE)
             return true;
-        if (!collide(collision, other))
+        if (!collide_direct(collision, aabb, other, other->aabb))
             return true;
         return false;
     }
@@ -1449,7 +1696,7 @@ bool FrameObject::overlaps_background()
         flags |= HAS_COLLISION;
         return true;
     }
-    BackgroundOverlapCallback callback(collision);
+    BackgroundOverlapCallback callback(collision, collision->aabb);
     if (!layer->broadphase.query_static(collision->proxy, callback)) {
         flags |= HAS_COLLISION;
         return true;
@@ -1457,6 +1704,21 @@ bool FrameObject::overlaps_background()
     return false;
 }
 
+bool FrameObject::overlaps_background(int dx, int dy)
+{
+    if (dx == 0 && dy == 0)
+        return overlaps_background();
+    if (flags & DESTROYING || collision == NULL)
+        return false;
+    // probe, so the collision cache is neither used nor updated
+    int aabb[4];
+    offset_aabb(collision, dx, dy, aabb);
+    if (layer->back != NULL && layer->back->overlaps(collision, aabb))
+        return true;
+    BackgroundOverlapCallback callback(collision, aabb);
+    return !layer->broadphase.query_static(aabb, callback);
+}
+
 bool FrameObject::overlaps_background_save()
 {
     bool ret = overlaps_background();
@@ -1529,6 +1791,8 @@ void FrameObject::set_shader(int value)
     if (shader_parameters == NULL)
         shader_parameters = new ShaderParameters;
     effect = value;
+    if (flags & BACKGROUND && layer != NULL)
+        layer->invalidate_static(this);
 }
 
 void FrameObject::set_shader_parameter(const std::string & name, double value)
@@ -1551,6 +1815,8 @@ void FrameObject::set_shader_parameter(const std::string & name, Image & img)
 {
     if (name.empty())
         return;
+    // shaders sample the whole texture
+    img.set_standalone();
     img.upload_texture();
     set_shader_parameter(name, (double)img.tex);
 }
@@ -1670,6 +1936,7 @@ void FrameObject::move_back(FrameObject * other)
 
     layer->instances.erase(LayerInstances::s_iterator_to(*this));
     layer->instances.insert(it, *this);
+    layer->remove_draw_object(this);
 
     if (reset) {
 #ifndef NDEBUG
@@ -1706,6 +1973,7 @@ void FrameObject::move_front(FrameObject * other)
 
     layer->instances.erase(LayerInstances::s_iterator_to(*this));
     layer->instances.insert(it, *this);
+    layer->remove_draw_object(this);
 
     if (reset) {
 #ifndef NDEBUG
@@ -4,6 +4,7 @@
 #include "chowconfig.h"
 #include "render.h"
 #include "profiler.h"
+#include "benchmark.h"
 #include "keydef.h"
 #include "keyconv.h"
 #include "manager.h"
@@ -248,4 +248,40 @@ public:
     }
 };
 
+class ArrayStream : public BaseStream
+{
+public:
+    const char * data;
+    size_t size;
+    size_t pos;
+
+    ArrayStream(const char * data, size_t size)
+    : data(data), size(size), pos(0)
+    {
+    }
+
+    bool read(char * out, size_t len)
+    {
+        if (size - pos < len)
+            return false;
+        memcpy(out, data + pos, len);
+        pos += len;
+        return true;
+    }
+
+    void seek(size_t p)
+    {
+        pos = std::min(p, size);
+    }
+
+    bool at_end()
+    {
+        return pos == size;
+    }
+
+    void write(const char * data, size_t len)
+    {
+    }
+};
+
 #endif // CHOWDREN_DATASTREAM_H
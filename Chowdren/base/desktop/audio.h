@@ -10,6 +10,7 @@
 #include <alc.h>
 #include <SDL_thread.h>
 #include <SDL_mutex.h>
+#include <SDL_atomic.h>
 #endif // CHOWDREN_IS_EMSCRIPTEN
 
 #ifndef NOMINMAX
@@ -19,8 +20,29 @@
 #include <math.h>
 #include "../types.h"
 #include "../audiodecoders.h"
+#include "../trace.h"
+#include "../pool.h"
 
 #define BUFFER_COUNT 3
+// sources created up front, more are created when needed
+#define SOURCE_POOL_SIZE 32
+// size of the stream command queue, must be a power of two
+#define STREAM_COMMAND_COUNT 256
+// refill interval of the stream thread when no commands arrive
+#define STREAM_UPDATE_MS 50
+// PCM decoded ahead for each playing stream
+#define PREFETCH_SECONDS 2
+// PCM kept for the start of each streamed sound
+#define PREFETCH_HEAD_SECONDS 1
+// samples decoded per step of the decode thread
+#define PREFETCH_CHUNK 8192
+// loop ends that can be queued in a prefetch buffer
+#define PREFETCH_ENDS 8
+#define PREFETCH_UPDATE_MS 20
+// memory budget for the stream heads
+#ifndef CHOWDREN_STREAM_HEAD_MEMORY
+#define CHOWDREN_STREAM_HEAD_MEMORY (32 * 1024 * 1024)
+#endif
 
 namespace ChowdrenAudio {
 
@@ -86,6 +108,31 @@ void _al_check(const std::string& file, unsigned int line)
 #endif
 
 class SoundStream;
+class StreamSource;
+class PrefetchDecoder;
+
+// all changes to streams are sent to the stream thread, so it is the only
+// thread that decodes and touches their sources
+struct StreamCommand
+{
+    enum Type
+    {
+        ADD = 0,
+        DESTROY,
+        PLAY,
+        PAUSE,
+        STOP,
+        SEEK,
+        LOOP,
+        VOLUME,
+        PAN,
+        PITCH
+    };
+
+    int type;
+    SoundStream * stream;
+    double value;
+};
 
 class AudioDevice
 {
@@ -93,16 +140,53 @@ public:
     ALCdevice * device;
     ALCcontext * context;
     ALboolean direct_channels_ext, sub_buffer_data_ext;
+    // only used by the stream thread
     vector<SoundStream*> streams;
     SDL_Thread * streaming_thread;
-    SDL_mutex * stream_mutex;
     volatile bool closing;
 
+    vector<ALuint> free_sources;
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+    SDL_mutex * source_mutex;
+
+    // single producer (game thread), single consumer (stream thread)
+    StreamCommand commands[STREAM_COMMAND_COUNT];
+    SDL_atomic_t command_read, command_write;
+    SDL_mutex * stream_mutex;
+    SDL_cond * stream_cond;
+#endif
+
     void open();
     static int _stream_update(void * data);
     void stream_update();
-    void add_stream(SoundStream*);
-    void remove_stream(SoundStream*);
+    void send(int type, SoundStream * stream, double value = 0.0);
+    void run_command(const StreamCommand & command);
+    void run_commands();
+    ALuint create_source();
+    ALuint get_source();
+    void release_source(ALuint source);
+
+    // streamed sounds, owned by the device
+    vector<StreamSource*> sources;
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+    // decode thread, fills the prefetch buffers and decodes stream heads
+    SDL_Thread * decode_thread;
+    SDL_mutex * decode_mutex;
+    SDL_cond * decode_cond;
+    vector<PrefetchDecoder*> prefetchers;
+    unsigned int head_index;
+    size_t head_memory;
+    volatile bool decode_closing;
+
+    static int _decode_update(void * data);
+    void decode_update();
+    void add_prefetch(PrefetchDecoder * decoder);
+    void remove_prefetch(PrefetchDecoder * decoder);
+    void wake_decoder();
+#endif
+    StreamSource * add_source(size_t offset, const std::string & path,
+                              Media::AudioType type, size_t size);
+
     void close();
 };
 
@@ -118,6 +202,12 @@ void close_audio()
     global_device.close();
 }
 
+StreamSource * add_stream_source(size_t offset, const std::string & path,
+                                 Media::AudioType type, size_t size)
+{
+    return global_device.add_source(offset, path, type, size);
+}
+
 ALenum get_format(unsigned int channels)
 {
     switch (channels)
@@ -256,6 +346,7 @@ public:
     SoundList sounds;
 
     Sample(FSFile & fp, Media::AudioType type, size_t size);
+    Sample(const unsigned char * data, Media::AudioType type, size_t size);
     ~Sample();
     void add_sound(Sound* sound);
     void remove_sound(Sound* sound);
@@ -300,13 +391,13 @@ public:
     {
         left_gain = right_gain = 1.0;
         pan = 0.0;
-        al_check(alGenSources(1, &source));
-        if (global_device.direct_channels_ext)
-            al_check(alSourcei(source, AL_DIRECT_CHANNELS_SOFT, AL_TRUE));
+        volume = 1.0;
+        pitch = 1.0f;
+        source = global_device.get_source();
         closed = false;
     }
 
-    void set_pitch(float pitch)
+    virtual void set_pitch(float pitch)
     {
         this->pitch = pitch;
         al_check(alSourcef(source, AL_PITCH, pitch));
@@ -317,7 +408,7 @@ public:
         return pitch;
     }
 
-    void set_volume(float value)
+    virtual void set_volume(float value)
     {
         volume = value;
         al_check(alSourcef(source, AL_GAIN, volume));
@@ -328,7 +419,7 @@ public:
         return volume;
     }
 
-    void set_pan(double value)
+    virtual void set_pan(double value)
     {
         if (value > 1.0)
             value = 1.0;
@@ -393,11 +484,10 @@ public:
 
     virtual ~SoundBase()
     {
-        al_check(alSourcei(source, AL_BUFFER, 0));
-        al_check(alDeleteSources(1, &source));
+        global_device.release_source(source);
     }
 
-    void destroy()
+    virtual void destroy()
     {
         stop();
         delete this;
@@ -409,6 +499,19 @@ class Sound : public SoundBase
 public:
     Sample & sample;
 
+    // sounds are created and destroyed on every play
+    static ObjectPool<Sound> pool;
+
+    void * operator new(size_t size)
+    {
+        return pool.create();
+    }
+
+    void operator delete(void * ptr)
+    {
+        pool.destroy(ptr);
+    }
+
     Sound(Sample & sample) : sample(sample), SoundBase()
     {
         al_check(alSourcei(source, AL_BUFFER, sample.buffer.buffer));
@@ -491,8 +594,263 @@ public:
     }
 };
 
-#define LOCK_STREAM SDL_LockMutex(global_device.stream_mutex)
-#define UNLOCK_STREAM SDL_UnlockMutex(global_device.stream_mutex)
+ObjectPool<Sound> Sound::pool;
+
+// where a streamed sound is read from. the decode thread keeps the first
+// PREFETCH_HEAD_SECONDS of PCM, so playback can start without waiting for
+// the decoder
+class StreamSource
+{
+public:
+    size_t offset;
+    std::string path;
+    Media::AudioType type;
+    size_t size;
+
+    signed short * samples;
+    size_t count;
+    bool eof;
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+    SDL_atomic_t ready;
+#endif
+
+    StreamSource(size_t offset, const std::string & path,
+                 Media::AudioType type, size_t size)
+    : offset(offset), path(path), type(type), size(size), samples(NULL),
+      count(0), eof(false)
+    {
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+        SDL_AtomicSet(&ready, 0);
+#endif
+    }
+
+    ~StreamSource()
+    {
+        delete[] samples;
+    }
+
+    SoundDecoder * open(AssetFile & fp)
+    {
+        if (!path.empty()) {
+            fp.open(path.c_str(), "r");
+            return create_decoder(fp, type, size);
+        }
+        fp.open();
+        fp.seek(offset);
+#ifdef CHOWDREN_ASSET_MMAP
+        const unsigned char * data = fp.read_view(size);
+        if (data != NULL)
+            return create_decoder(SoundInput(data, size), type, size);
+#endif
+        return create_decoder(fp, type, size);
+    }
+
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+    bool is_ready()
+    {
+        if (SDL_AtomicGet(&ready) == 0)
+            return false;
+        SDL_MemoryBarrierAcquire();
+        return true;
+    }
+
+    // called from the decode thread
+    void decode_head()
+    {
+        AssetFile fp;
+        SoundDecoder * decoder = open(fp);
+        if (decoder == NULL)
+            return;
+        size_t head_size = PREFETCH_HEAD_SECONDS * decoder->sample_rate *
+                           decoder->channels;
+        samples = new signed short[head_size];
+        count = decoder->read(samples, head_size);
+        eof = count < head_size;
+        delete decoder;
+        SDL_MemoryBarrierRelease();
+        SDL_AtomicSet(&ready, 1);
+    }
+#endif
+};
+
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+
+// decodes a stream ahead of playback on the decode thread. like the wrapped
+// decoder, a read stops short at the end of the sound. when looping, the
+// decode thread continues from the start right away, so the seek(0) that
+// follows the end is skipped
+class PrefetchDecoder : public SoundDecoder
+{
+public:
+    SoundDecoder * decoder;
+    StreamSource * source;
+    SDL_mutex * mutex;
+    SDL_cond * cond;
+    signed short * ring;
+    size_t ring_size;
+    uint64_t read_pos, write_pos;
+    // write positions where the sound ended
+    uint64_t ends[PREFETCH_ENDS];
+    int end_count;
+    // samples covered by the stream head, decoded and thrown away
+    size_t skip;
+    bool at_end, ended, loop;
+    bool seek_pending;
+    double seek_time;
+
+    PrefetchDecoder(SoundDecoder * decoder, StreamSource * source)
+    : decoder(decoder), source(source), loop(false)
+    {
+        samples = decoder->samples;
+        channels = decoder->channels;
+        sample_rate = decoder->sample_rate;
+        ring_size = PREFETCH_SECONDS * sample_rate * channels;
+        ring = new signed short[ring_size];
+        mutex = SDL_CreateMutex();
+        cond = SDL_CreateCond();
+        restart(0.0);
+        global_device.add_prefetch(this);
+    }
+
+    ~PrefetchDecoder()
+    {
+        global_device.remove_prefetch(this);
+        SDL_DestroyCond(cond);
+        SDL_DestroyMutex(mutex);
+        delete[] ring;
+        delete decoder;
+    }
+
+    bool is_valid()
+    {
+        return true;
+    }
+
+    void set_loop(bool value)
+    {
+        SDL_LockMutex(mutex);
+        loop = value;
+        SDL_UnlockMutex(mutex);
+        global_device.wake_decoder();
+    }
+
+    void seek(double value)
+    {
+        SDL_LockMutex(mutex);
+        if (value == 0.0 && ended && loop) {
+            ended = false;
+            SDL_UnlockMutex(mutex);
+            return;
+        }
+        restart(value);
+        SDL_UnlockMutex(mutex);
+        global_device.wake_decoder();
+    }
+
+    size_t read(signed short * data, size_t count)
+    {
+        SDL_LockMutex(mutex);
+        ended = false;
+        size_t got = 0;
+        while (got < count) {
+            if (end_count > 0 && read_pos == ends[0]) {
+                end_count--;
+                for (int i = 0; i < end_count; i++)
+                    ends[i] = ends[i + 1];
+                ended = true;
+                break;
+            }
+            uint64_t limit = write_pos;
+            if (end_count > 0)
+                limit = ends[0];
+            size_t size = std::min<uint64_t>(count - got, limit - read_pos);
+            if (size == 0) {
+                // underrun, wait for the decode thread
+                global_device.wake_decoder();
+                SDL_CondWaitTimeout(cond, mutex, PREFETCH_UPDATE_MS);
+                continue;
+            }
+            size_t start = read_pos % ring_size;
+            size_t first = std::min(size, ring_size - start);
+            memcpy(data + got, ring + start, first * sizeof(signed short));
+            memcpy(data + got + first, ring,
+                   (size - first) * sizeof(signed short));
+            read_pos += size;
+            got += size;
+        }
+        SDL_UnlockMutex(mutex);
+        global_device.wake_decoder();
+        return got;
+    }
+
+    // called with the mutex held
+    void restart(double value)
+    {
+        read_pos = write_pos = 0;
+        end_count = 0;
+        skip = 0;
+        at_end = ended = false;
+        seek_pending = true;
+        seek_time = value;
+        if (value != 0.0 || source == NULL || !source->is_ready())
+            return;
+        // start with the stream head. the decoder is rewound and the head
+        // is decoded again, since seeks are not sample exact
+        size_t count = std::min(source->count, ring_size);
+        memcpy(ring, source->samples, count * sizeof(signed short));
+        write_pos = count;
+        if (source->eof) {
+            at_end = true;
+            ends[end_count++] = write_pos;
+            return;
+        }
+        skip = count;
+    }
+
+    // called from the decode thread, returns true if there was work to do
+    bool fill()
+    {
+        SDL_LockMutex(mutex);
+        if (seek_pending) {
+            seek_pending = false;
+            decoder->seek(seek_time);
+        }
+        if (at_end) {
+            if (!loop || end_count >= PREFETCH_ENDS) {
+                SDL_UnlockMutex(mutex);
+                return false;
+            }
+            decoder->seek(0.0);
+            at_end = false;
+        }
+        size_t space = ring_size - size_t(write_pos - read_pos);
+        if (space < PREFETCH_CHUNK && skip == 0) {
+            SDL_UnlockMutex(mutex);
+            return false;
+        }
+        // decode into free space. skipped samples are overwritten later
+        size_t start = write_pos % ring_size;
+        size_t size = std::min<size_t>(PREFETCH_CHUNK, ring_size - start);
+        if (skip > 0)
+            size = std::min(size, skip);
+        size -= size % channels;
+        size_t got = decoder->read(ring + start, size);
+        if (skip > 0)
+            skip -= got;
+        else
+            write_pos += got;
+        if (got < size) {
+            skip = 0;
+            at_end = true;
+            ends[end_count++] = write_pos;
+        }
+        SDL_CondSignal(cond);
+        SDL_UnlockMutex(mutex);
+        return true;
+    }
+};
+
+#endif // CHOWDREN_IS_EMSCRIPTEN
 
 class SoundStream : public SoundBase
 {
@@ -508,92 +866,119 @@ public:
     bool end_buffers[BUFFER_COUNT];
     bool stopping;
 
-    SoundStream(size_t offset, Media::AudioType type, size_t size)
-    : SoundBase()
-    {
-        fp.open();
-        fp.seek(offset);
-        init(create_decoder(fp, type, size));
-    }
+    // state seen by the game thread while commands are in flight
+    Status requested;
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+    SDL_atomic_t pending;
+    PrefetchDecoder * prefetch;
+#endif
 
-    SoundStream(const std::string & path, Media::AudioType type, size_t size)
+    SoundStream(StreamSource * source)
     : SoundBase()
     {
-        fp.open(path.c_str(), "r");
-        init(create_decoder(fp, type, size));
+        SoundDecoder * decoder = source->open(fp);
+#ifdef CHOWDREN_IS_EMSCRIPTEN
+        file = decoder;
+#else
+        prefetch = new PrefetchDecoder(decoder, source);
+        file = prefetch;
+#endif
+        init();
     }
 
-    void init(SoundDecoder * decoder)
+    void init()
     {
-        file = decoder;
         playing = loop = stopping = false;
+        requested = Stopped;
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+        SDL_AtomicSet(&pending, 0);
+#endif
+        channels = file->channels;
+        sample_rate = file->sample_rate;
         format = get_format(file->channels);
 
         for (int i = 0; i < BUFFER_COUNT; ++i)
             buffers[i].init(file->sample_rate, file->channels, format);
 
-        LOCK_STREAM;
-        global_device.add_stream(this);
-        UNLOCK_STREAM;
+        send(StreamCommand::ADD);
     }
 
     ~SoundStream()
     {
-        stop();
-
-        LOCK_STREAM;
+        stop_stream();
         for (int i = 0; i < BUFFER_COUNT; i++) {
             buffers[i].destroy();
         }
+        delete file;
+    }
 
-        global_device.remove_stream(this);
-        UNLOCK_STREAM;
+    void send(int type, double value = 0.0)
+    {
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+        if (type != StreamCommand::DESTROY)
+            SDL_AtomicAdd(&pending, 1);
+#endif
+        global_device.send(type, this, value);
+    }
 
-        delete file;
+    void destroy()
+    {
+        // the stream thread stops and deletes the stream
+        send(StreamCommand::DESTROY);
     }
 
     void play()
     {
-        // If the sound is already playing (probably paused), just resume it
-        if (playing) {
-            al_check(alSourcePlay(source));
-            return;
-        }
+        requested = Playing;
+        send(StreamCommand::PLAY);
+    }
 
-        // Move to the beginning
-        on_seek(0);
+    void pause()
+    {
+        requested = Paused;
+        send(StreamCommand::PAUSE);
+    }
 
-        samples_processed = 0;
+    void stop()
+    {
+        requested = Stopped;
+        send(StreamCommand::STOP);
+    }
 
-        for (int i = 0; i < BUFFER_COUNT; ++i) {
-            end_buffers[i] = false;
-        }
+    void set_playing_offset(double time)
+    {
+        requested = Playing;
+        send(StreamCommand::SEEK, time);
+    }
 
-        stopping = fill_queue();
-        al_check(alSourcePlay(source));
+    void set_loop(bool loop)
+    {
+        send(StreamCommand::LOOP, loop);
+    }
 
-        playing = true;
+    void set_volume(float value)
+    {
+        volume = value;
+        send(StreamCommand::VOLUME, value);
     }
 
-    void pause()
+    void set_pitch(float value)
     {
-        al_check(alSourcePause(source));
+        pitch = value;
+        send(StreamCommand::PITCH, value);
     }
 
-    void stop()
+    void set_pan(double value)
     {
-        if (!playing)
-            return;
-        LOCK_STREAM;
-        playing = false;
-        UNLOCK_STREAM;
-        al_check(alSourceStop(source));
-        clear_queue();
-        al_check(alSourcei(source, AL_BUFFER, 0));
+        send(StreamCommand::PAN, value);
     }
 
     Status get_status()
     {
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+        if (SDL_AtomicGet(&pending) > 0)
+            return requested;
+#endif
         Status status = SoundBase::get_status();
 
         // To compensate for the lag between play() and alSourceplay()
@@ -603,22 +988,6 @@ public:
         return status;
     }
 
-    void set_playing_offset(double time)
-    {
-        LOCK_STREAM;
-        al_check(alSourceStop(source));
-        clear_queue();
-        al_check(alSourcei(source, AL_BUFFER, 0));
-        on_seek(time);
-        samples_processed = static_cast<uint64_t>(
-            time * file->sample_rate * file->channels);
-        for (int i = 0; i < BUFFER_COUNT; ++i)
-            end_buffers[i] = false;
-        stopping = fill_queue();
-        al_check(alSourcePlay(source));
-        UNLOCK_STREAM;
-    }
-
     double get_playing_offset()
     {
         ALfloat secs = 0.0f;
@@ -632,11 +1001,6 @@ public:
         return double(file->samples) / file->sample_rate / channels;
     }
 
-    void set_loop(bool loop)
-    {
-        this->loop = loop;
-    }
-
     bool get_loop()
     {
         return loop;
@@ -647,6 +1011,91 @@ public:
         return file->sample_rate;
     }
 
+    // called from the stream thread
+
+    void run(const StreamCommand & command)
+    {
+        switch (command.type) {
+            case StreamCommand::PLAY:
+                start_stream();
+                break;
+            case StreamCommand::PAUSE:
+                al_check(alSourcePause(source));
+                break;
+            case StreamCommand::STOP:
+                stop_stream();
+                break;
+            case StreamCommand::SEEK:
+                seek_stream(command.value);
+                break;
+            case StreamCommand::LOOP:
+                loop = command.value != 0.0;
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+                prefetch->set_loop(loop);
+#endif
+                break;
+            case StreamCommand::VOLUME:
+                SoundBase::set_volume(command.value);
+                break;
+            case StreamCommand::PITCH:
+                SoundBase::set_pitch(command.value);
+                break;
+            case StreamCommand::PAN:
+                SoundBase::set_pan(command.value);
+                break;
+        }
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+        SDL_AtomicAdd(&pending, -1);
+#endif
+    }
+
+    void start_stream()
+    {
+        // If the sound is already playing (probably paused), just resume it
+        if (playing) {
+            al_check(alSourcePlay(source));
+            return;
+        }
+
+        // Move to the beginning
+        on_seek(0);
+
+        samples_processed = 0;
+
+        for (int i = 0; i < BUFFER_COUNT; ++i) {
+            end_buffers[i] = false;
+        }
+
+        stopping = fill_queue();
+        al_check(alSourcePlay(source));
+
+        playing = true;
+    }
+
+    void stop_stream()
+    {
+        if (!playing)
+            return;
+        playing = false;
+        al_check(alSourceStop(source));
+        clear_queue();
+        al_check(alSourcei(source, AL_BUFFER, 0));
+    }
+
+    void seek_stream(double time)
+    {
+        al_check(alSourceStop(source));
+        clear_queue();
+        al_check(alSourcei(source, AL_BUFFER, 0));
+        on_seek(time);
+        samples_processed = static_cast<uint64_t>(
+            time * file->sample_rate * file->channels);
+        for (int i = 0; i < BUFFER_COUNT; ++i)
+            end_buffers[i] = false;
+        stopping = fill_queue();
+        al_check(alSourcePlay(source));
+    }
+
     void update()
     {
         if (!playing)
@@ -661,7 +1110,7 @@ public:
         // The stream has been interrupted!
         if (status == AL_STOPPED) {
             if (stopping) {
-                stop();
+                stop_stream();
                 return;
             } else
                 al_check(alSourcePlay(source));
@@ -772,10 +1221,8 @@ public:
 
     void update_stereo_pan()
     {
-        LOCK_STREAM;
         for (int i = 0; i < BUFFER_COUNT; i++)
             buffers[i].set_pan(left_gain, right_gain);
-        UNLOCK_STREAM;
     }
 };
 
@@ -787,6 +1234,17 @@ void AudioDevice::open()
     streaming_thread = NULL;
     device = NULL;
     context = NULL;
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+    source_mutex = SDL_CreateMutex();
+    stream_mutex = SDL_CreateMutex();
+    stream_cond = NULL;
+    decode_thread = NULL;
+    decode_mutex = SDL_CreateMutex();
+    decode_cond = SDL_CreateCond();
+    decode_closing = false;
+    head_index = 0;
+    head_memory = 0;
+#endif
 
     device = alcOpenDevice(NULL);
     if (!device) {
@@ -824,33 +1282,162 @@ void AudioDevice::open()
             << "AL_SOFT_buffer_sub_data" << std::endl;
     }
 
+    for (int i = 0; i < SOURCE_POOL_SIZE; i++)
+        free_sources.push_back(create_source());
+
 #ifdef CHOWDREN_IS_EMSCRIPTEN
     stream_update();
 #else
-    stream_mutex = SDL_CreateMutex();
+    SDL_AtomicSet(&command_read, 0);
+    SDL_AtomicSet(&command_write, 0);
+    stream_cond = SDL_CreateCond();
     streaming_thread = SDL_CreateThread(_stream_update, "Stream thread",
                                         (void*)this);
+    decode_thread = SDL_CreateThread(_decode_update, "Decode thread",
+                                     (void*)this);
 #endif
 }
 
 void AudioDevice::close()
 {
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+    SDL_LockMutex(stream_mutex);
+#endif
     closing = true;
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+    if (stream_cond != NULL)
+        SDL_CondSignal(stream_cond);
+    SDL_UnlockMutex(stream_mutex);
+#endif
     if (streaming_thread != NULL) {
+        // the stream thread runs the remaining commands before it exits
         int ret;
         SDL_WaitThread(streaming_thread, &ret);
+        streaming_thread = NULL;
     }
 
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+    if (decode_thread != NULL) {
+        SDL_LockMutex(decode_mutex);
+        decode_closing = true;
+        SDL_CondSignal(decode_cond);
+        SDL_UnlockMutex(decode_mutex);
+        int ret;
+        SDL_WaitThread(decode_thread, &ret);
+        decode_thread = NULL;
+    }
+#endif
+
+    vector<StreamSource*>::const_iterator it;
+    for (it = sources.begin(); it != sources.end(); ++it)
+        delete *it;
+    sources.clear();
+
     if (device != NULL) {
+        if (!free_sources.empty())
+            al_check(alDeleteSources(free_sources.size(), &free_sources[0]));
+        free_sources.clear();
         alcMakeContextCurrent(NULL);
         if (context != NULL)
             alcDestroyContext(context);
         alcCloseDevice(device);
     }
 
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+    if (stream_cond != NULL)
+        SDL_DestroyCond(stream_cond);
     SDL_DestroyMutex(stream_mutex);
+    SDL_DestroyMutex(source_mutex);
+    SDL_DestroyCond(decode_cond);
+    SDL_DestroyMutex(decode_mutex);
+#endif
+}
+
+StreamSource * AudioDevice::add_source(size_t offset, const std::string & path,
+                                       Media::AudioType type, size_t size)
+{
+    StreamSource * source = new StreamSource(offset, path, type, size);
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+    SDL_LockMutex(decode_mutex);
+#endif
+    sources.push_back(source);
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+    SDL_CondSignal(decode_cond);
+    SDL_UnlockMutex(decode_mutex);
+#endif
+    return source;
+}
+
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+
+void AudioDevice::decode_update()
+{
+    TRACE_THREAD("Audio decode");
+    SDL_LockMutex(decode_mutex);
+    while (!decode_closing) {
+        bool busy = false;
+        {
+            TRACE_ZONE("decode_update");
+            vector<PrefetchDecoder*>::const_iterator it;
+            for (it = prefetchers.begin(); it != prefetchers.end(); ++it) {
+                if ((*it)->fill())
+                    busy = true;
+            }
+        }
+        if (busy) {
+            // let the other threads add and remove streams
+            SDL_UnlockMutex(decode_mutex);
+            SDL_LockMutex(decode_mutex);
+            continue;
+        }
+
+        // when idle, decode the start of the next streamed sound
+        if (head_index < sources.size() &&
+            head_memory < CHOWDREN_STREAM_HEAD_MEMORY)
+        {
+            StreamSource * source = sources[head_index++];
+            SDL_UnlockMutex(decode_mutex);
+            source->decode_head();
+            SDL_LockMutex(decode_mutex);
+            head_memory += source->count * sizeof(signed short);
+            continue;
+        }
+
+        SDL_CondWaitTimeout(decode_cond, decode_mutex, PREFETCH_UPDATE_MS);
+    }
+    SDL_UnlockMutex(decode_mutex);
+}
+
+int AudioDevice::_decode_update(void * data)
+{
+    ((AudioDevice*)data)->decode_update();
+    return 1;
+}
+
+void AudioDevice::add_prefetch(PrefetchDecoder * decoder)
+{
+    SDL_LockMutex(decode_mutex);
+    prefetchers.push_back(decoder);
+    SDL_CondSignal(decode_cond);
+    SDL_UnlockMutex(decode_mutex);
 }
 
+void AudioDevice::remove_prefetch(PrefetchDecoder * decoder)
+{
+    SDL_LockMutex(decode_mutex);
+    prefetchers.erase(std::remove(prefetchers.begin(), prefetchers.end(),
+                                  decoder),
+                      prefetchers.end());
+    SDL_UnlockMutex(decode_mutex);
+}
+
+void AudioDevice::wake_decoder()
+{
+    SDL_CondSignal(decode_cond);
+}
+
+#endif // CHOWDREN_IS_EMSCRIPTEN
+
 void AudioDevice::stream_update()
 {
 #ifdef CHOWDREN_IS_EMSCRIPTEN
@@ -861,13 +1448,26 @@ void AudioDevice::stream_update()
         (*it)->update();
     emscripten_async_call(_stream_update, (void*)this, 125);
 #else
-    while (!closing) {
+    TRACE_THREAD("Audio stream");
+    while (true) {
+        run_commands();
+        {
+            TRACE_ZONE("stream_update");
+            vector<SoundStream*>::const_iterator it;
+            for (it = streams.begin(); it != streams.end(); ++it)
+                (*it)->update();
+        }
+
+        // sleep until the next refill, or until the game sends a command
         SDL_LockMutex(stream_mutex);
-        vector<SoundStream*>::const_iterator it;
-        for (it = streams.begin(); it != streams.end(); ++it)
-            (*it)->update();
+        if (SDL_AtomicGet(&command_read) == SDL_AtomicGet(&command_write)) {
+            if (closing) {
+                SDL_UnlockMutex(stream_mutex);
+                break;
+            }
+            SDL_CondWaitTimeout(stream_cond, stream_mutex, STREAM_UPDATE_MS);
+        }
         SDL_UnlockMutex(stream_mutex);
-        platform_sleep(0.125);
     }
 #endif
 }
@@ -878,15 +1478,112 @@ int AudioDevice::_stream_update(void * data)
     return 1;
 }
 
-void AudioDevice::add_stream(SoundStream * stream)
+void AudioDevice::send(int type, SoundStream * stream, double value)
+{
+    StreamCommand command;
+    command.type = type;
+    command.stream = stream;
+    command.value = value;
+#ifdef CHOWDREN_IS_EMSCRIPTEN
+    run_command(command);
+#else
+    if (streaming_thread == NULL) {
+        run_command(command);
+        return;
+    }
+    int write = SDL_AtomicGet(&command_write);
+    while (write - SDL_AtomicGet(&command_read) >= STREAM_COMMAND_COUNT) {
+        // queue is full, wait for the stream thread to catch up
+        SDL_CondSignal(stream_cond);
+        platform_sleep(0.001);
+    }
+    commands[write & (STREAM_COMMAND_COUNT - 1)] = command;
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&command_write, write + 1);
+
+    SDL_LockMutex(stream_mutex);
+    SDL_CondSignal(stream_cond);
+    SDL_UnlockMutex(stream_mutex);
+#endif
+}
+
+void AudioDevice::run_command(const StreamCommand & command)
+{
+    SoundStream * stream = command.stream;
+    switch (command.type) {
+        case StreamCommand::ADD:
+            streams.push_back(stream);
+            break;
+        case StreamCommand::DESTROY:
+            streams.erase(std::remove(streams.begin(), streams.end(), stream),
+                          streams.end());
+            delete stream;
+            break;
+        default:
+            stream->run(command);
+            break;
+    }
+}
+
+void AudioDevice::run_commands()
+{
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+    int read = SDL_AtomicGet(&command_read);
+    while (read != SDL_AtomicGet(&command_write)) {
+        SDL_MemoryBarrierAcquire();
+        StreamCommand command = commands[read & (STREAM_COMMAND_COUNT - 1)];
+        read++;
+        SDL_AtomicSet(&command_read, read);
+        run_command(command);
+    }
+#endif
+}
+
+ALuint AudioDevice::create_source()
+{
+    ALuint source;
+    al_check(alGenSources(1, &source));
+    if (direct_channels_ext)
+        al_check(alSourcei(source, AL_DIRECT_CHANNELS_SOFT, AL_TRUE));
+    return source;
+}
+
+ALuint AudioDevice::get_source()
 {
-    streams.push_back(stream);
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+    SDL_LockMutex(source_mutex);
+#endif
+    bool empty = free_sources.empty();
+    ALuint source = 0;
+    if (!empty) {
+        source = free_sources.back();
+        free_sources.pop_back();
+    }
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+    SDL_UnlockMutex(source_mutex);
+#endif
+    if (empty)
+        source = create_source();
+    return source;
 }
 
-void AudioDevice::remove_stream(SoundStream * stream)
+void AudioDevice::release_source(ALuint source)
 {
-    streams.erase(std::remove(streams.begin(), streams.end(), stream),
-                  streams.end());
+    // reset to the state of a new source
+    al_check(alSourceStop(source));
+    al_check(alSourcei(source, AL_BUFFER, 0));
+    al_check(alSourcei(source, AL_LOOPING, AL_FALSE));
+    al_check(alSourcef(source, AL_GAIN, 1.0f));
+    al_check(alSourcef(source, AL_PITCH, 1.0f));
+    al_check(alSourcef(source, AL_SEC_OFFSET, 0.0f));
+    al_check(alSource3f(source, AL_POSITION, 0.0f, 0.0f, 0.0f));
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+    SDL_LockMutex(source_mutex);
+#endif
+    free_sources.push_back(source);
+#ifndef CHOWDREN_IS_EMSCRIPTEN
+    SDL_UnlockMutex(source_mutex);
+#endif
 }
 
 class Listener
@@ -916,6 +1613,16 @@ Sample::Sample(FSFile & fp, Media::AudioType type, size_t size)
     delete file;
 }
 
+Sample::Sample(const unsigned char * data, Media::AudioType type,
+               size_t size)
+{
+    SoundDecoder * file = create_decoder(SoundInput(data, size), type, size);
+    channels = file->channels;
+    sample_rate = file->sample_rate;
+    buffer.init(*file, file->samples);
+    delete file;
+}
+
 Sample::~Sample()
 {
     SoundList::const_iterator it;
@@ -5,6 +5,7 @@
 #include "../include_gl.h"
 #include "../manager.h"
 #include "../mathcommon.h"
+#include "../render.h"
 #include <tinythread/tinythread.h>
 #include <iostream>
 
@@ -131,6 +132,7 @@ void platform_begin_draw()
 
 void platform_swap_buffers()
 {
+    Render::flush(Render::FLUSH_FRAME_END);
 }
 
 void platform_get_size(int * width, int * height)
@@ -247,6 +249,12 @@ bool platform_remove_file(const std::string & file)
     return remove(convert_path(file).c_str()) == 0;
 }
 
+bool platform_rename_file(const std::string & src, const std::string & dst)
+{
+    return rename(convert_path(src).c_str(),
+                  convert_path(dst).c_str()) == 0;
+}
+
 #include "fileio.cpp"
 
 #define HANDLE_BASE StandardFile
@@ -1,5 +1,6 @@
 #include "fbo.h"
 #include "chowconfig.h"
+#include "render.h"
 
 static Framebuffer * current_fbo = NULL;
 
@@ -20,7 +21,7 @@ void Framebuffer::init(int w, int h)
 {
     // for fullscreen or window resize
     glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
+    set_tex(tex);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE,
                  NULL);
 #ifdef CHOWDREN_POINT_FILTER
@@ -39,8 +40,15 @@ void Framebuffer::init(int w, int h)
     unbind();
 }
 
+void Framebuffer::destroy()
+{
+    Render::delete_tex(tex);
+    glDeleteFramebuffers(1, &fbo);
+}
+
 void Framebuffer::bind()
 {
+    Render::flush(Render::FLUSH_TARGET);
     old_fbo = current_fbo;
     current_fbo = this;
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
@@ -48,6 +56,7 @@ void Framebuffer::bind()
 
 void Framebuffer::unbind()
 {
+    Render::flush(Render::FLUSH_TARGET);
     if (old_fbo == NULL)
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
     else
@@ -14,6 +14,7 @@ public:
     Framebuffer();
     ~Framebuffer();
     void init(int w, int h);
+    void destroy();
     void bind();
     void unbind();
     GLuint get_tex();
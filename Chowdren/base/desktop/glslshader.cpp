@@ -178,6 +178,7 @@ int BaseShader::get_uniform(const char * value)
 #define set_blend_eqs(a, b) glBlendEquationSeparate(a, b)
 #define set_blend_eq(a) glBlendEquation(a)
 #define set_blend_func(a, b) glBlendFunc(a, b)
+#define set_blend_funcs(a, b, c, d) glBlendFuncSeparate(a, b, c, d)
 #define commit_parameters(x)
 
 #include "shadercommon.cpp"
@@ -19,6 +19,7 @@
 #include <boost/cstdint.hpp>
 #include "path.h"
 #include "render.h"
+#include "benchmark.h"
 
 #define CHOWDREN_EXTRA_BILINEAR
 
@@ -53,6 +54,7 @@ PFNGLCLIENTACTIVETEXTUREARBPROC __glClientActiveTextureARB;
 PFNGLGENFRAMEBUFFERSEXTPROC __glGenFramebuffersEXT;
 PFNGLFRAMEBUFFERTEXTURE2DEXTPROC __glFramebufferTexture2DEXT;
 PFNGLBINDFRAMEBUFFEREXTPROC __glBindFramebufferEXT;
+PFNGLDELETEFRAMEBUFFERSEXTPROC __glDeleteFramebuffersEXT;
 
 PFNGLUSEPROGRAMOBJECTARBPROC __glUseProgramObjectARB;
 PFNGLDETACHOBJECTARBPROC __glDetachObjectARB;
@@ -354,6 +356,11 @@ void platform_create_display(bool fullscreen)
 #endif
 
     int flags = SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE;
+#ifdef CHOWDREN_BENCHMARK
+    // benchmark frames are only drawn to the screen FBO
+    if (Benchmark::enabled && !Benchmark::recording)
+        flags |= SDL_WINDOW_HIDDEN;
+#endif
     if (fullscreen) {
         flags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
     }
@@ -419,6 +426,9 @@ void platform_create_display(bool fullscreen)
     __glBindFramebufferEXT =
         (PFNGLBINDFRAMEBUFFEREXTPROC)
         SDL_GL_GetProcAddress("glBindFramebufferEXT");
+    __glDeleteFramebuffersEXT =
+        (PFNGLDELETEFRAMEBUFFERSEXTPROC)
+        SDL_GL_GetProcAddress("glDeleteFramebuffersEXT");
 
     // shaders
     __glUniform1iARB =
@@ -643,6 +653,7 @@ void platform_swap_buffers()
         Render::disable_effect();
 #endif
 
+    Render::flush(Render::FLUSH_FRAME_END);
     SDL_GL_SwapWindow(global_window);
 }
 
@@ -1252,6 +1263,18 @@ bool platform_remove_file(const std::string & file)
     return remove(convert_path(file).c_str()) == 0;
 }
 
+bool platform_rename_file(const std::string & src, const std::string & dst)
+{
+    std::string src_path = convert_path(src);
+    std::string dst_path = convert_path(dst);
+#ifdef _WIN32
+    return MoveFileExA(src_path.c_str(), dst_path.c_str(),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(src_path.c_str(), dst_path.c_str()) == 0;
+#endif
+}
+
 #include "fileio.cpp"
 #include "stdiofile.cpp"
 
@@ -1274,7 +1297,15 @@ std::string convert_path(const std::string & v)
 
 void platform_print_stats()
 {
-
+    const RenderStats & stats = Render::stats;
+    std::cout << "Render: " << stats.quads << " quads, "
+        << stats.draw_calls << " draw calls" << std::endl;
+    for (int i = 0; i < Render::FLUSH_REASON_MAX; i++) {
+        if (stats.flushes[i] == 0)
+            continue;
+        std::cout << "    " << RenderStats::get_reason_name(i) << ": "
+            << stats.flushes[i] << std::endl;
+    }
 }
 
 
@@ -44,9 +44,16 @@ void Render::init()
     glEnableClientState(GL_TEXTURE_COORD_ARRAY);
     glTexCoordPointer(2, GL_FLOAT, 0, (void*)&render_data.texcoord1[0]); 
 
+    // the second set of texcoords is constant, so fill it for the whole
+    // batch up front
+    for (int i = 0; i < RENDER_BUFFER; i++) {
+        memcpy(&render_data.texcoord2[i * 12], &render_texcoords2[0],
+               sizeof(render_texcoords2));
+    }
+
     glClientActiveTexture(GL_TEXTURE1);
     glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-    glTexCoordPointer(2, GL_FLOAT, 0, (void*)&render_texcoords2[0]);
+    glTexCoordPointer(2, GL_FLOAT, 0, (void*)&render_data.texcoord2[0]);
 
     glClientActiveTexture(GL_TEXTURE0);
 
@@ -66,4 +73,9 @@ void Render::init()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
     render_data.last_tex = 0;
+    render_data.quads = 0;
+    render_data.effect = NONE;
+    render_data.batch_effect = -1;
+    render_data.blend = render_data.batch_blend = true;
+    stats.reset();
 }
@@ -2,26 +2,43 @@
 #include "shadercommon.h"
 #include "mathcommon.h"
 
-// XXX consider merging drawcalls
-#define RENDER_BUFFER 1
+// number of quads that are accumulated before a draw call is forced
+#define RENDER_BUFFER 2048
 
 struct RenderData
 {
     Texture last_tex, white_tex, back_tex;
     int effect;
+    // effect whose shader/blend state is currently applied to the context
+    int batch_effect;
+    bool blend, batch_blend;
     float trans_x, trans_y;
     float pos_x, pos_y;
     int viewport[4];
-    float positions[(RENDER_BUFFER * 3) * 6];
+    int quads;
+    float positions[(RENDER_BUFFER * 2) * 6];
     unsigned int colors[RENDER_BUFFER * 6];
     float texcoord1[(RENDER_BUFFER * 2) * 6];
+    float texcoord2[(RENDER_BUFFER * 2) * 6];
 };
 
 extern RenderData render_data;
 
+inline void Render::flush(int reason)
+{
+    int quads = render_data.quads;
+    if (quads <= 0)
+        return;
+    glDrawArrays(GL_TRIANGLES, 0, quads * 6);
+    render_data.quads = 0;
+    stats.draw_calls++;
+    stats.flushes[reason]++;
+}
+
 inline void set_tex(Texture t)
 {
     if (render_data.last_tex != t) {
+        Render::flush(Render::FLUSH_TEXTURE);
         glBindTexture(GL_TEXTURE_2D, t);
         render_data.last_tex = t;
     }
@@ -37,6 +54,7 @@ inline void Render::set_offset(int x, int y)
 
 inline void Render::set_view(int x, int y, int w, int h)
 {
+    flush(FLUSH_VIEW);
     glViewport(x, y, w, h);
     render_data.viewport[0] = x;
     render_data.viewport[1] = y;
@@ -49,6 +67,7 @@ inline void Render::set_view(int x, int y, int w, int h)
 
 inline void Render::clear(Color color)
 {
+    flush(FLUSH_CLEAR);
     glClearColor(color.r / 255.0f, color.g / 255.0f, color.b / 255.0f,
                  1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
@@ -90,11 +109,35 @@ inline Texture Render::create_tex(void * pixels, Format f,
     return tex;
 }
 
+inline void Render::update_tex(Texture tex, void * pixels, Format f,
+                               int x, int y, int width, int height)
+{
+    flush(FLUSH_TEXTURE);
+    set_tex(tex);
+
+    GLenum format;
+    switch (f) {
+        case RGBA:
+            format = GL_RGBA;
+            break;
+        case L:
+            format = GL_ALPHA;
+            break;
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, format,
+                    GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
 inline void Render::delete_tex(Texture tex)
 {
-    glDeleteTextures(1, &tex);
-    if (render_data.last_tex == tex)
+    if (render_data.last_tex == tex) {
+        flush(FLUSH_TEXTURE);
         render_data.last_tex = 0;
+    }
+    glDeleteTextures(1, &tex);
 }
 
 inline float transform_x(float x)
@@ -109,7 +152,7 @@ inline float transform_y(float y)
 
 inline void insert_quad(float * p)
 {
-    float * pp = &render_data.positions[0];
+    float * pp = &render_data.positions[render_data.quads * 12];
 
     // triangle 1
     float x1 = transform_x(p[0]);
@@ -141,7 +184,7 @@ inline void insert_quad(int x1, int y1, int x2, int y2)
     float fy1 = transform_y(y1);
     float fy2 = transform_y(y2);
 
-    float * p = &render_data.positions[0];
+    float * p = &render_data.positions[render_data.quads * 12];
 
     // 1
     *p++ = fx1; *p++ = fy1;
@@ -160,7 +203,7 @@ inline void insert_color(Color c)
     // rely on endianness
     memcpy(&cc, &c, sizeof(Color));
 
-    unsigned int * p = &render_data.colors[0];
+    unsigned int * p = &render_data.colors[render_data.quads * 6];
     for (int i = 0; i < 6; ++i)
         *p++ = cc;
 }
@@ -172,7 +215,7 @@ inline void insert_horizontal_color(Color c1, Color c2)
     memcpy(&cc1, &c1, sizeof(Color));
     memcpy(&cc2, &c2, sizeof(Color));
 
-    unsigned int * p = &render_data.colors[0];
+    unsigned int * p = &render_data.colors[render_data.quads * 6];
     *p++ = cc1;
     *p++ = cc2;
     *p++ = cc2;
@@ -188,7 +231,7 @@ inline void insert_vertical_color(Color c1, Color c2)
     memcpy(&cc1, &c1, sizeof(Color));
     memcpy(&cc2, &c2, sizeof(Color));
 
-    unsigned int * p = &render_data.colors[0];
+    unsigned int * p = &render_data.colors[render_data.quads * 6];
     *p++ = cc1;
     *p++ = cc1;
     *p++ = cc2;
@@ -210,13 +253,13 @@ const float render_texcoords[12] = {
 
 inline void insert_texcoord1()
 {
-    memcpy(&render_data.texcoord1[0], &render_texcoords[0],
-           sizeof(render_texcoords));
+    memcpy(&render_data.texcoord1[render_data.quads * 12],
+           &render_texcoords[0], sizeof(render_texcoords));
 }
 
 inline void insert_texcoord1(float fx1, float fy1, float fx2, float fy2)
 {
-    float * p = &render_data.texcoord1[0];
+    float * p = &render_data.texcoord1[render_data.quads * 12];
 
     // 1
     *p++ = fx1; *p++ = fy1;
@@ -231,13 +274,32 @@ inline void insert_texcoord1(float fx1, float fy1, float fx2, float fy2)
 
 inline void begin_draw(Texture t)
 {
-    if (render_data.effect == Render::NONE)
-        shader_set_texture();
+    if (render_data.batch_effect != render_data.effect) {
+        Render::flush(Render::FLUSH_EFFECT);
+        if (render_data.effect == Render::NONE)
+            shader_set_texture();
+        render_data.batch_effect = render_data.effect;
+    }
 
-    if (render_data.last_tex != t) {
-        glBindTexture(GL_TEXTURE_2D, t);
-        render_data.last_tex = t;
+    if (render_data.batch_blend != render_data.blend) {
+        Render::flush(Render::FLUSH_BLEND);
+        if (render_data.blend)
+            glEnable(GL_BLEND);
+        else
+            glDisable(GL_BLEND);
+        render_data.batch_blend = render_data.blend;
     }
+
+    set_tex(t);
+
+    if (render_data.quads >= RENDER_BUFFER)
+        Render::flush(Render::FLUSH_FULL);
+}
+
+inline void end_draw()
+{
+    render_data.quads++;
+    Render::stats.quads++;
 }
 
 inline void Render::draw_quad(int x1, int y1, int x2, int y2, Color c)
@@ -258,7 +320,7 @@ inline void Render::draw_tex(int x1, int y1, int x2, int y2, Color c,
     insert_quad(x1, y1, x2, y2);
     insert_color(c);
     insert_texcoord1();
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    end_draw();
 }
 
 inline void Render::draw_tex(int x1, int y1, int x2, int y2, Color c,
@@ -270,7 +332,7 @@ inline void Render::draw_tex(int x1, int y1, int x2, int y2, Color c,
     insert_quad(x1, y1, x2, y2);
     insert_color(c);
     insert_texcoord1(tx1, ty1, tx2, ty2);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    end_draw();
 }
 
 inline void Render::draw_tex(float * p, Color c, Texture t)
@@ -280,7 +342,18 @@ inline void Render::draw_tex(float * p, Color c, Texture t)
     insert_color(c);
     insert_texcoord1();
     insert_quad(p);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    end_draw();
+}
+
+inline void Render::draw_tex(float * p, Color c, Texture t,
+                             float tx1, float ty1, float tx2, float ty2)
+{
+    begin_draw(t);
+
+    insert_color(c);
+    insert_texcoord1(tx1, ty1, tx2, ty2);
+    insert_quad(p);
+    end_draw();
 }
 
 inline void Render::draw_horizontal_gradient(int x1, int y1, int x2, int y2,
@@ -291,7 +364,7 @@ inline void Render::draw_horizontal_gradient(int x1, int y1, int x2, int y2,
     insert_quad(x1, y1, x2, y2);
     insert_horizontal_color(c1, c2);
     insert_texcoord1();
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    end_draw();
 }
 
 inline void Render::draw_vertical_gradient(int x1, int y1, int x2, int y2,
@@ -302,19 +375,25 @@ inline void Render::draw_vertical_gradient(int x1, int y1, int x2, int y2,
     insert_quad(x1, y1, x2, y2);
     insert_vertical_color(c1, c2);
     insert_texcoord1();
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    end_draw();
 }
 
 inline void Render::set_effect(int effect, FrameObject * obj,
                                int width, int height)
 {
-    render_data.effect = effect;
+    // object effects carry per-instance parameters, so never merge these
+    flush(FLUSH_EFFECT);
+    render_data.effect = render_data.batch_effect = effect;
     shader_set_effect(effect, obj, width, height);
 }
 
 inline void Render::set_effect(int effect)
 {
     render_data.effect = effect;
+    if (render_data.batch_effect == effect)
+        return;
+    flush(FLUSH_EFFECT);
+    render_data.batch_effect = effect;
     shader_set_effect(effect, NULL, 0, 0);
 }
 
@@ -330,6 +409,7 @@ inline Texture Render::copy_rect(int x1, int y1, int x2, int y2)
 
     int y = WINDOW_HEIGHT - y2;
 
+    flush(FLUSH_READBACK);
     set_tex(render_data.back_tex);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height,
                  0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
@@ -337,18 +417,39 @@ inline Texture Render::copy_rect(int x1, int y1, int x2, int y2)
     return render_data.back_tex;
 }
 
+inline void Render::begin_external()
+{
+    flush(FLUSH_EXTERNAL);
+}
+
+inline void Render::end_external()
+{
+    flush(FLUSH_EXTERNAL);
+    render_data.last_tex = 0;
+    render_data.batch_effect = -1;
+    if (render_data.batch_blend)
+        glEnable(GL_BLEND);
+    else
+        glDisable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+// blend state is applied lazily in begin_draw(), so runs of opaque quads
+// can share a batch
+
 inline void Render::enable_blend()
 {
-    glEnable(GL_BLEND);
+    render_data.blend = true;
 }
 
 inline void Render::disable_blend()
 {
-    glDisable(GL_BLEND);
+    render_data.blend = false;
 }
 
 inline void Render::enable_scissor(int x, int y, int w, int h)
 {
+    flush(FLUSH_SCISSOR);
     glEnable(GL_SCISSOR_TEST);
 
     int w_x1 = int(x + offset[0]);
@@ -366,5 +467,6 @@ inline void Render::enable_scissor(int x, int y, int w, int h)
 
 inline void Render::disable_scissor()
 {
+    flush(FLUSH_SCISSOR);
     glDisable(GL_SCISSOR_TEST);
 }
\ No newline at end of file
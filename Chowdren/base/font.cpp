@@ -3,25 +3,44 @@
 #ifdef CHOWDREN_USE_FT2
 
 #include <wctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 #include <iostream>
 #include "platform.h"
 #include "assetfile.h"
+#include "trace.h"
 
 // front-end font loader
 
+static void read_fonts(BaseStream & stream, FontList & fonts)
+{
+    unsigned int count = stream.read_uint32();
+    for (unsigned int i = 0; i < count; i++) {
+        FTTextureFont * font = new FTTextureFont(stream);
+        fonts.push_back(font);
+    }
+}
+
 bool load_fonts(FontList & fonts)
 {
+    TRACE_ZONE("load_fonts");
     AssetFile fp;
     fp.open();
     FileStream stream(fp);
 
     for (int i = 0; i < FONT_COUNT; i++) {
         fp.set_item(i, AssetFile::FONT_DATA);
-        unsigned int count = stream.read_uint32();
-        for (unsigned int i = 0; i < count; i++) {
-            FTTextureFont * font = new FTTextureFont(stream);
-            fonts.push_back(font);
+#ifdef CHOWDREN_ASSET_MMAP
+        size_t size;
+        const unsigned char * data = fp.get_view(&size);
+        if (data != NULL) {
+            ArrayStream view((const char*)data, size);
+            read_fonts(view, fonts);
+            continue;
         }
+#endif
+        read_fonts(stream, fonts);
     }
     return fonts.size() > 0;
 }
@@ -380,7 +399,8 @@ template <typename T>
 inline FTPoint FTTextureFont::RenderI(const T* string, const int len,
                                       FTPoint position, FTPoint spacing)
 {
-    Render::set_effect(Render::FONT);
+    if (mesh == NULL)
+        Render::set_effect(Render::FONT);
     // for multibyte - we can't rely on sizeof(T) == character
     FTUnicodeStringItr<T> ustr(string);
 
@@ -398,7 +418,8 @@ inline FTPoint FTTextureFont::RenderI(const T* string, const int len,
         }
     }
 
-    Render::disable_effect();
+    if (mesh == NULL)
+        Render::disable_effect();
 
     return position;
 }
@@ -418,34 +439,161 @@ FTPoint FTTextureFont::Render(const wchar_t * string, const int len,
     return RenderI(string, len, position, spacing);
 }
 
+void FTTextureFont::BuildMesh(const char * string, const int len,
+                              TextMesh & target)
+{
+    target.clear();
+    mesh = &target;
+    Render(string, len, FTPoint(), FTPoint());
+    mesh = NULL;
+    target.finish();
+}
+
+// TextMesh
+
+inline bool sort_quad_comp(const TextQuad & q1, const TextQuad & q2)
+{
+    return q1.tex < q2.tex;
+}
+
+void TextMesh::finish()
+{
+    // group the quads by atlas page, so a mesh spanning several pages is
+    // drawn with one batch per page. the glyphs all have the same color,
+    // so the draw order within the mesh does not matter
+    std::stable_sort(quads.begin(), quads.end(), sort_quad_comp);
+    valid = true;
+}
+
+void TextMesh::draw(int x, int y, Color color)
+{
+    vector<TextQuad>::const_iterator it;
+    for (it = quads.begin(); it != quads.end(); ++it) {
+        const TextQuad & q = *it;
+        Render::draw_tex(x + q.x1, y + q.y1, x + q.x2, y + q.y2, color,
+                         q.tex, q.u1, q.v1, q.u2, q.v2);
+    }
+}
+
 
 // FTTextureFont
 
 Color FTTextureFont::color;
+TextMesh * FTTextureFont::mesh = NULL;
 
-static inline GLuint ClampSize(GLuint in, GLuint maxTextureSize)
+// FontPage
+
+FontPage::FontPage()
+: dirty_y1(FONT_PAGE_SIZE), dirty_y2(0)
 {
-    // Find next power of two
-    --in;
-    in |= in >> 16;
-    in |= in >> 8;
-    in |= in >> 4;
-    in |= in >> 2;
-    in |= in >> 1;
-    ++in;
+    pixels = (unsigned char*)calloc(FONT_PAGE_SIZE * FONT_PAGE_SIZE, 1);
+    tex = Render::create_tex(pixels, Render::L, FONT_PAGE_SIZE,
+                             FONT_PAGE_SIZE);
+    Render::set_filter(tex, true);
+    SkylineNode node = {0, 0, FONT_PAGE_SIZE};
+    skyline.push_back(node);
+}
 
-    // Clamp to max texture size
-    if (in < maxTextureSize)
-        return in;
-    return maxTextureSize;
+FontPage::~FontPage()
+{
+    Render::delete_tex(tex);
+    free(pixels);
+}
+
+// returns the y position for a w*h rectangle at the given node, or -1
+int FontPage::fit(unsigned int index, int w, int h)
+{
+    int x = skyline[index].x;
+    if (x + w > FONT_PAGE_SIZE)
+        return -1;
+    int y = skyline[index].y;
+    int left = w;
+    while (left > 0) {
+        y = std::max(y, skyline[index].y);
+        if (y + h > FONT_PAGE_SIZE)
+            return -1;
+        left -= skyline[index].width;
+        index++;
+    }
+    return y;
+}
+
+bool FontPage::insert(int w, int h, int * x, int * y)
+{
+    // bottom-left skyline packing: the lowest fit wins, ties go to the
+    // narrowest node
+    int best = -1;
+    int best_y = FONT_PAGE_SIZE;
+    int best_width = FONT_PAGE_SIZE + 1;
+    for (unsigned int i = 0; i < skyline.size(); i++) {
+        int node_y = fit(i, w, h);
+        if (node_y < 0)
+            continue;
+        int node_width = skyline[i].width;
+        if (node_y + h < best_y ||
+            (node_y + h == best_y && node_width < best_width))
+        {
+            best = i;
+            best_y = node_y + h;
+            best_width = node_width;
+        }
+    }
+    if (best < 0)
+        return false;
+
+    *x = skyline[best].x;
+    *y = best_y - h;
+
+    SkylineNode node = {*x, best_y, w};
+    skyline.insert(skyline.begin() + best, node);
+
+    // shrink the nodes covered by the new one
+    for (unsigned int i = best + 1; i < skyline.size(); i++) {
+        SkylineNode & prev = skyline[i - 1];
+        SkylineNode & cur = skyline[i];
+        int prev_end = prev.x + prev.width;
+        if (cur.x >= prev_end)
+            break;
+        int shrink = prev_end - cur.x;
+        cur.x += shrink;
+        cur.width -= shrink;
+        if (cur.width > 0)
+            break;
+        skyline.erase(skyline.begin() + i);
+        i--;
+    }
+
+    // merge neighbours at the same height
+    for (unsigned int i = 0; i + 1 < skyline.size(); i++) {
+        if (skyline[i].y != skyline[i + 1].y)
+            continue;
+        skyline[i].width += skyline[i + 1].width;
+        skyline.erase(skyline.begin() + i + 1);
+        i--;
+    }
+
+    dirty_y1 = std::min(dirty_y1, *y);
+    dirty_y2 = std::max(dirty_y2, best_y);
+    return true;
+}
+
+void FontPage::upload()
+{
+    if (dirty_y1 >= dirty_y2)
+        return;
+    // upload the changed rows as one full-width strip
+    Render::update_tex(tex, pixels + dirty_y1 * FONT_PAGE_SIZE, Render::L,
+                       0, dirty_y1, FONT_PAGE_SIZE, dirty_y2 - dirty_y1);
+    dirty_y1 = FONT_PAGE_SIZE;
+    dirty_y2 = 0;
 }
 
 //
 // FTTextureFont
 //
 
-FTTextureFont::FTTextureFont(FileStream & stream)
-: textureWidth(0), textureHeight(0), xOffset(0), yOffset(0), padding(3)
+FTTextureFont::FTTextureFont(BaseStream & stream)
+: padding(3), placed(0)
 {
     glyphList = new FTGlyphContainer(this);
 
@@ -456,60 +604,12 @@ FTTextureFont::FTTextureFont(FileStream & stream)
     descender = stream.read_float();
     numGlyphs = stream.read_int32();
 
-    glyphHeight = std::max(1, int(height + 0.5f));
-    glyphWidth = std::max(1, int(width + 0.5f));
-
-    int tex_size = 1024;
-
-    // Texture width required for numGlyphs glyphs. Will probably not be
-    // large enough, but we try to fit as many glyphs in one line as possible
-    textureWidth = ClampSize(glyphWidth * numGlyphs + padding * 2,
-                             tex_size);
-
-    // Number of lines required for that many glyphs in a line
-    int tmp = (textureWidth - (padding * 2)) / glyphWidth;
-    tmp = tmp > 0 ? tmp : 1;
-    tmp = (numGlyphs + (tmp - 1)) / tmp; // round division up
-
-    // Texture height required for tmp lines of glyphs
-    textureHeight = ClampSize(glyphHeight * tmp + padding * 2,
-                              tex_size);
-
-    char * data = new char[textureWidth*textureHeight];
-
-    xOffset = yOffset = padding;
-
+    // the bitmaps are kept in memory, and glyphs are only placed on an
+    // atlas page once a character of their block is drawn
     for (int i = 0; i < numGlyphs; i++) {
-        FTGlyph * glyph = new FTGlyph(stream, data, xOffset, yOffset,
-                                      textureWidth, textureHeight);
+        FTGlyph * glyph = new FTGlyph(stream, bitmaps);
         glyphList->Add(glyph, glyph->charcode);
-
-        if (xOffset > (textureWidth - glyphWidth)) {
-            xOffset = padding;
-            yOffset += glyphHeight;
-
-            if (yOffset > (textureHeight - glyphHeight)) {
-                std::cout << "Cannot fit glyphs in texture!" << std::endl;
-                break;
-            }
-        }
-
-        xOffset += int(glyph->BBox().Upper().X() -
-                       glyph->BBox().Lower().X() + padding + 0.5);
     }
-
-    tex = Render::create_tex(data, Render::L, textureWidth, textureHeight);
-    Render::set_filter(tex, true);
-
-    GlyphVector::iterator it;
-    for (it = glyphList->glyphs.begin(); it != glyphList->glyphs.end(); ++it) {
-        FTGlyph * glyph = *it;
-        if (glyph == NULL)
-            continue;
-        glyph->tex = tex;
-    }
-
-    delete[] data;
 }
 
 
@@ -517,7 +617,9 @@ FTTextureFont::~FTTextureFont()
 {
     if (glyphList != NULL)
         delete glyphList;
-    Render::delete_tex(tex);
+    FontPages::iterator it;
+    for (it = pages.begin(); it != pages.end(); ++it)
+        delete *it;
 }
 
 bool FTTextureFont::CheckGlyph(const unsigned int characterCode)
@@ -526,13 +628,78 @@ bool FTTextureFont::CheckGlyph(const unsigned int characterCode)
     return glyph != NULL;
 }
 
+void FTTextureFont::PlaceGlyph(FTGlyph * glyph)
+{
+    int w = glyph->width;
+    int h = glyph->height;
+    int x = 0, y = 0;
+    FontPage * page = NULL;
+    if (!pages.empty()) {
+        page = pages.back();
+        if (!page->insert(w + padding, h + padding, &x, &y))
+            page = NULL;
+    }
+    if (page == NULL) {
+        // the glyphs of a page are always placed in the same call, so
+        // only the last page can have room left
+        if (!pages.empty())
+            pages.back()->upload();
+        page = new FontPage;
+        pages.push_back(page);
+        if (!page->insert(w + padding, h + padding, &x, &y)) {
+            std::cout << "Glyph too large for font page: " << glyph->charcode
+                << std::endl;
+            return;
+        }
+    }
+    x += padding;
+    y += padding;
+
+    const char * src = &bitmaps[0] + glyph->bitmap;
+    for (int yy = 0; yy < h; ++yy) {
+        unsigned char * dst = page->pixels + (y + yy) * FONT_PAGE_SIZE + x;
+        memcpy(dst, src + yy * w, w);
+    }
+
+    float page_size = float(FONT_PAGE_SIZE);
+    glyph->uv[0].X(float(x) / page_size);
+    glyph->uv[0].Y(float(y) / page_size);
+    glyph->uv[1].X(float(x + w) / page_size);
+    glyph->uv[1].Y(float(y + h) / page_size);
+    glyph->tex = page->tex;
+    placed++;
+}
+
+void FTTextureFont::LoadBlock(const unsigned int chr)
+{
+    unsigned int block = chr >> FONT_BLOCK_BITS;
+    if (block >= loaded_blocks.size())
+        loaded_blocks.resize(block + 1, false);
+    if (loaded_blocks[block])
+        return;
+    loaded_blocks[block] = true;
+
+    unsigned int start = block << FONT_BLOCK_BITS;
+    for (unsigned int c = start; c < start + FONT_BLOCK_SIZE; c++) {
+        FTGlyph * glyph = glyphList->Glyph(c);
+        if (glyph == NULL || glyph->tex != 0)
+            continue;
+        PlaceGlyph(glyph);
+    }
+    if (!pages.empty())
+        pages.back()->upload();
+
+    if (placed == numGlyphs) {
+        // all glyphs are on the atlas, so the bitmaps are not needed anymore
+        vector<char>().swap(bitmaps);
+    }
+}
+
 //
 //  FTGlyph
 //
 
-FTGlyph::FTGlyph(FileStream & stream, char * data,
-                 int x_offset, int y_offset,
-                 int tex_width, int tex_height)
+FTGlyph::FTGlyph(BaseStream & stream, vector<char> & bitmaps)
 : tex(0)
 {
     charcode = stream.read_uint32();
@@ -553,30 +720,12 @@ FTGlyph::FTGlyph(FileStream & stream, char * data,
     width = stream.read_int32();
     height = stream.read_int32();
 
-    char * glyph = new char[width*height];
-    stream.read(glyph, width * height);
-
-    if (width && height) {
-        if (y_offset + height > tex_height) {
-            // copy subimage
-            height = tex_height - y_offset;
-        }
-        if (height >= 0) {
-            for (int y = 0; y < height; ++y) {
-                for (int x = 0; x < width; ++x) {
-                    char c = glyph[y * width + x];
-                    data[(y + y_offset) * tex_width + x + x_offset] = c;
-                }
-            }
-        }
-    }
-
-    uv[0].X(float(x_offset) / float(tex_width));
-    uv[0].Y(float(y_offset) / float(tex_height));
-    uv[1].X(float(x_offset + width) / float(tex_width));
-    uv[1].Y(float(y_offset + height) / float(tex_height));
-
-    delete[] glyph;
+    bitmap = bitmaps.size();
+    int size = width * height;
+    if (size <= 0)
+        return;
+    bitmaps.resize(bitmap + size);
+    stream.read(&bitmaps[bitmap], size);
 }
 
 FTGlyph::~FTGlyph()
@@ -603,9 +752,18 @@ const FTPoint& FTGlyph::Render(const FTPoint& pen)
     dx = floor(pen.Xf() + corner.Xf());
     dy = floor(pen.Yf() - corner.Yf());
 
-    Render::draw_tex(dx, dy, dx + width, dy + height, FTTextureFont::color,
-                     tex,
-                     uv[0].Xf(), uv[0].Yf(), uv[1].Xf(), uv[1].Yf());
+    if (tex == 0)
+        // could not be placed on a page
+        return advance;
+
+    if (FTTextureFont::mesh != NULL)
+        FTTextureFont::mesh->add(tex, dx, dy, dx + width, dy + height,
+                                 uv[0].Xf(), uv[0].Yf(),
+                                 uv[1].Xf(), uv[1].Yf());
+    else
+        Render::draw_tex(dx, dy, dx + width, dy + height, FTTextureFont::color,
+                         tex,
+                         uv[0].Xf(), uv[0].Yf(), uv[1].Xf(), uv[1].Yf());
 
     return advance;
 }
@@ -683,8 +841,11 @@ FTPoint FTGlyphContainer::Render(const unsigned int charCode,
     FTPoint kernAdvance = font->KernAdvance(left, right);
 
     FTGlyph * glyph = Glyph(charCode);
-    if (glyph != NULL)
+    if (glyph != NULL) {
+        if (glyph->tex == 0)
+            font->LoadBlock(charCode);
         kernAdvance += glyph->Render(penPosition);
+    }
 
     return kernAdvance;
 }
@@ -732,10 +893,13 @@ template <typename T>
 inline void FTSimpleLayout::RenderI(const T *string, const int len,
                                     FTPoint position)
 {
-    Render::set_effect(Render::FONT);
+    bool draw = FTTextureFont::mesh == NULL;
+    if (draw)
+        Render::set_effect(Render::FONT);
     pen = FTPoint(0.0f, 0.0f);
     WrapText(string, len, position, NULL);
-    Render::disable_effect();
+    if (draw)
+        Render::disable_effect();
 }
 
 
@@ -752,6 +916,16 @@ void FTSimpleLayout::Render(const wchar_t* string, const int len,
     RenderI(string, len, position);
 }
 
+void FTSimpleLayout::BuildMesh(const char *string, const int len,
+                               TextMesh & mesh)
+{
+    mesh.clear();
+    FTTextureFont::mesh = &mesh;
+    RenderI(string, len, FTPoint());
+    FTTextureFont::mesh = NULL;
+    mesh.finish();
+}
+
 
 bool is_linebreak(unsigned int v)
 {
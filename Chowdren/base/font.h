@@ -195,6 +195,43 @@ class FTBBox
 };
 
 
+// glyph quads relative to the text origin, so static text can be drawn
+// again without running the layout
+struct TextQuad
+{
+    Texture tex;
+    int x1, y1, x2, y2;
+    float u1, v1, u2, v2;
+};
+
+class TextMesh
+{
+public:
+    vector<TextQuad> quads;
+    bool valid;
+
+    TextMesh()
+    : valid(false)
+    {
+    }
+
+    void clear()
+    {
+        quads.clear();
+        valid = false;
+    }
+
+    void add(Texture tex, int x1, int y1, int x2, int y2,
+             float u1, float v1, float u2, float v2)
+    {
+        TextQuad quad = {tex, x1, y1, x2, y2, u1, v1, u2, v2};
+        quads.push_back(quad);
+    }
+
+    void finish();
+    void draw(int x, int y, Color color);
+};
+
 class FTCharToGlyphIndexMap
 {
     public:
@@ -323,16 +360,49 @@ public:
     int height;
     FTPoint corner;
     FTPoint uv[2];
+    // 0 until the glyph is placed on an atlas page
     Texture tex;
+    // offset of the bitmap in FTTextureFont::bitmaps
+    size_t bitmap;
 
-    FTGlyph(FileStream & stream, char * data, int x_offset, int y_offset,
-            int tex_width, int tex_height);
+    FTGlyph(BaseStream & stream, vector<char> & bitmaps);
     ~FTGlyph();
     const FTPoint& Render(const FTPoint& pen);
     float Advance() const;
     const FTBBox& BBox() const;
 };
 
+// atlas page with skyline packing. glyphs are placed in blocks of
+// FONT_BLOCK_SIZE characters on first use
+#define FONT_PAGE_SIZE 1024
+#define FONT_BLOCK_BITS 7
+#define FONT_BLOCK_SIZE (1 << FONT_BLOCK_BITS)
+
+struct SkylineNode
+{
+    int x, y, width;
+};
+
+class FontPage
+{
+public:
+    Texture tex;
+    unsigned char * pixels;
+    vector<SkylineNode> skyline;
+    // rows changed since the last upload
+    int dirty_y1, dirty_y2;
+
+    FontPage();
+    ~FontPage();
+    bool insert(int w, int h, int * x, int * y);
+    void upload();
+
+private:
+    int fit(unsigned int index, int w, int h);
+};
+
+typedef vector<FontPage*> FontPages;
+
 class FTTextureFont
 {
 public:
@@ -341,20 +411,19 @@ public:
     float ascender, descender;
 
     int numGlyphs;
-
-    int textureWidth;
-    int textureHeight;
-    Texture tex;
-    int glyphHeight;
-    int glyphWidth;
     unsigned int padding;
-    int xOffset;
-    int yOffset;
+    FontPages pages;
+    // bitmaps of glyphs not placed on a page yet
+    vector<char> bitmaps;
+    int placed;
+    vector<bool> loaded_blocks;
     static Color color;
+    // when set, glyphs are added to the mesh instead of being drawn
+    static TextMesh * mesh;
     FTGlyphContainer * glyphList;
     FTPoint pen;
 
-    FTTextureFont(FileStream & stream);
+    FTTextureFont(BaseStream & stream);
     ~FTTextureFont();
 
     FTPoint KernAdvance(unsigned int index1, unsigned int index2);
@@ -388,7 +457,10 @@ public:
                    FTPoint position, FTPoint spacing);
     FTPoint Render(const wchar_t * string, const int len,
                    FTPoint position, FTPoint spacing);
+    void BuildMesh(const char * string, const int len, TextMesh & mesh);
     bool CheckGlyph(const unsigned int chr);
+    void LoadBlock(const unsigned int chr);
+    void PlaceGlyph(FTGlyph * glyph);
 };
 
 
@@ -404,6 +476,7 @@ class FTSimpleLayout
                     FTPoint position = FTPoint());
         void Render(const wchar_t *string, const int len = -1,
                             FTPoint position = FTPoint());
+        void BuildMesh(const char *string, const int len, TextMesh & mesh);
         void SetFont(FTTextureFont *fontInit);
         FTTextureFont *GetFont();
         void SetLineLength(const float LineLength);
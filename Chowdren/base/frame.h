@@ -12,28 +12,44 @@
 #include "frameobject.h"
 #include "color.h"
 #include "instancemap.h"
+#include "layercache.h"
 
 class BackgroundItem;
 class CollisionBase;
 
 typedef vector<BackgroundItem*> BackgroundItems;
 
+// pasted items. the lists are unordered and own the items, the
+// broadphases are used for all lookups
 class Background
 {
 public:
     BackgroundItems items;
     BackgroundItems col_items;
+    Broadphase items_broadphase;
+    Broadphase col_broadphase;
+    unsigned int paste_count;
 
     Background();
     ~Background();
     void reset(bool clear_items = true);
-    void destroy_at(int x, int y);
+    // box is set to the area of the removed items, if any
+    bool destroy_at(int x, int y, int box[4]);
     void paste(Image * img, int dest_x, int dest_y,
                int src_x, int src_y, int src_width, int src_height,
                int collision_type, const Color & color);
     void draw(int v[4]);
     CollisionBase * collide(CollisionBase * a);
     CollisionBase * overlaps(CollisionBase * a);
+    CollisionBase * overlaps(CollisionBase * a, int * aabb);
+
+private:
+    void add_item(BackgroundItems & list, Broadphase & broadphase,
+                  BackgroundItem * item);
+    void remove_item(BackgroundItems & list, Broadphase & broadphase,
+                     BackgroundItem * item);
+    void destroy_at(BackgroundItems & list, Broadphase & broadphase,
+                    int x, int y, int box[4]);
 };
 
 typedef boost::intrusive::member_hook<FrameObject, LayerPos,
@@ -59,6 +75,16 @@ public:
     int inactive_box[4];
     int kill_box[4];
 
+    // visible instances from the last draw, kept sorted by depth
+    FlatObjectList draw_list;
+    FlatObjectList draw_added;
+    unsigned int draw_stamp;
+    bool draw_sorted;
+
+#ifdef CHOWDREN_LAYER_CACHE
+    LayerCache cache;
+#endif
+
 #ifdef CHOWDREN_IS_3DS
     float depth;
 #endif
@@ -81,6 +107,10 @@ public:
     void insert_object(FrameObject * instance, int index);
     void remove_object(FrameObject * instance);
     void reset_depth();
+    void remove_draw_object(FrameObject * instance);
+    void invalidate_draw_list();
+    void invalidate_static(FrameObject * instance, int dx = 0, int dy = 0);
+    void update_draw_list(int v[4]);
     int get_level(FrameObject * instance);
     void set_level(FrameObject * instance, int index);
     void destroy_backgrounds();
@@ -216,6 +246,7 @@ public:
 
     virtual void set_index(int index) = 0;
     virtual void load_static_images();
+    virtual void prefetch_images(int index);
 
     // inline functions
 
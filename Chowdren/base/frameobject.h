@@ -17,6 +17,10 @@
 #include "stringcommon.h"
 #include "shaderparam.h"
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 class InstanceCollision;
 class Shader;
 class Frame;
@@ -274,6 +278,9 @@ public:
     InstanceCollision * collision;
     unsigned int depth;
     LayerPos layer_pos;
+    // position in Layer::draw_list, or -1
+    int draw_index;
+    unsigned int draw_stamp;
     int index;
     int width, height;
     int direction;
@@ -316,6 +323,12 @@ public:
     void set_visible(bool value);
     void set_blend_color(int color);
     virtual void draw();
+#ifdef CHOWDREN_LAYER_CACHE
+    // true if draw() only depends on the object itself, so it can be baked
+    // into a layer chunk. draws that read the camera or set a scissor
+    // cannot be baked
+    virtual bool can_bake();
+#endif
     void draw_image(Image * img, int x, int y, Color c);
     void draw_image(Image * img, int x, int y, Color c, float angle,
                     float x_scale, float y_scale);
@@ -328,6 +341,7 @@ public:
     virtual int get_direction();
     bool mouse_over();
     bool overlaps(FrameObject * other);
+    bool overlaps(FrameObject * other, int dx, int dy);
     void set_layer(int layer);
     void set_shader(int effect);
     void set_shader_parameter(const std::string & name, double value);
@@ -347,6 +361,7 @@ public:
     bool outside_playfield();
     int get_box_index(int index);
     bool overlaps_background();
+    bool overlaps_background(int dx, int dy);
     bool overlaps_background_save();
     void clear_movements();
     void set_movement(int i);
@@ -453,9 +468,13 @@ public:
     typedef ObjectListItems::iterator iterator;
     unsigned int saved_start;
     vector<int> saved_items;
+    // scratch bits for SelectionIterator
+    vector<unsigned int> selection_bits;
+    // set while destroyed instances are waiting for remove_destroyed()
+    bool has_destroyed;
 
     ObjectList()
-    : back_obj(NULL)
+    : back_obj(NULL), has_destroyed(false)
     {
         items.resize(1);
         ObjectListItem & item = items[0];
@@ -566,6 +585,29 @@ public:
         back_obj = items.back().obj;
     }
 
+    // removes all instances flagged with DESTROYING in a single pass.
+    // like remove(), only the objects move, so the next links stay in place
+    void remove_destroyed()
+    {
+        has_destroyed = false;
+        int size = items.size();
+        int i = 1;
+        while (i < size && !(items[i].obj->flags & DESTROYING))
+            i++;
+        int out = i;
+        for (; i < size; i++) {
+            FrameObject * obj = items[i].obj;
+            if (obj->flags & DESTROYING)
+                continue;
+            items[out].obj = obj;
+            obj->index = out;
+            out++;
+        }
+
+        items.resize(out);
+        back_obj = items.back().obj;
+    }
+
     void select_single(FrameObject * obj)
     {
         items[0].next = obj->index;
@@ -637,6 +679,131 @@ public:
     }
 };
 
+/*
+Iterates the selection of an ObjectList through a bitset with one bit per
+item, for runs of simple conditions (use_dense_selection config option).
+
+The next chain always runs from high to low indexes (see restore_selection),
+so scanning the bits downwards visits the instances in the same order.
+Deselecting only clears a bit, and the chain is written once the iteration
+reaches the end. With 'all' set, the iteration starts from a cleared
+selection instead of reading the chain.
+*/
+
+class SelectionIterator
+{
+public:
+    ObjectList & list;
+    ObjectListItem * items;
+    unsigned int * bits;
+    int index;
+
+#ifdef CHOWDREN_ITER_INDEX
+    int current_index;
+#endif
+
+    SelectionIterator(ObjectList & list, bool all = false)
+    : list(list)
+    {
+#ifdef CHOWDREN_ITER_INDEX
+        current_index = 0;
+#endif
+        int size = list.items.size();
+        int words = (size + 31) / 32;
+        list.selection_bits.resize(words);
+        bits = &list.selection_bits[0];
+        items = &list.items[0];
+        if (all) {
+            memset(bits, 0xFF, words * sizeof(unsigned int));
+            int extra = words * 32 - size;
+            bits[words - 1] &= 0xFFFFFFFFu >> extra;
+        } else {
+            memset(bits, 0, words * sizeof(unsigned int));
+            for (int i = items[0].next; i != LAST_SELECTED; i = items[i].next)
+                bits[i >> 5] |= 1u << (i & 31);
+        }
+        // the first item is the chain head, never an instance
+        bits[0] &= ~1u;
+        index = find_prev(size);
+        if (index == LAST_SELECTED)
+            write_chain();
+    }
+
+    FrameObject* operator*() const
+    {
+        return items[index].obj;
+    }
+
+    void operator++()
+    {
+#ifdef CHOWDREN_ITER_INDEX
+        current_index++;
+#endif
+        index = find_prev(index);
+        if (index == LAST_SELECTED)
+            write_chain();
+    }
+
+    void operator++(int)
+    {
+        ++*this;
+    }
+
+    void deselect()
+    {
+        bits[index >> 5] &= ~(1u << (index & 31));
+    }
+
+    bool end() const
+    {
+        return index == LAST_SELECTED;
+    }
+
+private:
+    static int get_high_bit(unsigned int value)
+    {
+#if defined(__GNUC__)
+        return 31 - __builtin_clz(value);
+#elif defined(_MSC_VER)
+        unsigned long bit;
+        _BitScanReverse(&bit, value);
+        return int(bit);
+#else
+        int bit = 0;
+        while (value >>= 1)
+            bit++;
+        return bit;
+#endif
+    }
+
+    // returns the highest selected index below 'index', or LAST_SELECTED
+    int find_prev(int index) const
+    {
+        index--;
+        int word = index >> 5;
+        unsigned int value = bits[word] & (0xFFFFFFFFu >> (31 - (index & 31)));
+        while (value == 0) {
+            if (word == 0)
+                return LAST_SELECTED;
+            value = bits[--word];
+        }
+        return (word << 5) + get_high_bit(value);
+    }
+
+    void write_chain()
+    {
+        int last = 0;
+        int i = list.items.size();
+        while (true) {
+            i = find_prev(i);
+            items[last].next = i;
+            if (i == LAST_SELECTED)
+                break;
+            last = i;
+        }
+    }
+};
+
 inline FrameObject * ObjectList::get_wrapped_selection(int index)
 {
     if (!has_selection()) {
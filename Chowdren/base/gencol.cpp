@@ -25,11 +25,12 @@ static bool collide_sprite_sprite(CollisionBase * in_a, CollisionBase * in_b, in
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
                     if (!(((unsigned char*)(a_arr + (y + offy1) * a_width + (x + offx1)))[3] != 0))
                         continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
+                    if (!b_alpha.get((y + offy2) * b_stride * BaseBitArray::WORD_SIZE + (x + offx2)))
                         continue;
                     return true;
                 }
@@ -37,11 +38,12 @@ static bool collide_sprite_sprite(CollisionBase * in_a, CollisionBase * in_b, in
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
         if (b_alpha.data == NULL) {
             unsigned int * b_arr = (unsigned int*)b_img->image;
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
+                    if (!a_alpha.get((y + offy1) * a_stride * BaseBitArray::WORD_SIZE + (x + offx1)))
                         continue;
                     if (!(((unsigned char*)(b_arr + (y + offy2) * b_width + (x + offx2)))[3] != 0))
                         continue;
@@ -50,13 +52,24 @@ static bool collide_sprite_sprite(CollisionBase * in_a, CollisionBase * in_b, in
             }
         }
         else {
-            for (int y = 0; y < h; y++) {
-                for (int x = 0; x < w; x++) {
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
-                        continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
-                        continue;
-                    return true;
+            int b_stride = b_img->get_alpha_stride();
+            short * a_spans = a_img->get_alpha_spans();
+            short * b_spans = b_img->get_alpha_spans();
+            for (int y = 0; y < h; y++) {
+                int a_y = y + offy1;
+                int b_y = y + offy2;
+                int x1 = std::max(0, std::max(a_spans[a_y * 2] - offx1, b_spans[b_y * 2] - offx2));
+                int x2 = std::min(w, std::min(a_spans[a_y * 2 + 1] - offx1, b_spans[b_y * 2 + 1] - offx2));
+                if (x1 >= x2)
+                    continue;
+                BaseBitArray::word_t * a_row = a_alpha.data + a_y * a_stride;
+                BaseBitArray::word_t * b_row = b_alpha.data + b_y * b_stride;
+                for (int x = x1; x < x2; x += BaseBitArray::WORD_SIZE) {
+                    BaseBitArray::word_t bits = BaseBitArray::get_low_mask(x2 - x);
+                    bits &= BaseBitArray::get_word(a_row, a_stride, x + offx1);
+                    bits &= BaseBitArray::get_word(b_row, b_stride, x + offx2);
+                    if (bits != 0)
+                        return true;
                 }
             }
         }
@@ -114,6 +127,7 @@ static bool collide_sprite_tsprite(CollisionBase * in_a, CollisionBase * in_b, i
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             int b_height = b_img->height;
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
@@ -125,7 +139,7 @@ static bool collide_sprite_tsprite(CollisionBase * in_a, CollisionBase * in_b, i
                         continue;
                     if (!(((unsigned char*)(a_arr + (y + offy1) * a_width + (x + offx1)))[3] != 0))
                         continue;
-                    if (!b_alpha.get(b_yy * b_width + b_xx))
+                    if (!b_alpha.get(b_yy * b_stride * BaseBitArray::WORD_SIZE + b_xx))
                         continue;
                     return true;
                 }
@@ -133,6 +147,7 @@ static bool collide_sprite_tsprite(CollisionBase * in_a, CollisionBase * in_b, i
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
         if (b->flags & BOX_COLLISION) {
             int b_height = b_img->height;
             for (int y = 0; y < h; y++) {
@@ -143,7 +158,7 @@ static bool collide_sprite_tsprite(CollisionBase * in_a, CollisionBase * in_b, i
                     int b_yy = GET_SCALER_RESULT(b_yyv * b->co_divy + b_xxv * b->si_divy);
                     if ((b_xx | b_yy) < 0 || b_xx >= b_width || b_yy >= b_height)
                         continue;
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
+                    if (!a_alpha.get((y + offy1) * a_stride * BaseBitArray::WORD_SIZE + (x + offx1)))
                         continue;
                     return true;
                 }
@@ -160,7 +175,7 @@ static bool collide_sprite_tsprite(CollisionBase * in_a, CollisionBase * in_b, i
                     int b_yy = GET_SCALER_RESULT(b_yyv * b->co_divy + b_xxv * b->si_divy);
                     if ((b_xx | b_yy) < 0 || b_xx >= b_width || b_yy >= b_height)
                         continue;
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
+                    if (!a_alpha.get((y + offy1) * a_stride * BaseBitArray::WORD_SIZE + (x + offx1)))
                         continue;
                     if (!(((unsigned char*)(b_arr + b_yy * b_width + b_xx))[3] != 0))
                         continue;
@@ -169,6 +184,7 @@ static bool collide_sprite_tsprite(CollisionBase * in_a, CollisionBase * in_b, i
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             int b_height = b_img->height;
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
@@ -178,9 +194,9 @@ static bool collide_sprite_tsprite(CollisionBase * in_a, CollisionBase * in_b, i
                     int b_yy = GET_SCALER_RESULT(b_yyv * b->co_divy + b_xxv * b->si_divy);
                     if ((b_xx | b_yy) < 0 || b_xx >= b_width || b_yy >= b_height)
                         continue;
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
+                    if (!a_alpha.get((y + offy1) * a_stride * BaseBitArray::WORD_SIZE + (x + offx1)))
                         continue;
-                    if (!b_alpha.get(b_yy * b_width + b_xx))
+                    if (!b_alpha.get(b_yy * b_stride * BaseBitArray::WORD_SIZE + b_xx))
                         continue;
                     return true;
                 }
@@ -217,11 +233,12 @@ static bool collide_sprite_background(CollisionBase * in_a, CollisionBase * in_b
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
                     if (!(((unsigned char*)(a_arr + (y + offy1) * a_width + (x + offx1)))[3] != 0))
                         continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
+                    if (!b_alpha.get((y + offy2) * b_stride * BaseBitArray::WORD_SIZE + (x + offx2)))
                         continue;
                     return true;
                 }
@@ -229,11 +246,12 @@ static bool collide_sprite_background(CollisionBase * in_a, CollisionBase * in_b
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
         if (b_alpha.data == NULL) {
             unsigned int * b_arr = (unsigned int*)b_img->image;
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
+                    if (!a_alpha.get((y + offy1) * a_stride * BaseBitArray::WORD_SIZE + (x + offx1)))
                         continue;
                     if (!(((unsigned char*)(b_arr + (y + offy2) * b_width + (x + offx2)))[3] != 0))
                         continue;
@@ -242,13 +260,24 @@ static bool collide_sprite_background(CollisionBase * in_a, CollisionBase * in_b
             }
         }
         else {
-            for (int y = 0; y < h; y++) {
-                for (int x = 0; x < w; x++) {
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
-                        continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
-                        continue;
-                    return true;
+            int b_stride = b_img->get_alpha_stride();
+            short * a_spans = a_img->get_alpha_spans();
+            short * b_spans = b_img->get_alpha_spans();
+            for (int y = 0; y < h; y++) {
+                int a_y = y + offy1;
+                int b_y = y + offy2;
+                int x1 = std::max(0, std::max(a_spans[a_y * 2] - offx1, b_spans[b_y * 2] - offx2));
+                int x2 = std::min(w, std::min(a_spans[a_y * 2 + 1] - offx1, b_spans[b_y * 2 + 1] - offx2));
+                if (x1 >= x2)
+                    continue;
+                BaseBitArray::word_t * a_row = a_alpha.data + a_y * a_stride;
+                BaseBitArray::word_t * b_row = b_alpha.data + b_y * b_stride;
+                for (int x = x1; x < x2; x += BaseBitArray::WORD_SIZE) {
+                    BaseBitArray::word_t bits = BaseBitArray::get_low_mask(x2 - x);
+                    bits &= BaseBitArray::get_word(a_row, a_stride, x + offx1);
+                    bits &= BaseBitArray::get_word(b_row, b_stride, x + offx2);
+                    if (bits != 0)
+                        return true;
                 }
             }
         }
@@ -281,11 +310,12 @@ static bool collide_sprite_backdrop(CollisionBase * in_a, CollisionBase * in_b,
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
                     if (!(((unsigned char*)(a_arr + (y + offy1) * a_width + (x + offx1)))[3] != 0))
                         continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
+                    if (!b_alpha.get((y + offy2) * b_stride * BaseBitArray::WORD_SIZE + (x + offx2)))
                         continue;
                     return true;
                 }
@@ -293,11 +323,12 @@ static bool collide_sprite_backdrop(CollisionBase * in_a, CollisionBase * in_b,
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
         if (b_alpha.data == NULL) {
             unsigned int * b_arr = (unsigned int*)b_img->image;
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
+                    if (!a_alpha.get((y + offy1) * a_stride * BaseBitArray::WORD_SIZE + (x + offx1)))
                         continue;
                     if (!(((unsigned char*)(b_arr + (y + offy2) * b_width + (x + offx2)))[3] != 0))
                         continue;
@@ -306,13 +337,24 @@ static bool collide_sprite_backdrop(CollisionBase * in_a, CollisionBase * in_b,
             }
         }
         else {
-            for (int y = 0; y < h; y++) {
-                for (int x = 0; x < w; x++) {
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
-                        continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
-                        continue;
-                    return true;
+            int b_stride = b_img->get_alpha_stride();
+            short * a_spans = a_img->get_alpha_spans();
+            short * b_spans = b_img->get_alpha_spans();
+            for (int y = 0; y < h; y++) {
+                int a_y = y + offy1;
+                int b_y = y + offy2;
+                int x1 = std::max(0, std::max(a_spans[a_y * 2] - offx1, b_spans[b_y * 2] - offx2));
+                int x2 = std::min(w, std::min(a_spans[a_y * 2 + 1] - offx1, b_spans[b_y * 2 + 1] - offx2));
+                if (x1 >= x2)
+                    continue;
+                BaseBitArray::word_t * a_row = a_alpha.data + a_y * a_stride;
+                BaseBitArray::word_t * b_row = b_alpha.data + b_y * b_stride;
+                for (int x = x1; x < x2; x += BaseBitArray::WORD_SIZE) {
+                    BaseBitArray::word_t bits = BaseBitArray::get_low_mask(x2 - x);
+                    bits &= BaseBitArray::get_word(a_row, a_stride, x + offx1);
+                    bits &= BaseBitArray::get_word(b_row, b_stride, x + offx2);
+                    if (bits != 0)
+                        return true;
                 }
             }
         }
@@ -337,11 +379,20 @@ static bool collide_sprite_box(CollisionBase * in_a, int w, int h, int offx1, in
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
+        short * a_spans = a_img->get_alpha_spans();
         for (int y = 0; y < h; y++) {
-            for (int x = 0; x < w; x++) {
-                if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
-                    continue;
-                return true;
+            int a_y = y + offy1;
+            int x1 = std::max(0, a_spans[a_y * 2] - offx1);
+            int x2 = std::min(w, a_spans[a_y * 2 + 1] - offx1);
+            if (x1 >= x2)
+                continue;
+            BaseBitArray::word_t * a_row = a_alpha.data + a_y * a_stride;
+            for (int x = x1; x < x2; x += BaseBitArray::WORD_SIZE) {
+                BaseBitArray::word_t bits = BaseBitArray::get_low_mask(x2 - x);
+                bits &= BaseBitArray::get_word(a_row, a_stride, x + offx1);
+                if (bits != 0)
+                    return true;
             }
         }
     }
@@ -379,6 +430,7 @@ static bool collide_tsprite_sprite(CollisionBase * in_a, CollisionBase * in_b, i
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
                     int a_xxv = (x + offx1);
@@ -387,7 +439,7 @@ static bool collide_tsprite_sprite(CollisionBase * in_a, CollisionBase * in_b, i
                     int a_yy = GET_SCALER_RESULT(a_yyv * a->co_divy + a_xxv * a->si_divy);
                     if ((a_xx | a_yy) < 0 || a_xx >= a_width || a_yy >= a_height)
                         continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
+                    if (!b_alpha.get((y + offy2) * b_stride * BaseBitArray::WORD_SIZE + (x + offx2)))
                         continue;
                     return true;
                 }
@@ -416,6 +468,7 @@ static bool collide_tsprite_sprite(CollisionBase * in_a, CollisionBase * in_b, i
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
                     int a_xxv = (x + offx1);
@@ -426,7 +479,7 @@ static bool collide_tsprite_sprite(CollisionBase * in_a, CollisionBase * in_b, i
                         continue;
                     if (!(((unsigned char*)(a_arr + a_yy * a_width + a_xx))[3] != 0))
                         continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
+                    if (!b_alpha.get((y + offy2) * b_stride * BaseBitArray::WORD_SIZE + (x + offx2)))
                         continue;
                     return true;
                 }
@@ -434,6 +487,7 @@ static bool collide_tsprite_sprite(CollisionBase * in_a, CollisionBase * in_b, i
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
         int a_height = a_img->height;
         if (b_alpha.data == NULL) {
             unsigned int * b_arr = (unsigned int*)b_img->image;
@@ -445,7 +499,7 @@ static bool collide_tsprite_sprite(CollisionBase * in_a, CollisionBase * in_b, i
                     int a_yy = GET_SCALER_RESULT(a_yyv * a->co_divy + a_xxv * a->si_divy);
                     if ((a_xx | a_yy) < 0 || a_xx >= a_width || a_yy >= a_height)
                         continue;
-                    if (!a_alpha.get(a_yy * a_width + a_xx))
+                    if (!a_alpha.get(a_yy * a_stride * BaseBitArray::WORD_SIZE + a_xx))
                         continue;
                     if (!(((unsigned char*)(b_arr + (y + offy2) * b_width + (x + offx2)))[3] != 0))
                         continue;
@@ -454,6 +508,7 @@ static bool collide_tsprite_sprite(CollisionBase * in_a, CollisionBase * in_b, i
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
                     int a_xxv = (x + offx1);
@@ -462,9 +517,9 @@ static bool collide_tsprite_sprite(CollisionBase * in_a, CollisionBase * in_b, i
                     int a_yy = GET_SCALER_RESULT(a_yyv * a->co_divy + a_xxv * a->si_divy);
                     if ((a_xx | a_yy) < 0 || a_xx >= a_width || a_yy >= a_height)
                         continue;
-                    if (!a_alpha.get(a_yy * a_width + a_xx))
+                    if (!a_alpha.get(a_yy * a_stride * BaseBitArray::WORD_SIZE + a_xx))
                         continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
+                    if (!b_alpha.get((y + offy2) * b_stride * BaseBitArray::WORD_SIZE + (x + offx2)))
                         continue;
                     return true;
                 }
@@ -534,6 +589,7 @@ static bool collide_tsprite_tsprite(CollisionBase * in_a, CollisionBase * in_b,
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             int b_height = b_img->height;
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
@@ -549,7 +605,7 @@ static bool collide_tsprite_tsprite(CollisionBase * in_a, CollisionBase * in_b,
                     int b_yy = GET_SCALER_RESULT(b_yyv * b->co_divy + b_xxv * b->si_divy);
                     if ((b_xx | b_yy) < 0 || b_xx >= b_width || b_yy >= b_height)
                         continue;
-                    if (!b_alpha.get(b_yy * b_width + b_xx))
+                    if (!b_alpha.get(b_yy * b_stride * BaseBitArray::WORD_SIZE + b_xx))
                         continue;
                     return true;
                 }
@@ -607,6 +663,7 @@ static bool collide_tsprite_tsprite(CollisionBase * in_a, CollisionBase * in_b,
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             int b_height = b_img->height;
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
@@ -624,7 +681,7 @@ static bool collide_tsprite_tsprite(CollisionBase * in_a, CollisionBase * in_b,
                         continue;
                     if (!(((unsigned char*)(a_arr + a_yy * a_width + a_xx))[3] != 0))
                         continue;
-                    if (!b_alpha.get(b_yy * b_width + b_xx))
+                    if (!b_alpha.get(b_yy * b_stride * BaseBitArray::WORD_SIZE + b_xx))
                         continue;
                     return true;
                 }
@@ -632,6 +689,7 @@ static bool collide_tsprite_tsprite(CollisionBase * in_a, CollisionBase * in_b,
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
         int a_height = a_img->height;
         if (b->flags & BOX_COLLISION) {
             int b_height = b_img->height;
@@ -649,7 +707,7 @@ static bool collide_tsprite_tsprite(CollisionBase * in_a, CollisionBase * in_b,
                     int b_yy = GET_SCALER_RESULT(b_yyv * b->co_divy + b_xxv * b->si_divy);
                     if ((b_xx | b_yy) < 0 || b_xx >= b_width || b_yy >= b_height)
                         continue;
-                    if (!a_alpha.get(a_yy * a_width + a_xx))
+                    if (!a_alpha.get(a_yy * a_stride * BaseBitArray::WORD_SIZE + a_xx))
                         continue;
                     return true;
                 }
@@ -672,7 +730,7 @@ static bool collide_tsprite_tsprite(CollisionBase * in_a, CollisionBase * in_b,
                     int b_yy = GET_SCALER_RESULT(b_yyv * b->co_divy + b_xxv * b->si_divy);
                     if ((b_xx | b_yy) < 0 || b_xx >= b_width || b_yy >= b_height)
                         continue;
-                    if (!a_alpha.get(a_yy * a_width + a_xx))
+                    if (!a_alpha.get(a_yy * a_stride * BaseBitArray::WORD_SIZE + a_xx))
                         continue;
                     if (!(((unsigned char*)(b_arr + b_yy * b_width + b_xx))[3] != 0))
                         continue;
@@ -681,6 +739,7 @@ static bool collide_tsprite_tsprite(CollisionBase * in_a, CollisionBase * in_b,
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             int b_height = b_img->height;
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
@@ -696,9 +755,9 @@ static bool collide_tsprite_tsprite(CollisionBase * in_a, CollisionBase * in_b,
                     int b_yy = GET_SCALER_RESULT(b_yyv * b->co_divy + b_xxv * b->si_divy);
                     if ((b_xx | b_yy) < 0 || b_xx >= b_width || b_yy >= b_height)
                         continue;
-                    if (!a_alpha.get(a_yy * a_width + a_xx))
+                    if (!a_alpha.get(a_yy * a_stride * BaseBitArray::WORD_SIZE + a_xx))
                         continue;
-                    if (!b_alpha.get(b_yy * b_width + b_xx))
+                    if (!b_alpha.get(b_yy * b_stride * BaseBitArray::WORD_SIZE + b_xx))
                         continue;
                     return true;
                 }
@@ -741,6 +800,7 @@ static bool collide_tsprite_background(CollisionBase * in_a, CollisionBase * in_
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
                     int a_xxv = (x + offx1);
@@ -749,7 +809,7 @@ static bool collide_tsprite_background(CollisionBase * in_a, CollisionBase * in_
                     int a_yy = GET_SCALER_RESULT(a_yyv * a->co_divy + a_xxv * a->si_divy);
                     if ((a_xx | a_yy) < 0 || a_xx >= a_width || a_yy >= a_height)
                         continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
+                    if (!b_alpha.get((y + offy2) * b_stride * BaseBitArray::WORD_SIZE + (x + offx2)))
                         continue;
                     return true;
                 }
@@ -778,6 +838,7 @@ static bool collide_tsprite_background(CollisionBase * in_a, CollisionBase * in_
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
                     int a_xxv = (x + offx1);
@@ -788,7 +849,7 @@ static bool collide_tsprite_background(CollisionBase * in_a, CollisionBase * in_
                         continue;
                     if (!(((unsigned char*)(a_arr + a_yy * a_width + a_xx))[3] != 0))
                         continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
+                    if (!b_alpha.get((y + offy2) * b_stride * BaseBitArray::WORD_SIZE + (x + offx2)))
                         continue;
                     return true;
                 }
@@ -796,6 +857,7 @@ static bool collide_tsprite_background(CollisionBase * in_a, CollisionBase * in_
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
         int a_height = a_img->height;
         if (b_alpha.data == NULL) {
             unsigned int * b_arr = (unsigned int*)b_img->image;
@@ -807,7 +869,7 @@ static bool collide_tsprite_background(CollisionBase * in_a, CollisionBase * in_
                     int a_yy = GET_SCALER_RESULT(a_yyv * a->co_divy + a_xxv * a->si_divy);
                     if ((a_xx | a_yy) < 0 || a_xx >= a_width || a_yy >= a_height)
                         continue;
-                    if (!a_alpha.get(a_yy * a_width + a_xx))
+                    if (!a_alpha.get(a_yy * a_stride * BaseBitArray::WORD_SIZE + a_xx))
                         continue;
                     if (!(((unsigned char*)(b_arr + (y + offy2) * b_width + (x + offx2)))[3] != 0))
                         continue;
@@ -816,6 +878,7 @@ static bool collide_tsprite_background(CollisionBase * in_a, CollisionBase * in_
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
                     int a_xxv = (x + offx1);
@@ -824,9 +887,9 @@ static bool collide_tsprite_background(CollisionBase * in_a, CollisionBase * in_
                     int a_yy = GET_SCALER_RESULT(a_yyv * a->co_divy + a_xxv * a->si_divy);
                     if ((a_xx | a_yy) < 0 || a_xx >= a_width || a_yy >= a_height)
                         continue;
-                    if (!a_alpha.get(a_yy * a_width + a_xx))
+                    if (!a_alpha.get(a_yy * a_stride * BaseBitArray::WORD_SIZE + a_xx))
                         continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
+                    if (!b_alpha.get((y + offy2) * b_stride * BaseBitArray::WORD_SIZE + (x + offx2)))
                         continue;
                     return true;
                 }
@@ -867,6 +930,7 @@ static bool collide_tsprite_backdrop(CollisionBase * in_a, CollisionBase * in_b,
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
                     int a_xxv = (x + offx1);
@@ -875,7 +939,7 @@ static bool collide_tsprite_backdrop(CollisionBase * in_a, CollisionBase * in_b,
                     int a_yy = GET_SCALER_RESULT(a_yyv * a->co_divy + a_xxv * a->si_divy);
                     if ((a_xx | a_yy) < 0 || a_xx >= a_width || a_yy >= a_height)
                         continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
+                    if (!b_alpha.get((y + offy2) * b_stride * BaseBitArray::WORD_SIZE + (x + offx2)))
                         continue;
                     return true;
                 }
@@ -904,6 +968,7 @@ static bool collide_tsprite_backdrop(CollisionBase * in_a, CollisionBase * in_b,
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
                     int a_xxv = (x + offx1);
@@ -914,7 +979,7 @@ static bool collide_tsprite_backdrop(CollisionBase * in_a, CollisionBase * in_b,
                         continue;
                     if (!(((unsigned char*)(a_arr + a_yy * a_width + a_xx))[3] != 0))
                         continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
+                    if (!b_alpha.get((y + offy2) * b_stride * BaseBitArray::WORD_SIZE + (x + offx2)))
                         continue;
                     return true;
                 }
@@ -922,6 +987,7 @@ static bool collide_tsprite_backdrop(CollisionBase * in_a, CollisionBase * in_b,
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
         int a_height = a_img->height;
         if (b_alpha.data == NULL) {
             unsigned int * b_arr = (unsigned int*)b_img->image;
@@ -933,7 +999,7 @@ static bool collide_tsprite_backdrop(CollisionBase * in_a, CollisionBase * in_b,
                     int a_yy = GET_SCALER_RESULT(a_yyv * a->co_divy + a_xxv * a->si_divy);
                     if ((a_xx | a_yy) < 0 || a_xx >= a_width || a_yy >= a_height)
                         continue;
-                    if (!a_alpha.get(a_yy * a_width + a_xx))
+                    if (!a_alpha.get(a_yy * a_stride * BaseBitArray::WORD_SIZE + a_xx))
                         continue;
                     if (!(((unsigned char*)(b_arr + (y + offy2) * b_width + (x + offx2)))[3] != 0))
                         continue;
@@ -942,6 +1008,7 @@ static bool collide_tsprite_backdrop(CollisionBase * in_a, CollisionBase * in_b,
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
                     int a_xxv = (x + offx1);
@@ -950,9 +1017,9 @@ static bool collide_tsprite_backdrop(CollisionBase * in_a, CollisionBase * in_b,
                     int a_yy = GET_SCALER_RESULT(a_yyv * a->co_divy + a_xxv * a->si_divy);
                     if ((a_xx | a_yy) < 0 || a_xx >= a_width || a_yy >= a_height)
                         continue;
-                    if (!a_alpha.get(a_yy * a_width + a_xx))
+                    if (!a_alpha.get(a_yy * a_stride * BaseBitArray::WORD_SIZE + a_xx))
                         continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
+                    if (!b_alpha.get((y + offy2) * b_stride * BaseBitArray::WORD_SIZE + (x + offx2)))
                         continue;
                     return true;
                 }
@@ -1002,6 +1069,7 @@ static bool collide_tsprite_box(CollisionBase * in_a, int w, int h, int offx1, i
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
         int a_height = a_img->height;
         for (int y = 0; y < h; y++) {
             for (int x = 0; x < w; x++) {
@@ -1011,7 +1079,7 @@ static bool collide_tsprite_box(CollisionBase * in_a, int w, int h, int offx1, i
                 int a_yy = GET_SCALER_RESULT(a_yyv * a->co_divy + a_xxv * a->si_divy);
                 if ((a_xx | a_yy) < 0 || a_xx >= a_width || a_yy >= a_height)
                     continue;
-                if (!a_alpha.get(a_yy * a_width + a_xx))
+                if (!a_alpha.get(a_yy * a_stride * BaseBitArray::WORD_SIZE + a_xx))
                     continue;
                 return true;
             }
@@ -1047,11 +1115,12 @@ static bool collide_background_sprite(CollisionBase * in_a, CollisionBase * in_b
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
                     if (!(((unsigned char*)(a_arr + (y + offy1) * a_width + (x + offx1)))[3] != 0))
                         continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
+                    if (!b_alpha.get((y + offy2) * b_stride * BaseBitArray::WORD_SIZE + (x + offx2)))
                         continue;
                     return true;
                 }
@@ -1059,11 +1128,12 @@ static bool collide_background_sprite(CollisionBase * in_a, CollisionBase * in_b
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
         if (b_alpha.data == NULL) {
             unsigned int * b_arr = (unsigned int*)b_img->image;
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
+                    if (!a_alpha.get((y + offy1) * a_stride * BaseBitArray::WORD_SIZE + (x + offx1)))
                         continue;
                     if (!(((unsigned char*)(b_arr + (y + offy2) * b_width + (x + offx2)))[3] != 0))
                         continue;
@@ -1072,13 +1142,24 @@ static bool collide_background_sprite(CollisionBase * in_a, CollisionBase * in_b
             }
         }
         else {
-            for (int y = 0; y < h; y++) {
-                for (int x = 0; x < w; x++) {
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
-                        continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
-                        continue;
-                    return true;
+            int b_stride = b_img->get_alpha_stride();
+            short * a_spans = a_img->get_alpha_spans();
+            short * b_spans = b_img->get_alpha_spans();
+            for (int y = 0; y < h; y++) {
+                int a_y = y + offy1;
+                int b_y = y + offy2;
+                int x1 = std::max(0, std::max(a_spans[a_y * 2] - offx1, b_spans[b_y * 2] - offx2));
+                int x2 = std::min(w, std::min(a_spans[a_y * 2 + 1] - offx1, b_spans[b_y * 2 + 1] - offx2));
+                if (x1 >= x2)
+                    continue;
+                BaseBitArray::word_t * a_row = a_alpha.data + a_y * a_stride;
+                BaseBitArray::word_t * b_row = b_alpha.data + b_y * b_stride;
+                for (int x = x1; x < x2; x += BaseBitArray::WORD_SIZE) {
+                    BaseBitArray::word_t bits = BaseBitArray::get_low_mask(x2 - x);
+                    bits &= BaseBitArray::get_word(a_row, a_stride, x + offx1);
+                    bits &= BaseBitArray::get_word(b_row, b_stride, x + offx2);
+                    if (bits != 0)
+                        return true;
                 }
             }
         }
@@ -1138,6 +1219,7 @@ static bool collide_background_tsprite(CollisionBase * in_a, CollisionBase * in_
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             int b_height = b_img->height;
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
@@ -1149,7 +1231,7 @@ static bool collide_background_tsprite(CollisionBase * in_a, CollisionBase * in_
                         continue;
                     if (!(((unsigned char*)(a_arr + (y + offy1) * a_width + (x + offx1)))[3] != 0))
                         continue;
-                    if (!b_alpha.get(b_yy * b_width + b_xx))
+                    if (!b_alpha.get(b_yy * b_stride * BaseBitArray::WORD_SIZE + b_xx))
                         continue;
                     return true;
                 }
@@ -1157,6 +1239,7 @@ static bool collide_background_tsprite(CollisionBase * in_a, CollisionBase * in_
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
         if (b->flags & BOX_COLLISION) {
             int b_height = b_img->height;
             for (int y = 0; y < h; y++) {
@@ -1167,7 +1250,7 @@ static bool collide_background_tsprite(CollisionBase * in_a, CollisionBase * in_
                     int b_yy = GET_SCALER_RESULT(b_yyv * b->co_divy + b_xxv * b->si_divy);
                     if ((b_xx | b_yy) < 0 || b_xx >= b_width || b_yy >= b_height)
                         continue;
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
+                    if (!a_alpha.get((y + offy1) * a_stride * BaseBitArray::WORD_SIZE + (x + offx1)))
                         continue;
                     return true;
                 }
@@ -1184,7 +1267,7 @@ static bool collide_background_tsprite(CollisionBase * in_a, CollisionBase * in_
                     int b_yy = GET_SCALER_RESULT(b_yyv * b->co_divy + b_xxv * b->si_divy);
                     if ((b_xx | b_yy) < 0 || b_xx >= b_width || b_yy >= b_height)
                         continue;
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
+                    if (!a_alpha.get((y + offy1) * a_stride * BaseBitArray::WORD_SIZE + (x + offx1)))
                         continue;
                     if (!(((unsigned char*)(b_arr + b_yy * b_width + b_xx))[3] != 0))
                         continue;
@@ -1193,6 +1276,7 @@ static bool collide_background_tsprite(CollisionBase * in_a, CollisionBase * in_
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             int b_height = b_img->height;
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
@@ -1202,9 +1286,9 @@ static bool collide_background_tsprite(CollisionBase * in_a, CollisionBase * in_
                     int b_yy = GET_SCALER_RESULT(b_yyv * b->co_divy + b_xxv * b->si_divy);
                     if ((b_xx | b_yy) < 0 || b_xx >= b_width || b_yy >= b_height)
                         continue;
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
+                    if (!a_alpha.get((y + offy1) * a_stride * BaseBitArray::WORD_SIZE + (x + offx1)))
                         continue;
-                    if (!b_alpha.get(b_yy * b_width + b_xx))
+                    if (!b_alpha.get(b_yy * b_stride * BaseBitArray::WORD_SIZE + b_xx))
                         continue;
                     return true;
                 }
@@ -1243,11 +1327,12 @@ static bool collide_background_background(CollisionBase * in_a, CollisionBase *
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
                     if (!(((unsigned char*)(a_arr + (y + offy1) * a_width + (x + offx1)))[3] != 0))
                         continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
+                    if (!b_alpha.get((y + offy2) * b_stride * BaseBitArray::WORD_SIZE + (x + offx2)))
                         continue;
                     return true;
                 }
@@ -1255,11 +1340,12 @@ static bool collide_background_background(CollisionBase * in_a, CollisionBase *
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
         if (b_alpha.data == NULL) {
             unsigned int * b_arr = (unsigned int*)b_img->image;
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
+                    if (!a_alpha.get((y + offy1) * a_stride * BaseBitArray::WORD_SIZE + (x + offx1)))
                         continue;
                     if (!(((unsigned char*)(b_arr + (y + offy2) * b_width + (x + offx2)))[3] != 0))
                         continue;
@@ -1268,13 +1354,24 @@ static bool collide_background_background(CollisionBase * in_a, CollisionBase *
             }
         }
         else {
-            for (int y = 0; y < h; y++) {
-                for (int x = 0; x < w; x++) {
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
-                        continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
-                        continue;
-                    return true;
+            int b_stride = b_img->get_alpha_stride();
+            short * a_spans = a_img->get_alpha_spans();
+            short * b_spans = b_img->get_alpha_spans();
+            for (int y = 0; y < h; y++) {
+                int a_y = y + offy1;
+                int b_y = y + offy2;
+                int x1 = std::max(0, std::max(a_spans[a_y * 2] - offx1, b_spans[b_y * 2] - offx2));
+                int x2 = std::min(w, std::min(a_spans[a_y * 2 + 1] - offx1, b_spans[b_y * 2 + 1] - offx2));
+                if (x1 >= x2)
+                    continue;
+                BaseBitArray::word_t * a_row = a_alpha.data + a_y * a_stride;
+                BaseBitArray::word_t * b_row = b_alpha.data + b_y * b_stride;
+                for (int x = x1; x < x2; x += BaseBitArray::WORD_SIZE) {
+                    BaseBitArray::word_t bits = BaseBitArray::get_low_mask(x2 - x);
+                    bits &= BaseBitArray::get_word(a_row, a_stride, x + offx1);
+                    bits &= BaseBitArray::get_word(b_row, b_stride, x + offx2);
+                    if (bits != 0)
+                        return true;
                 }
             }
         }
@@ -1309,11 +1406,12 @@ static bool collide_background_backdrop(CollisionBase * in_a, CollisionBase * in
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
                     if (!(((unsigned char*)(a_arr + (y + offy1) * a_width + (x + offx1)))[3] != 0))
                         continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
+                    if (!b_alpha.get((y + offy2) * b_stride * BaseBitArray::WORD_SIZE + (x + offx2)))
                         continue;
                     return true;
                 }
@@ -1321,11 +1419,12 @@ static bool collide_background_backdrop(CollisionBase * in_a, CollisionBase * in
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
         if (b_alpha.data == NULL) {
             unsigned int * b_arr = (unsigned int*)b_img->image;
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
+                    if (!a_alpha.get((y + offy1) * a_stride * BaseBitArray::WORD_SIZE + (x + offx1)))
                         continue;
                     if (!(((unsigned char*)(b_arr + (y + offy2) * b_width + (x + offx2)))[3] != 0))
                         continue;
@@ -1334,13 +1433,24 @@ static bool collide_background_backdrop(CollisionBase * in_a, CollisionBase * in
             }
         }
         else {
-            for (int y = 0; y < h; y++) {
-                for (int x = 0; x < w; x++) {
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
-                        continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
-                        continue;
-                    return true;
+            int b_stride = b_img->get_alpha_stride();
+            short * a_spans = a_img->get_alpha_spans();
+            short * b_spans = b_img->get_alpha_spans();
+            for (int y = 0; y < h; y++) {
+                int a_y = y + offy1;
+                int b_y = y + offy2;
+                int x1 = std::max(0, std::max(a_spans[a_y * 2] - offx1, b_spans[b_y * 2] - offx2));
+                int x2 = std::min(w, std::min(a_spans[a_y * 2 + 1] - offx1, b_spans[b_y * 2 + 1] - offx2));
+                if (x1 >= x2)
+                    continue;
+                BaseBitArray::word_t * a_row = a_alpha.data + a_y * a_stride;
+                BaseBitArray::word_t * b_row = b_alpha.data + b_y * b_stride;
+                for (int x = x1; x < x2; x += BaseBitArray::WORD_SIZE) {
+                    BaseBitArray::word_t bits = BaseBitArray::get_low_mask(x2 - x);
+                    bits &= BaseBitArray::get_word(a_row, a_stride, x + offx1);
+                    bits &= BaseBitArray::get_word(b_row, b_stride, x + offx2);
+                    if (bits != 0)
+                        return true;
                 }
             }
         }
@@ -1367,11 +1477,20 @@ static bool collide_background_box(CollisionBase * in_a, int w, int h, int offx1
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
+        short * a_spans = a_img->get_alpha_spans();
         for (int y = 0; y < h; y++) {
-            for (int x = 0; x < w; x++) {
-                if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
-                    continue;
-                return true;
+            int a_y = y + offy1;
+            int x1 = std::max(0, a_spans[a_y * 2] - offx1);
+            int x2 = std::min(w, a_spans[a_y * 2 + 1] - offx1);
+            if (x1 >= x2)
+                continue;
+            BaseBitArray::word_t * a_row = a_alpha.data + a_y * a_stride;
+            for (int x = x1; x < x2; x += BaseBitArray::WORD_SIZE) {
+                BaseBitArray::word_t bits = BaseBitArray::get_low_mask(x2 - x);
+                bits &= BaseBitArray::get_word(a_row, a_stride, x + offx1);
+                if (bits != 0)
+                    return true;
             }
         }
     }
@@ -1403,11 +1522,12 @@ static bool collide_backdrop_sprite(CollisionBase * in_a, CollisionBase * in_b,
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
                     if (!(((unsigned char*)(a_arr + (y + offy1) * a_width + (x + offx1)))[3] != 0))
                         continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
+                    if (!b_alpha.get((y + offy2) * b_stride * BaseBitArray::WORD_SIZE + (x + offx2)))
                         continue;
                     return true;
                 }
@@ -1415,11 +1535,12 @@ static bool collide_backdrop_sprite(CollisionBase * in_a, CollisionBase * in_b,
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
         if (b_alpha.data == NULL) {
             unsigned int * b_arr = (unsigned int*)b_img->image;
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
+                    if (!a_alpha.get((y + offy1) * a_stride * BaseBitArray::WORD_SIZE + (x + offx1)))
                         continue;
                     if (!(((unsigned char*)(b_arr + (y + offy2) * b_width + (x + offx2)))[3] != 0))
                         continue;
@@ -1428,13 +1549,24 @@ static bool collide_backdrop_sprite(CollisionBase * in_a, CollisionBase * in_b,
             }
         }
         else {
-            for (int y = 0; y < h; y++) {
-                for (int x = 0; x < w; x++) {
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
-                        continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
-                        continue;
-                    return true;
+            int b_stride = b_img->get_alpha_stride();
+            short * a_spans = a_img->get_alpha_spans();
+            short * b_spans = b_img->get_alpha_spans();
+            for (int y = 0; y < h; y++) {
+                int a_y = y + offy1;
+                int b_y = y + offy2;
+                int x1 = std::max(0, std::max(a_spans[a_y * 2] - offx1, b_spans[b_y * 2] - offx2));
+                int x2 = std::min(w, std::min(a_spans[a_y * 2 + 1] - offx1, b_spans[b_y * 2 + 1] - offx2));
+                if (x1 >= x2)
+                    continue;
+                BaseBitArray::word_t * a_row = a_alpha.data + a_y * a_stride;
+                BaseBitArray::word_t * b_row = b_alpha.data + b_y * b_stride;
+                for (int x = x1; x < x2; x += BaseBitArray::WORD_SIZE) {
+                    BaseBitArray::word_t bits = BaseBitArray::get_low_mask(x2 - x);
+                    bits &= BaseBitArray::get_word(a_row, a_stride, x + offx1);
+                    bits &= BaseBitArray::get_word(b_row, b_stride, x + offx2);
+                    if (bits != 0)
+                        return true;
                 }
             }
         }
@@ -1492,6 +1624,7 @@ static bool collide_backdrop_tsprite(CollisionBase * in_a, CollisionBase * in_b,
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             int b_height = b_img->height;
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
@@ -1503,7 +1636,7 @@ static bool collide_backdrop_tsprite(CollisionBase * in_a, CollisionBase * in_b,
                         continue;
                     if (!(((unsigned char*)(a_arr + (y + offy1) * a_width + (x + offx1)))[3] != 0))
                         continue;
-                    if (!b_alpha.get(b_yy * b_width + b_xx))
+                    if (!b_alpha.get(b_yy * b_stride * BaseBitArray::WORD_SIZE + b_xx))
                         continue;
                     return true;
                 }
@@ -1511,6 +1644,7 @@ static bool collide_backdrop_tsprite(CollisionBase * in_a, CollisionBase * in_b,
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
         if (b->flags & BOX_COLLISION) {
             int b_height = b_img->height;
             for (int y = 0; y < h; y++) {
@@ -1521,7 +1655,7 @@ static bool collide_backdrop_tsprite(CollisionBase * in_a, CollisionBase * in_b,
                     int b_yy = GET_SCALER_RESULT(b_yyv * b->co_divy + b_xxv * b->si_divy);
                     if ((b_xx | b_yy) < 0 || b_xx >= b_width || b_yy >= b_height)
                         continue;
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
+                    if (!a_alpha.get((y + offy1) * a_stride * BaseBitArray::WORD_SIZE + (x + offx1)))
                         continue;
                     return true;
                 }
@@ -1538,7 +1672,7 @@ static bool collide_backdrop_tsprite(CollisionBase * in_a, CollisionBase * in_b,
                     int b_yy = GET_SCALER_RESULT(b_yyv * b->co_divy + b_xxv * b->si_divy);
                     if ((b_xx | b_yy) < 0 || b_xx >= b_width || b_yy >= b_height)
                         continue;
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
+                    if (!a_alpha.get((y + offy1) * a_stride * BaseBitArray::WORD_SIZE + (x + offx1)))
                         continue;
                     if (!(((unsigned char*)(b_arr + b_yy * b_width + b_xx))[3] != 0))
                         continue;
@@ -1547,6 +1681,7 @@ static bool collide_backdrop_tsprite(CollisionBase * in_a, CollisionBase * in_b,
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             int b_height = b_img->height;
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
@@ -1556,9 +1691,9 @@ static bool collide_backdrop_tsprite(CollisionBase * in_a, CollisionBase * in_b,
                     int b_yy = GET_SCALER_RESULT(b_yyv * b->co_divy + b_xxv * b->si_divy);
                     if ((b_xx | b_yy) < 0 || b_xx >= b_width || b_yy >= b_height)
                         continue;
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
+                    if (!a_alpha.get((y + offy1) * a_stride * BaseBitArray::WORD_SIZE + (x + offx1)))
                         continue;
-                    if (!b_alpha.get(b_yy * b_width + b_xx))
+                    if (!b_alpha.get(b_yy * b_stride * BaseBitArray::WORD_SIZE + b_xx))
                         continue;
                     return true;
                 }
@@ -1595,11 +1730,12 @@ static bool collide_backdrop_background(CollisionBase * in_a, CollisionBase * in
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
                     if (!(((unsigned char*)(a_arr + (y + offy1) * a_width + (x + offx1)))[3] != 0))
                         continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
+                    if (!b_alpha.get((y + offy2) * b_stride * BaseBitArray::WORD_SIZE + (x + offx2)))
                         continue;
                     return true;
                 }
@@ -1607,11 +1743,12 @@ static bool collide_backdrop_background(CollisionBase * in_a, CollisionBase * in
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
         if (b_alpha.data == NULL) {
             unsigned int * b_arr = (unsigned int*)b_img->image;
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
+                    if (!a_alpha.get((y + offy1) * a_stride * BaseBitArray::WORD_SIZE + (x + offx1)))
                         continue;
                     if (!(((unsigned char*)(b_arr + (y + offy2) * b_width + (x + offx2)))[3] != 0))
                         continue;
@@ -1620,13 +1757,24 @@ static bool collide_backdrop_background(CollisionBase * in_a, CollisionBase * in
             }
         }
         else {
-            for (int y = 0; y < h; y++) {
-                for (int x = 0; x < w; x++) {
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
-                        continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
-                        continue;
-                    return true;
+            int b_stride = b_img->get_alpha_stride();
+            short * a_spans = a_img->get_alpha_spans();
+            short * b_spans = b_img->get_alpha_spans();
+            for (int y = 0; y < h; y++) {
+                int a_y = y + offy1;
+                int b_y = y + offy2;
+                int x1 = std::max(0, std::max(a_spans[a_y * 2] - offx1, b_spans[b_y * 2] - offx2));
+                int x2 = std::min(w, std::min(a_spans[a_y * 2 + 1] - offx1, b_spans[b_y * 2 + 1] - offx2));
+                if (x1 >= x2)
+                    continue;
+                BaseBitArray::word_t * a_row = a_alpha.data + a_y * a_stride;
+                BaseBitArray::word_t * b_row = b_alpha.data + b_y * b_stride;
+                for (int x = x1; x < x2; x += BaseBitArray::WORD_SIZE) {
+                    BaseBitArray::word_t bits = BaseBitArray::get_low_mask(x2 - x);
+                    bits &= BaseBitArray::get_word(a_row, a_stride, x + offx1);
+                    bits &= BaseBitArray::get_word(b_row, b_stride, x + offx2);
+                    if (bits != 0)
+                        return true;
                 }
             }
         }
@@ -1659,11 +1807,12 @@ static bool collide_backdrop_backdrop(CollisionBase * in_a, CollisionBase * in_b
             }
         }
         else {
+            int b_stride = b_img->get_alpha_stride();
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
                     if (!(((unsigned char*)(a_arr + (y + offy1) * a_width + (x + offx1)))[3] != 0))
                         continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
+                    if (!b_alpha.get((y + offy2) * b_stride * BaseBitArray::WORD_SIZE + (x + offx2)))
                         continue;
                     return true;
                 }
@@ -1671,11 +1820,12 @@ static bool collide_backdrop_backdrop(CollisionBase * in_a, CollisionBase * in_b
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
         if (b_alpha.data == NULL) {
             unsigned int * b_arr = (unsigned int*)b_img->image;
             for (int y = 0; y < h; y++) {
                 for (int x = 0; x < w; x++) {
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
+                    if (!a_alpha.get((y + offy1) * a_stride * BaseBitArray::WORD_SIZE + (x + offx1)))
                         continue;
                     if (!(((unsigned char*)(b_arr + (y + offy2) * b_width + (x + offx2)))[3] != 0))
                         continue;
@@ -1684,13 +1834,24 @@ static bool collide_backdrop_backdrop(CollisionBase * in_a, CollisionBase * in_b
             }
         }
         else {
-            for (int y = 0; y < h; y++) {
-                for (int x = 0; x < w; x++) {
-                    if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
-                        continue;
-                    if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
-                        continue;
-                    return true;
+            int b_stride = b_img->get_alpha_stride();
+            short * a_spans = a_img->get_alpha_spans();
+            short * b_spans = b_img->get_alpha_spans();
+            for (int y = 0; y < h; y++) {
+                int a_y = y + offy1;
+                int b_y = y + offy2;
+                int x1 = std::max(0, std::max(a_spans[a_y * 2] - offx1, b_spans[b_y * 2] - offx2));
+                int x2 = std::min(w, std::min(a_spans[a_y * 2 + 1] - offx1, b_spans[b_y * 2 + 1] - offx2));
+                if (x1 >= x2)
+                    continue;
+                BaseBitArray::word_t * a_row = a_alpha.data + a_y * a_stride;
+                BaseBitArray::word_t * b_row = b_alpha.data + b_y * b_stride;
+                for (int x = x1; x < x2; x += BaseBitArray::WORD_SIZE) {
+                    BaseBitArray::word_t bits = BaseBitArray::get_low_mask(x2 - x);
+                    bits &= BaseBitArray::get_word(a_row, a_stride, x + offx1);
+                    bits &= BaseBitArray::get_word(b_row, b_stride, x + offx2);
+                    if (bits != 0)
+                        return true;
                 }
             }
         }
@@ -1715,11 +1876,20 @@ static bool collide_backdrop_box(CollisionBase * in_a, int w, int h, int offx1,
         }
     }
     else {
+        int a_stride = a_img->get_alpha_stride();
+        short * a_spans = a_img->get_alpha_spans();
         for (int y = 0; y < h; y++) {
-            for (int x = 0; x < w; x++) {
-                if (!a_alpha.get((y + offy1) * a_width + (x + offx1)))
-                    continue;
-                return true;
+            int a_y = y + offy1;
+            int x1 = std::max(0, a_spans[a_y * 2] - offx1);
+            int x2 = std::min(w, a_spans[a_y * 2 + 1] - offx1);
+            if (x1 >= x2)
+                continue;
+            BaseBitArray::word_t * a_row = a_alpha.data + a_y * a_stride;
+            for (int x = x1; x < x2; x += BaseBitArray::WORD_SIZE) {
+                BaseBitArray::word_t bits = BaseBitArray::get_low_mask(x2 - x);
+                bits &= BaseBitArray::get_word(a_row, a_stride, x + offx1);
+                if (bits != 0)
+                    return true;
             }
         }
     }
@@ -1743,11 +1913,20 @@ static bool collide_box_sprite(CollisionBase * in_b, int w, int h, int offx2, in
         }
     }
     else {
+        int b_stride = b_img->get_alpha_stride();
+        short * b_spans = b_img->get_alpha_spans();
         for (int y = 0; y < h; y++) {
-            for (int x = 0; x < w; x++) {
-                if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
-                    continue;
-                return true;
+            int b_y = y + offy2;
+            int x1 = std::max(0, b_spans[b_y * 2] - offx2);
+            int x2 = std::min(w, b_spans[b_y * 2 + 1] - offx2);
+            if (x1 >= x2)
+                continue;
+            BaseBitArray::word_t * b_row = b_alpha.data + b_y * b_stride;
+            for (int x = x1; x < x2; x += BaseBitArray::WORD_SIZE) {
+                BaseBitArray::word_t bits = BaseBitArray::get_low_mask(x2 - x);
+                bits &= BaseBitArray::get_word(b_row, b_stride, x + offx2);
+                if (bits != 0)
+                    return true;
             }
         }
     }
@@ -1794,6 +1973,7 @@ static bool collide_box_tsprite(CollisionBase * in_b, int w, int h, int offx2, i
         }
     }
     else {
+        int b_stride = b_img->get_alpha_stride();
         int b_height = b_img->height;
         for (int y = 0; y < h; y++) {
             for (int x = 0; x < w; x++) {
@@ -1803,7 +1983,7 @@ static bool collide_box_tsprite(CollisionBase * in_b, int w, int h, int offx2, i
                 int b_yy = GET_SCALER_RESULT(b_yyv * b->co_divy + b_xxv * b->si_divy);
                 if ((b_xx | b_yy) < 0 || b_xx >= b_width || b_yy >= b_height)
                     continue;
-                if (!b_alpha.get(b_yy * b_width + b_xx))
+                if (!b_alpha.get(b_yy * b_stride * BaseBitArray::WORD_SIZE + b_xx))
                     continue;
                 return true;
             }
@@ -1831,11 +2011,20 @@ static bool collide_box_background(CollisionBase * in_b, int w, int h, int offx2
         }
     }
     else {
+        int b_stride = b_img->get_alpha_stride();
+        short * b_spans = b_img->get_alpha_spans();
         for (int y = 0; y < h; y++) {
-            for (int x = 0; x < w; x++) {
-                if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
-                    continue;
-                return true;
+            int b_y = y + offy2;
+            int x1 = std::max(0, b_spans[b_y * 2] - offx2);
+            int x2 = std::min(w, b_spans[b_y * 2 + 1] - offx2);
+            if (x1 >= x2)
+                continue;
+            BaseBitArray::word_t * b_row = b_alpha.data + b_y * b_stride;
+            for (int x = x1; x < x2; x += BaseBitArray::WORD_SIZE) {
+                BaseBitArray::word_t bits = BaseBitArray::get_low_mask(x2 - x);
+                bits &= BaseBitArray::get_word(b_row, b_stride, x + offx2);
+                if (bits != 0)
+                    return true;
             }
         }
     }
@@ -1859,11 +2048,20 @@ static bool collide_box_backdrop(CollisionBase * in_b, int w, int h, int offx2,
         }
     }
     else {
+        int b_stride = b_img->get_alpha_stride();
+        short * b_spans = b_img->get_alpha_spans();
         for (int y = 0; y < h; y++) {
-            for (int x = 0; x < w; x++) {
-                if (!b_alpha.get((y + offy2) * b_width + (x + offx2)))
-                    continue;
-                return true;
+            int b_y = y + offy2;
+            int x1 = std::max(0, b_spans[b_y * 2] - offx2);
+            int x2 = std::min(w, b_spans[b_y * 2 + 1] - offx2);
+            if (x1 >= x2)
+                continue;
+            BaseBitArray::word_t * b_row = b_alpha.data + b_y * b_stride;
+            for (int x = x1; x < x2; x += BaseBitArray::WORD_SIZE) {
+                BaseBitArray::word_t bits = BaseBitArray::get_low_mask(x2 - x);
+                bits &= BaseBitArray::get_word(b_row, b_stride, x + offx2);
+                if (bits != 0)
+                    return true;
             }
         }
     }
@@ -27,6 +27,8 @@ class Case(object):
 
     def __init__(self, name, x, y):
         self.name = name
+        self.off_x = x
+        self.off_y = y
         self.loop_x = '(x + %s)' % x
         self.loop_y = '(y + %s)' % y
 
@@ -64,9 +66,13 @@ class AlphaCase(Case):
     def get_cond(self):
         return '%s_alpha.data != NULL' % self.name
 
+    def write_init(self, writer):
+        writer.putlnc('int %s_stride = %s_img->get_alpha_stride();',
+                      self.name, self.name)
+
     def get_alpha(self):
-        return '%s_alpha.get(%s * %s_width + %s)' % (self.name, self.loop_y,
-                                                     self.name, self.loop_x)
+        return ('%s_alpha.get(%s * %s_stride * BaseBitArray::WORD_SIZE + %s)'
+                % (self.name, self.loop_y, self.name, self.loop_x))
 
 class ImageBoxCase(BoxCase):
     def get_cond(self):
@@ -177,6 +183,65 @@ def write_case(writer, case1, case2):
     writer.end_brace()
     writer.end_brace()
 
+def nest_call(func, values):
+    expr = values[-1]
+    for value in reversed(values[:-1]):
+        expr = '%s(%s, %s)' % (func, value, expr)
+    return expr
+
+def write_mask_case(writer, cases):
+    # row-oriented version for untransformed masks. skips rows where the
+    # occupied spans do not intersect, then ANDs whole words at a time
+    for case in cases:
+        writer.putlnc('short * %s_spans = %s_img->get_alpha_spans();',
+                      case.name, case.name)
+    writer.putln('for (int y = 0; y < h; y++) {')
+    writer.indent()
+    x1 = ['0']
+    x2 = ['w']
+    for case in cases:
+        writer.putlnc('int %s_y = y + %s;', case.name, case.off_y)
+        x1.append('%s_spans[%s_y * 2] - %s' % (case.name, case.name,
+                                               case.off_x))
+        x2.append('%s_spans[%s_y * 2 + 1] - %s' % (case.name, case.name,
+                                                   case.off_x))
+    writer.putlnc('int x1 = %s;', nest_call('std::max', x1))
+    writer.putlnc('int x2 = %s;', nest_call('std::min', x2))
+    writer.putln('if (x1 >= x2)')
+    writer.indent()
+    writer.putln('continue;')
+    writer.dedent()
+    for case in cases:
+        writer.putlnc('BaseBitArray::word_t * %s_row = %s_alpha.data + '
+                      '%s_y * %s_stride;', case.name, case.name, case.name,
+                      case.name)
+    writer.putln('for (int x = x1; x < x2; x += BaseBitArray::WORD_SIZE) {')
+    writer.indent()
+    writer.putln('BaseBitArray::word_t bits = '
+                 'BaseBitArray::get_low_mask(x2 - x);')
+    for case in cases:
+        writer.putlnc('bits &= BaseBitArray::get_word(%s_row, %s_stride, '
+                      'x + %s);', case.name, case.name, case.off_x)
+    writer.putln('if (bits != 0)')
+    writer.indent()
+    writer.putln('return true;')
+    writer.dedent()
+    writer.end_brace()
+    writer.end_brace()
+
+def get_mask_cases(name1, case1, name2, case2):
+    if 'tsprite' in (name1, name2):
+        return None
+    cases = []
+    for case in (case1, case2):
+        if isinstance(case, AlphaCase):
+            cases.append(case)
+        elif not isinstance(case, BoxCase):
+            return None
+    if not cases:
+        return None
+    return cases
+
 def write_func(writer, name1, type1, name2, type2):
     args = []
     if type1 is not None:
@@ -205,7 +270,11 @@ def write_func(writer, name1, type1, name2, type2):
         has_cond1 = write_cond(writer, case1, i1, cases_1)
         for i2, case2 in enumerate(cases_2):
             has_cond2 = write_cond(writer, case2, i2, cases_2)
-            write_case(writer, case1, case2)
+            mask_cases = get_mask_cases(name1, case1, name2, case2)
+            if mask_cases is None:
+                write_case(writer, case1, case2)
+            else:
+                write_mask_case(writer, mask_cases)
 
             if has_cond2:
                 writer.end_brace()
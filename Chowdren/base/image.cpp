@@ -4,12 +4,14 @@
 #include "color.h"
 #include <iostream>
 #include <stdio.h>
+#include <algorithm>
 #include "datastream.h"
 #include "chowconfig.h"
 #include "types.h"
 #include "mathcommon.h"
 #include "assetfile.h"
 #include "render.h"
+#include "trace.h"
 
 #define STBI_NO_STDIO
 #define STBI_NO_HDR
@@ -18,6 +20,12 @@
 #define STBI_ONLY_BMP
 #include "stb_image.h"
 
+// the loader threads are SDL threads
+#if defined(CHOWDREN_ASYNC_IMAGES) && (!defined(CHOWDREN_IS_DESKTOP) || \
+                                       defined(CHOWDREN_IS_EMSCRIPTEN))
+#undef CHOWDREN_ASYNC_IMAGES
+#endif
+
 inline unsigned char * load_png_image(FSFile & image_file, int size,
                                       int * w, int * h, int * channels)
 {
@@ -46,6 +54,18 @@ inline unsigned char * load_image(FSFile & image_file, int size,
 
 #endif
 
+// decodes straight from the mapped asset file when possible
+inline unsigned char * load_image(AssetFile & fp, int size,
+                                  int * w, int * h, int * channels)
+{
+#ifdef CHOWDREN_ASSET_MMAP
+    const unsigned char * data = fp.read_view(size);
+    if (data != NULL)
+        return stbi_load_from_memory(data, size, w, h, channels, 4);
+#endif
+    return load_image((FSFile&)fp, size, w, h, channels);
+}
+
 typedef vector<Image*> ImageList;
 
 static AssetFile image_file;
@@ -57,21 +77,202 @@ void open_image_file()
     image_file.open();
 }
 
+#ifdef CHOWDREN_USE_ATLAS
+
+// atlas pages are decoded once and kept in memory until the next
+// flush_atlas_pages(), so all images of a page can be cut out of it
+
+struct AtlasPage
+{
+    Texture tex;
+    unsigned char * image;
+    int width, height;
+    int users;
+};
+
+static AtlasPage atlas_pages[ATLAS_ARRAY_SIZE];
+
+static AtlasPage & load_atlas_page(int index)
+{
+    AtlasPage & page = atlas_pages[index];
+    if (page.image != NULL)
+        return page;
+    open_image_file();
+    image_file.set_item(index, AssetFile::ATLAS_DATA);
+    FileStream stream(image_file);
+    int size = stream.read_uint32();
+    int channels;
+    page.image = load_image(image_file, size, &page.width, &page.height,
+                            &channels);
+    if (page.image == NULL) {
+        std::cout << "Could not load atlas page " << index << std::endl;
+        std::cout << stbi_failure_reason() << std::endl;
+    }
+    return page;
+}
+
+static unsigned char * load_atlas_image(int index, int x, int y,
+                                        int w, int h)
+{
+    AtlasPage & page = load_atlas_page(index);
+    if (page.image == NULL)
+        return NULL;
+    unsigned char * image = (unsigned char*)malloc(w * h * 4);
+    for (int yy = 0; yy < h; yy++) {
+        memcpy(&image[yy * w * 4],
+               &page.image[((y + yy) * page.width + x) * 4],
+               w * 4);
+    }
+    return image;
+}
+
+static Texture acquire_atlas_page(int index)
+{
+    AtlasPage & page = atlas_pages[index];
+    page.users++;
+    if (page.tex != 0)
+        return page.tex;
+    load_atlas_page(index);
+    if (page.image == NULL)
+        return 0;
+    page.tex = Render::create_tex(page.image, Render::RGBA,
+                                  page.width, page.height);
+    Render::set_filter(page.tex, (Image::DEFAULT_FLAGS &
+                                  Image::LINEAR_FILTER) != 0);
+    return page.tex;
+}
+
+static void release_atlas_page(int index)
+{
+    AtlasPage & page = atlas_pages[index];
+    page.users--;
+}
+
+void flush_atlas_pages()
+{
+    for (int i = 0; i < ATLAS_COUNT; i++) {
+        AtlasPage & page = atlas_pages[i];
+        if (page.image != NULL) {
+            stbi_image_free(page.image);
+            page.image = NULL;
+        }
+        if (page.users > 0 || page.tex == 0)
+            continue;
+        Render::delete_tex(page.tex);
+        page.tex = 0;
+    }
+}
+
+#endif
+
+// image entry as read from Assets.dat. for atlas images, only the rect is
+// read, since the pixels are cut out of the shared page later
+
+struct DecodedImage
+{
+    short hotspot_x, hotspot_y, action_x, action_y;
+    int width, height;
+    unsigned char * image;
+#ifdef CHOWDREN_USE_ATLAS
+    short atlas_page, atlas_x, atlas_y;
+    float tex_x1, tex_y1, tex_x2, tex_y2;
+#endif
+};
+
+// does not touch any shared state, so it may run on a loader thread
+static void read_image(AssetFile & fp, DecodedImage & data)
+{
+    FileStream stream(fp);
+
+    data.hotspot_x = stream.read_int16();
+    data.hotspot_y = stream.read_int16();
+    data.action_x = stream.read_int16();
+    data.action_y = stream.read_int16();
+
+#ifdef CHOWDREN_USE_ATLAS
+    data.atlas_page = stream.read_int16();
+    if (data.atlas_page != -1) {
+        data.atlas_x = stream.read_int16();
+        data.atlas_y = stream.read_int16();
+        data.width = stream.read_int16();
+        data.height = stream.read_int16();
+        data.tex_x1 = stream.read_float();
+        data.tex_y1 = stream.read_float();
+        data.tex_x2 = stream.read_float();
+        data.tex_y2 = stream.read_float();
+        data.image = NULL;
+        return;
+    }
+#endif
+
+    int size = stream.read_uint32();
+    int channels;
+    data.image = load_image(fp, size, &data.width, &data.height, &channels);
+}
+
+static void apply_image(Image & image, DecodedImage & data)
+{
+    image.hotspot_x = data.hotspot_x;
+    image.hotspot_y = data.hotspot_y;
+    image.action_x = data.action_x;
+    image.action_y = data.action_y;
+    image.width = data.width;
+    image.height = data.height;
+
+#ifdef CHOWDREN_USE_ATLAS
+    image.atlas_page = data.atlas_page;
+    if (data.atlas_page != -1) {
+        if (!(image.flags & Image::STANDALONE)) {
+            image.tex_x1 = data.tex_x1;
+            image.tex_y1 = data.tex_y1;
+            image.tex_x2 = data.tex_x2;
+            image.tex_y2 = data.tex_y2;
+        }
+        image.image = load_atlas_image(data.atlas_page,
+                                       data.atlas_x, data.atlas_y,
+                                       data.width, data.height);
+        if (image.image == NULL)
+            std::cout << "Could not load image " << image.handle << std::endl;
+        return;
+    }
+#endif
+
+    image.image = data.image;
+
+    if (image.image == NULL) {
+        std::cout << "Could not load image " << image.handle << std::endl;
+        std::cout << stbi_failure_reason() << std::endl;
+    }
+}
+
+#ifdef CHOWDREN_ASYNC_IMAGES
+static bool take_image_job(int handle, DecodedImage & data);
+#endif
+
+#ifdef CHOWDREN_USE_ATLAS
+#define INIT_ATLAS_PAGE , atlas_page(-1)
+#else
+#define INIT_ATLAS_PAGE
+#endif
+
 // dummy constructor
 Image::Image()
 : handle(0), flags(DEFAULT_FLAGS), tex(0), image(NULL), width(0), height(0),
-  hotspot_x(0), hotspot_y(0), action_x(0), action_y(0)
+  hotspot_x(0), hotspot_y(0), action_x(0), action_y(0),
+  tex_x1(0.0f), tex_y1(0.0f), tex_x2(1.0f), tex_y2(1.0f) INIT_ATLAS_PAGE
 {
 }
 
 Image::Image(int hot_x, int hot_y, int act_x, int act_y)
 : handle(0), flags(DEFAULT_FLAGS), tex(0), image(NULL), width(0), height(0),
-  hotspot_x(hot_x), hotspot_y(hot_y), action_x(act_x), action_y(act_y)
+  hotspot_x(hot_x), hotspot_y(hot_y), action_x(act_x), action_y(act_y),
+  tex_x1(0.0f), tex_y1(0.0f), tex_x2(1.0f), tex_y2(1.0f) INIT_ATLAS_PAGE
 {
 }
 
 Image::Image(int handle)
-: handle(handle), tex(0), image(NULL), flags(DEFAULT_FLAGS)
+: handle(handle), tex(0), image(NULL), flags(DEFAULT_FLAGS),
+  tex_x1(0.0f), tex_y1(0.0f), tex_x2(1.0f), tex_y2(1.0f) INIT_ATLAS_PAGE
 {
 }
 
@@ -100,6 +301,7 @@ Image * Image::copy()
         } else {
             new_image = new Image(handle);
         }
+        new_image->flags |= STANDALONE;
         new_image->load();
         return new_image;
     }
@@ -130,34 +332,29 @@ void Image::load()
         return;
     }
 
-    open_image_file();
-    image_file.set_item(handle, AssetFile::IMAGE_DATA);
-    FileStream stream(image_file);
-
-    hotspot_x = stream.read_int16();
-    hotspot_y = stream.read_int16();
-    action_x = stream.read_int16();
-    action_y = stream.read_int16();
+    TRACE_ZONE("Image::load");
 
-    int size = stream.read_uint32();
-
-    int w, h, channels;
-    image = load_image(image_file, size, &w, &h, &channels);
-
-    width = w;
-    height = h;
-
-    if (image == NULL) {
-        std::cout << "Could not load image " << handle << std::endl;
-        std::cout << stbi_failure_reason() << std::endl;
-        return;
+    DecodedImage data;
+#ifdef CHOWDREN_ASYNC_IMAGES
+    if (!take_image_job(handle, data))
+#endif
+    {
+        open_image_file();
+        image_file.set_item(handle, AssetFile::IMAGE_DATA);
+        read_image(image_file, data);
     }
+    apply_image(*this, data);
 }
 
 void Image::unload()
 {
     if (image != NULL)
         stbi_image_free(image);
+#ifdef CHOWDREN_USE_ATLAS
+    if (tex != 0 && is_atlas_texture())
+        release_atlas_page(atlas_page);
+    else
+#endif
     if (tex != 0)
         Render::delete_tex(tex);
     image = NULL;
@@ -191,29 +388,52 @@ void Image::upload_texture()
         return;
 
 #ifndef CHOWDREN_IS_WIIU
-    // create alpha mask
-    int size = width * height;
-    BaseBitArray::word_t * data;
-    data = (BaseBitArray::word_t*)malloc(GET_BITARRAY_SIZE(size) * 4);
-    int i = 0;
-    int ii = 0;
-    unsigned char c;
-
-    while (i < size) {
-        BaseBitArray::word_t word = 0;
-        for (BaseBitArray::word_t m = 1UL; m != 0UL; m <<= 1UL) {
-            c = ((unsigned char*)(((unsigned int*)image) + i))[3];
-            if (c != 0)
-                word |= m;
-            ++i;
-            if (i >= size)
-                break;
+    // create alpha mask, see get_alpha_stride/get_alpha_spans
+    int stride = get_alpha_stride();
+    int mask_size = GET_BITARRAY_SIZE(width) * height +
+                    sizeof(short) * 2 * height;
+    BaseBitArray::word_t * data = (BaseBitArray::word_t*)malloc(mask_size);
+    short * spans = (short*)(data + stride * height);
+    unsigned int * pixels = (unsigned int*)image;
+
+    for (int y = 0; y < height; y++) {
+        BaseBitArray::word_t * row = data + y * stride;
+        int start = width;
+        int end = 0;
+        for (int i = 0; i < stride; i++) {
+            BaseBitArray::word_t word = 0;
+            int x1 = i * BaseBitArray::WORD_SIZE;
+            int x2 = std::min<int>(width, x1 + BaseBitArray::WORD_SIZE);
+            for (int x = x1; x < x2; x++) {
+                unsigned char c = ((unsigned char*)(pixels + y * width + x))[3];
+                if (c == 0)
+                    continue;
+                word |= BaseBitArray::word_t(1) << (x - x1);
+                start = std::min(start, x);
+                end = x + 1;
+            }
+            row[i] = word;
         }
-        data[ii++] = word;
+        if (start >= end)
+            start = end = 0;
+        spans[y * 2] = start;
+        spans[y * 2 + 1] = end;
     }
 
     alpha.data = data;
 #endif
+
+#ifdef CHOWDREN_USE_ATLAS
+    if (is_atlas_texture()) {
+        tex = acquire_atlas_page(atlas_page);
+        if (flags & KEEP)
+            return;
+        stbi_image_free(image);
+        image = NULL;
+        return;
+    }
+#endif
+
     int gl_width, gl_height;
 
 #ifdef CHOWDREN_NO_NPOT
@@ -272,9 +492,40 @@ void Image::set_filter(bool linear)
     if (tex == 0)
         return;
 
+#ifdef CHOWDREN_USE_ATLAS
+    if (is_atlas_texture()) {
+        // the filter is shared by the whole page, so move out of it
+        set_standalone();
+        return;
+    }
+#endif
+
     Render::set_filter(tex, linear);
 }
 
+void Image::set_standalone()
+{
+    if (flags & STANDALONE)
+        return;
+    flags |= STANDALONE;
+#ifdef CHOWDREN_USE_ATLAS
+    if (atlas_page == -1)
+        return;
+    tex_x1 = tex_y1 = 0.0f;
+    tex_x2 = tex_y2 = 1.0f;
+    if (tex == 0)
+        return;
+    release_atlas_page(atlas_page);
+    tex = 0;
+#ifndef CHOWDREN_IS_WIIU
+    free(alpha.data);
+    alpha.data = NULL;
+#endif
+    if (image == NULL)
+        load();
+#endif
+}
+
 const float flipped_texcoords[8] = {
     1.0f, 0.0f,
     0.0f, 0.0f,
@@ -320,7 +571,8 @@ void Image::draw(int x, int y, Color color,
     if (angle == 0.0f && scale_x == 1.0f && scale_y == 1.0f) {
         int xx = x - hotspot_x;
         int yy = y - hotspot_y;
-        Render::draw_tex(xx, yy, xx + width, yy + height, color, tex);
+        Render::draw_tex(xx, yy, xx + width, yy + height, color, tex,
+                         tex_x1, tex_y1, tex_x2, tex_y2);
         return;
     }
 
@@ -348,7 +600,7 @@ void Image::draw(int x, int y, Color color,
         x2c + y2s + x, x2s + y2c + y,
         x1c + y2s + x, x1s + y2c + y
     };
-    Render::draw_tex(&p[0], color, tex);
+    Render::draw_tex(&p[0], color, tex, tex_x1, tex_y1, tex_x2, tex_y2);
 }
 
 void Image::draw_flip_x(int x, int y, Color color,
@@ -364,7 +616,8 @@ void Image::draw_flip_x(int x, int y, Color color,
     if (angle == 0.0f && scale_x == 1.0f && scale_y == 1.0f) {
         int xx = x - hotspot_x;
         int yy = y - hotspot_y;
-        Render::draw_tex(xx + width, yy, xx, yy + height, color, tex);
+        Render::draw_tex(xx + width, yy, xx, yy + height, color, tex,
+                         tex_x1, tex_y1, tex_x2, tex_y2);
         return;
     }
 
@@ -392,7 +645,7 @@ void Image::draw_flip_x(int x, int y, Color color,
         x2c + y2s + x, x2s + y2c + y,
         x1c + y2s + x, x1s + y2c + y
     };
-    Render::draw_tex(&p[0], color, tex);
+    Render::draw_tex(&p[0], color, tex, tex_x1, tex_y1, tex_x2, tex_y2);
 }
 
 void Image::draw(int x, int y, int src_x, int src_y, int w, int h, Color c)
@@ -407,10 +660,10 @@ void Image::draw(int x, int y, int src_x, int src_y, int w, int h, Color c)
     int x2 = x + w;
     int y2 = y + h;
 
-    float t_x1 = float(src_x) / float(width);
-    float t_x2 = t_x1 + float(w) / float(width);
-    float t_y1 = float(src_y) / float(height);
-    float t_y2 = t_y1 + float(h) / float(height);
+    float t_x1 = get_tex_x(float(src_x) / float(width));
+    float t_x2 = get_tex_x(float(src_x + w) / float(width));
+    float t_y1 = get_tex_y(float(src_y) / float(height));
+    float t_y2 = get_tex_y(float(src_y + h) / float(height));
     Render::draw_tex(x, y, x2, y2, c, tex, t_x1, t_y1, t_x2, t_y2);
 }
 
@@ -430,6 +683,7 @@ FileImage::FileImage(const std::string & filename, int hot_x, int hot_y,
 
 void FileImage::load_file()
 {
+    TRACE_ZONE("FileImage::load_file");
     FSFile fp(filename.c_str(), "r");
 
     if (!fp.is_open()) {
@@ -472,17 +726,20 @@ static Image * internal_images[IMAGE_COUNT];
 typedef hash_map<std::string, FileImage*> ImageCache;
 static ImageCache image_cache;
 
-Image * get_internal_image(unsigned int i)
+static Image * get_cached_image(unsigned int i)
 {
     if (internal_images[i] == NULL) {
         internal_images[i] = new Image(i);
         internal_images[i]->flags |= Image::CACHED;
     }
+    return internal_images[i];
+}
 
-    Image * image = internal_images[i];
+Image * get_internal_image(unsigned int i)
+{
+    Image * image = get_cached_image(i);
     image->load();
-
-    return internal_images[i];
+    return image;
 }
 
 Image * get_image_cache(const std::string & filename, int hot_x, int hot_y,
@@ -506,6 +763,205 @@ Image * get_image_cache(const std::string & filename, int hot_x, int hot_y,
     return image;
 }
 
+// background image decoding
+
+#ifdef CHOWDREN_ASYNC_IMAGES
+
+#include <SDL_thread.h>
+#include <SDL_mutex.h>
+
+#ifndef CHOWDREN_IMAGE_WORKERS
+#define CHOWDREN_IMAGE_WORKERS 2
+#endif
+
+// the workers only read and decode into a DecodedImage. the result is moved
+// into the Image on the main thread, either in update_image_loader() or when
+// Image::load() needs it right away, so textures are only created there
+
+struct ImageJob
+{
+    enum State
+    {
+        QUEUED = 0,
+        DECODING,
+        DONE,
+        // taken over by Image::load() before a worker got to it
+        CANCELLED
+    };
+
+    unsigned short handle;
+    int state;
+    DecodedImage data;
+};
+
+struct ImageLoader
+{
+    SDL_mutex * mutex;
+    // signaled when jobs are queued
+    SDL_cond * queue_cond;
+    // signaled when a job is done
+    SDL_cond * done_cond;
+    SDL_Thread * threads[CHOWDREN_IMAGE_WORKERS];
+    AssetFile files[CHOWDREN_IMAGE_WORKERS];
+
+    // active job for each handle, only changed on the main thread
+    ImageJob * jobs[IMAGE_ARRAY_SIZE];
+    vector<ImageJob*> queue;
+    unsigned int queue_pos;
+    vector<ImageJob*> done;
+};
+
+static ImageLoader * image_loader = NULL;
+
+static int image_worker(void * data)
+{
+    ImageLoader & loader = *image_loader;
+    AssetFile & fp = *((AssetFile*)data);
+    TRACE_THREAD("Image loader");
+
+    SDL_LockMutex(loader.mutex);
+    while (true) {
+        if (loader.queue_pos >= loader.queue.size()) {
+            loader.queue.clear();
+            loader.queue_pos = 0;
+            SDL_CondWait(loader.queue_cond, loader.mutex);
+            continue;
+        }
+        ImageJob * job = loader.queue[loader.queue_pos++];
+        if (job->state == ImageJob::CANCELLED) {
+            delete job;
+            continue;
+        }
+        job->state = ImageJob::DECODING;
+        SDL_UnlockMutex(loader.mutex);
+
+        TRACE_BEGIN("decode_image");
+        fp.set_item(job->handle, AssetFile::IMAGE_DATA);
+        read_image(fp, job->data);
+        TRACE_END();
+
+        SDL_LockMutex(loader.mutex);
+        job->state = ImageJob::DONE;
+        loader.done.push_back(job);
+        SDL_CondBroadcast(loader.done_cond);
+    }
+    return 0;
+}
+
+static void start_image_loader()
+{
+    image_loader = new ImageLoader;
+    ImageLoader & loader = *image_loader;
+    loader.mutex = SDL_CreateMutex();
+    loader.queue_cond = SDL_CreateCond();
+    loader.done_cond = SDL_CreateCond();
+    loader.queue_pos = 0;
+    for (int i = 0; i < IMAGE_ARRAY_SIZE; i++)
+        loader.jobs[i] = NULL;
+
+    for (int i = 0; i < CHOWDREN_IMAGE_WORKERS; i++) {
+        // the first set_item reads the offset tables, so do it before
+        // there are several threads
+        AssetFile & fp = loader.files[i];
+        fp.open();
+        fp.set_item(0, AssetFile::IMAGE_DATA);
+        loader.threads[i] = SDL_CreateThread(image_worker, "Image loader",
+                                             &fp);
+    }
+}
+
+static void remove_done_job(ImageJob * job)
+{
+    vector<ImageJob*> & done = image_loader->done;
+    done.erase(std::find(done.begin(), done.end(), job));
+}
+
+static bool take_image_job(int handle, DecodedImage & data)
+{
+    if (image_loader == NULL)
+        return false;
+    ImageLoader & loader = *image_loader;
+    ImageJob * job = loader.jobs[handle];
+    if (job == NULL)
+        return false;
+    loader.jobs[handle] = NULL;
+
+    SDL_LockMutex(loader.mutex);
+    if (job->state == ImageJob::QUEUED) {
+        // faster to decode it here than to wait for the rest of the queue
+        job->state = ImageJob::CANCELLED;
+        SDL_UnlockMutex(loader.mutex);
+        return false;
+    }
+    while (job->state != ImageJob::DONE)
+        SDL_CondWait(loader.done_cond, loader.mutex);
+    remove_done_job(job);
+    SDL_UnlockMutex(loader.mutex);
+
+    data = job->data;
+    delete job;
+    return true;
+}
+
+#endif
+
+void prefetch_image(unsigned int handle)
+{
+#ifdef CHOWDREN_ASYNC_IMAGES
+    Image * image = get_cached_image(handle);
+    // keeps the image through the next reset_image_cache/flush_image_cache
+    image->flags |= Image::PREFETCH;
+    if (image->is_valid())
+        return;
+
+    if (image_loader == NULL)
+        start_image_loader();
+    ImageLoader & loader = *image_loader;
+    if (loader.jobs[handle] != NULL)
+        return;
+
+    ImageJob * job = new ImageJob;
+    job->handle = handle;
+    job->state = ImageJob::QUEUED;
+    loader.jobs[handle] = job;
+
+    SDL_LockMutex(loader.mutex);
+    loader.queue.push_back(job);
+    SDL_CondSignal(loader.queue_cond);
+    SDL_UnlockMutex(loader.mutex);
+#endif
+}
+
+void update_image_loader()
+{
+#ifdef CHOWDREN_ASYNC_IMAGES
+    if (image_loader == NULL)
+        return;
+    ImageLoader & loader = *image_loader;
+
+    static vector<ImageJob*> done;
+    SDL_LockMutex(loader.mutex);
+    done.swap(loader.done);
+    SDL_UnlockMutex(loader.mutex);
+
+    vector<ImageJob*>::iterator it;
+    for (it = done.begin(); it != done.end(); ++it) {
+        ImageJob * job = *it;
+        loader.jobs[job->handle] = NULL;
+        Image * image = internal_images[job->handle];
+        if (image->is_valid()) {
+            if (job->data.image != NULL)
+                stbi_image_free(job->data.image);
+        } else {
+            apply_image(*image, job->data);
+            image->upload_texture();
+        }
+        delete job;
+    }
+    done.clear();
+#endif
+}
+
 void reset_image_cache()
 {
 #ifdef CHOWDREN_TEXTURE_GC
@@ -513,7 +969,10 @@ void reset_image_cache()
         Image * image = internal_images[i];
         if (image == NULL)
             continue;
-        image->flags &= ~Image::USED;
+        if (image->flags & Image::PREFETCH)
+            image->flags = (image->flags & ~Image::PREFETCH) | Image::USED;
+        else
+            image->flags &= ~Image::USED;
     }
 #endif
 }
@@ -528,6 +987,9 @@ void flush_image_cache()
         image->unload();
     }
 #endif
+#ifdef CHOWDREN_USE_ATLAS
+    flush_atlas_pages();
+#endif
 }
 
 void preload_images()
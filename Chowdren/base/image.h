@@ -24,6 +24,10 @@ public:
         STATIC = 1 << 3,
         KEEP = 1 << 4,
         LINEAR_FILTER = 1 << 5,
+        // do not use the atlas page, even if the image was packed into one
+        STANDALONE = 1 << 6,
+        // requested by prefetch_image() for the next frame
+        PREFETCH = 1 << 7,
 #ifdef CHOWDREN_QUICK_SCALE
         DEFAULT_FLAGS = 0
 #else
@@ -36,6 +40,8 @@ public:
     short hotspot_x, hotspot_y, action_x, action_y;
     short width, height;
     GLuint tex;
+    // texture coordinates of the image inside tex
+    float tex_x1, tex_y1, tex_x2, tex_y2;
     unsigned char * image;
 #ifndef CHOWDREN_IS_WIIU
     BitArray alpha;
@@ -45,6 +51,10 @@ public:
     short pot_w, pot_h;
 #endif
 
+#ifdef CHOWDREN_USE_ATLAS
+    short atlas_page;
+#endif
+
     Image();
     Image(int hot_x, int hot_y, int act_x, int act_y);
     Image(int handle);
@@ -63,8 +73,40 @@ public:
     bool is_valid();
     void unload();
     void set_filter(bool linear);
+    void set_standalone();
     // inline methods
 
+#ifdef CHOWDREN_USE_ATLAS
+    bool is_atlas_texture()
+    {
+        return atlas_page != -1 && !(flags & STANDALONE);
+    }
+#endif
+
+    float get_tex_x(float x)
+    {
+        return tex_x1 + x * (tex_x2 - tex_x1);
+    }
+
+    float get_tex_y(float y)
+    {
+        return tex_y1 + y * (tex_y2 - tex_y1);
+    }
+
+#ifndef CHOWDREN_IS_WIIU
+    // each row of the alpha mask starts on a word boundary. the rows are
+    // followed by the [first, last + 1) span of set bits for each row
+    int get_alpha_stride()
+    {
+        return GET_BITARRAY_ITEMS(width);
+    }
+
+    short * get_alpha_spans()
+    {
+        return (short*)(alpha.data + get_alpha_stride() * height);
+    }
+#endif
+
     bool get_alpha(int x, int y)
     {
     #ifdef CHOWDREN_IS_WIIU
@@ -74,8 +116,10 @@ public:
             return c != 0;
         }
     #else
-        if (alpha.data != NULL)
-            return alpha.get(y * width + x) != 0;
+        if (alpha.data != NULL) {
+            int index = y * get_alpha_stride() * BaseBitArray::WORD_SIZE + x;
+            return alpha.get(index) != 0;
+        }
     #endif
         unsigned int * v = (unsigned int*)image + y * width + x;
         unsigned char c = ((unsigned char*)v)[3];
@@ -100,6 +144,11 @@ Image * get_image_cache(const std::string & filename, int hot_x, int hot_y,
 void reset_image_cache();
 void flush_image_cache();
 void preload_images();
+void prefetch_image(unsigned int handle);
+void update_image_loader();
+#ifdef CHOWDREN_USE_ATLAS
+void flush_atlas_pages();
+#endif
 
 extern Image dummy_image;
 
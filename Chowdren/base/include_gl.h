@@ -14,6 +14,7 @@ extern PFNGLCLIENTACTIVETEXTUREARBPROC __glClientActiveTextureARB;
 extern PFNGLGENFRAMEBUFFERSEXTPROC __glGenFramebuffersEXT;
 extern PFNGLFRAMEBUFFERTEXTURE2DEXTPROC __glFramebufferTexture2DEXT;
 extern PFNGLBINDFRAMEBUFFEREXTPROC __glBindFramebufferEXT;
+extern PFNGLDELETEFRAMEBUFFERSEXTPROC __glDeleteFramebuffersEXT;
 
 extern PFNGLUSEPROGRAMOBJECTARBPROC __glUseProgramObjectARB;
 extern PFNGLDETACHOBJECTARBPROC __glDetachObjectARB;
@@ -39,6 +40,7 @@ extern PFNGLGETUNIFORMLOCATIONARBPROC __glGetUniformLocationARB;
 #define glGenFramebuffers __glGenFramebuffersEXT
 #define glBindFramebuffer __glBindFramebufferEXT
 #define glFramebufferTexture2D __glFramebufferTexture2DEXT
+#define glDeleteFramebuffers __glDeleteFramebuffersEXT
 
 #define glUseProgramObject __glUseProgramObjectARB
 #define glDetachObject __glDetachObjectARB
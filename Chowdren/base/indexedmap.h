@@ -0,0 +1,302 @@
+#ifndef CHOWDREN_INDEXEDMAP_H
+#define CHOWDREN_INDEXEDMAP_H
+
+#include "types.h"
+#include <utility>
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+
+// Hashed map that keeps its entries in insertion order, so begin() + n
+// reaches the nth entry in O(1). The entries are allocated separately and
+// the order is a vector of pointers, so erasing or growing only moves
+// pointers, never the values (e.g. the option maps of an INI group map).
+// Erasing still updates the index of the following entries, which is O(n).
+
+template <class T, class Base>
+class IndexedMapIterator
+{
+public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef T * pointer;
+    typedef T & reference;
+
+    Base it;
+
+    IndexedMapIterator()
+    {
+    }
+
+    IndexedMapIterator(Base it)
+    : it(it)
+    {
+    }
+
+    // iterator -> const_iterator
+    template <class T2, class Base2>
+    IndexedMapIterator(const IndexedMapIterator<T2, Base2> & other)
+    : it(other.it)
+    {
+    }
+
+    T & operator*() const
+    {
+        return **it;
+    }
+
+    T * operator->() const
+    {
+        return *it;
+    }
+
+    T & operator[](difference_type n) const
+    {
+        return *it[n];
+    }
+
+    IndexedMapIterator & operator++()
+    {
+        ++it;
+        return *this;
+    }
+
+    IndexedMapIterator operator++(int)
+    {
+        IndexedMapIterator old = *this;
+        ++it;
+        return old;
+    }
+
+    IndexedMapIterator & operator--()
+    {
+        --it;
+        return *this;
+    }
+
+    IndexedMapIterator operator--(int)
+    {
+        IndexedMapIterator old = *this;
+        --it;
+        return old;
+    }
+
+    IndexedMapIterator & operator+=(difference_type n)
+    {
+        it += n;
+        return *this;
+    }
+
+    IndexedMapIterator & operator-=(difference_type n)
+    {
+        it -= n;
+        return *this;
+    }
+
+    IndexedMapIterator operator+(difference_type n) const
+    {
+        return IndexedMapIterator(it + n);
+    }
+
+    IndexedMapIterator operator-(difference_type n) const
+    {
+        return IndexedMapIterator(it - n);
+    }
+
+    template <class T2, class Base2>
+    difference_type operator-(const IndexedMapIterator<T2, Base2> & o) const
+    {
+        return it - o.it;
+    }
+
+    template <class T2, class Base2>
+    bool operator==(const IndexedMapIterator<T2, Base2> & o) const
+    {
+        return it == o.it;
+    }
+
+    template <class T2, class Base2>
+    bool operator!=(const IndexedMapIterator<T2, Base2> & o) const
+    {
+        return it != o.it;
+    }
+
+    template <class T2, class Base2>
+    bool operator<(const IndexedMapIterator<T2, Base2> & o) const
+    {
+        return it < o.it;
+    }
+};
+
+template <class K, class V>
+class IndexedMap
+{
+public:
+    typedef std::pair<K, V> value_type;
+    typedef vector<value_type*> ItemList;
+    typedef IndexedMapIterator<value_type,
+                               typename ItemList::iterator> iterator;
+    typedef IndexedMapIterator<const value_type,
+                               typename ItemList::const_iterator>
+        const_iterator;
+    typedef hash_map<K, unsigned int> IndexMap;
+
+    ItemList items;
+    IndexMap index;
+
+    IndexedMap()
+    {
+    }
+
+    IndexedMap(const IndexedMap & other)
+    {
+        copy_items(other);
+    }
+
+    ~IndexedMap()
+    {
+        clear();
+    }
+
+    IndexedMap & operator=(const IndexedMap & other)
+    {
+        if (this == &other)
+            return *this;
+        clear();
+        copy_items(other);
+        return *this;
+    }
+
+    void swap(IndexedMap & other)
+    {
+        items.swap(other.items);
+        index.swap(other.index);
+    }
+
+    iterator begin()
+    {
+        return iterator(items.begin());
+    }
+
+    iterator end()
+    {
+        return iterator(items.end());
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(items.begin());
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(items.end());
+    }
+
+    size_t size() const
+    {
+        return items.size();
+    }
+
+    bool empty() const
+    {
+        return items.empty();
+    }
+
+    void clear()
+    {
+        typename ItemList::const_iterator it;
+        for (it = items.begin(); it != items.end(); ++it)
+            delete *it;
+        items.clear();
+        index.clear();
+    }
+
+    iterator find(const K & key)
+    {
+        typename IndexMap::const_iterator it = index.find(key);
+        if (it == index.end())
+            return end();
+        return begin() + it->second;
+    }
+
+    const_iterator find(const K & key) const
+    {
+        typename IndexMap::const_iterator it = index.find(key);
+        if (it == index.end())
+            return end();
+        return begin() + it->second;
+    }
+
+    V & operator[](const K & key)
+    {
+        typename IndexMap::const_iterator it = index.find(key);
+        if (it != index.end())
+            return items[it->second]->second;
+        index[key] = items.size();
+        items.push_back(new value_type(key, V()));
+        return items.back()->second;
+    }
+
+    iterator erase(iterator it)
+    {
+        unsigned int pos = it - begin();
+        index.erase(it->first);
+        delete *it.it;
+        items.erase(it.it);
+        update_index(pos);
+        return begin() + pos;
+    }
+
+    size_t erase(const K & key)
+    {
+        iterator it = find(key);
+        if (it == end())
+            return 0;
+        erase(it);
+        return 1;
+    }
+
+    template <class Compare>
+    void sort(Compare comp)
+    {
+        std::stable_sort(items.begin(), items.end(),
+                         PointerCompare<Compare>(comp));
+        update_index(0);
+    }
+
+private:
+    template <class Compare>
+    struct PointerCompare
+    {
+        Compare comp;
+
+        PointerCompare(Compare comp)
+        : comp(comp)
+        {
+        }
+
+        bool operator()(const value_type * a, const value_type * b) const
+        {
+            return comp(*a, *b);
+        }
+    };
+
+    void copy_items(const IndexedMap & other)
+    {
+        items.reserve(other.items.size());
+        typename ItemList::const_iterator it;
+        for (it = other.items.begin(); it != other.items.end(); ++it)
+            items.push_back(new value_type(**it));
+        index = other.index;
+    }
+
+    void update_index(unsigned int start)
+    {
+        for (unsigned int i = start; i < items.size(); i++)
+            index[items[i]->first] = i;
+    }
+};
+
+#endif // CHOWDREN_INDEXEDMAP_H
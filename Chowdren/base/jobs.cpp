@@ -0,0 +1,194 @@
+#include "jobs.h"
+
+#ifdef CHOWDREN_JOB_THREADS
+
+#include <SDL_thread.h>
+#include <SDL_mutex.h>
+#include <SDL_atomic.h>
+#include <SDL_cpuinfo.h>
+#include <algorithm>
+#include <iostream>
+#include "trace.h"
+
+// batch range of one thread, index 0 is the calling thread
+struct JobQueue
+{
+    SDL_SpinLock lock;
+    int start, end;
+};
+
+static JobQueue queues[CHOWDREN_MAX_JOB_THREADS + 1];
+static int thread_count = 0;
+static bool initialized = false;
+
+static SDL_mutex * job_mutex;
+static SDL_cond * start_cond;
+static SDL_cond * done_cond;
+static unsigned int generation = 0;
+static int active_workers = 0;
+
+// the current loop, only changed while the workers are idle
+static JobFunction job_func;
+static void * job_data;
+static int job_count, job_batch_size;
+
+static bool pop_batch(int index, int & batch)
+{
+    JobQueue & queue = queues[index];
+    SDL_AtomicLock(&queue.lock);
+    bool ret = queue.start < queue.end;
+    if (ret)
+        batch = queue.start++;
+    SDL_AtomicUnlock(&queue.lock);
+    return ret;
+}
+
+static bool steal_batches(int index)
+{
+    int queue_count = thread_count + 1;
+    for (int i = 1; i < queue_count; i++) {
+        JobQueue & other = queues[(index + i) % queue_count];
+        SDL_AtomicLock(&other.lock);
+        int left = other.end - other.start;
+        if (left <= 0) {
+            SDL_AtomicUnlock(&other.lock);
+            continue;
+        }
+        int end = other.end;
+        int start = end - (left + 1) / 2;
+        other.end = start;
+        SDL_AtomicUnlock(&other.lock);
+
+        JobQueue & queue = queues[index];
+        SDL_AtomicLock(&queue.lock);
+        queue.start = start;
+        queue.end = end;
+        SDL_AtomicUnlock(&queue.lock);
+        return true;
+    }
+    return false;
+}
+
+static void run_batches(int index)
+{
+    int batch;
+    while (true) {
+        while (pop_batch(index, batch)) {
+            int start = batch * job_batch_size;
+            int end = std::min(start + job_batch_size, job_count);
+            job_func(job_data, start, end);
+        }
+        if (!steal_batches(index))
+            return;
+    }
+}
+
+static int job_worker(void * data)
+{
+    TRACE_THREAD("Job worker");
+    int index = int((size_t)data);
+    unsigned int seen = 0;
+    SDL_LockMutex(job_mutex);
+    while (true) {
+        while (generation == seen)
+            SDL_CondWait(start_cond, job_mutex);
+        seen = generation;
+        SDL_UnlockMutex(job_mutex);
+
+        run_batches(index);
+
+        SDL_LockMutex(job_mutex);
+        active_workers--;
+        if (active_workers == 0)
+            SDL_CondSignal(done_cond);
+    }
+    return 0;
+}
+
+void Jobs::init()
+{
+    if (initialized)
+        return;
+    initialized = true;
+    thread_count = std::min(SDL_GetCPUCount() - 1, CHOWDREN_MAX_JOB_THREADS);
+    if (thread_count <= 0) {
+        thread_count = 0;
+        return;
+    }
+    job_mutex = SDL_CreateMutex();
+    start_cond = SDL_CreateCond();
+    done_cond = SDL_CreateCond();
+    // parallel_for waits for thread_count workers, so only count the
+    // threads that were created. the indexes stay contiguous
+    int count = thread_count;
+    thread_count = 0;
+    for (int i = 1; i <= count; i++) {
+        queues[i].lock = 0;
+        SDL_Thread * thread = SDL_CreateThread(job_worker, "Job worker",
+                                               (void*)(size_t)i);
+        if (thread == NULL) {
+            std::cout << "Could not create job worker: " << SDL_GetError()
+                << std::endl;
+            break;
+        }
+        SDL_DetachThread(thread);
+        thread_count = i;
+    }
+}
+
+void Jobs::parallel_for(int count, int batch_size, JobFunction func,
+                        void * data)
+{
+    if (count <= 0)
+        return;
+    int batches = (count + batch_size - 1) / batch_size;
+    if (thread_count == 0 || batches == 1) {
+        func(data, 0, count);
+        return;
+    }
+
+    job_func = func;
+    job_data = data;
+    job_count = count;
+    job_batch_size = batch_size;
+
+    // deal out contiguous ranges, so neighbouring items stay on one thread
+    int queue_count = thread_count + 1;
+    for (int i = 0; i < queue_count; i++) {
+        JobQueue & queue = queues[i];
+        SDL_AtomicLock(&queue.lock);
+        queue.start = (batches * i) / queue_count;
+        queue.end = (batches * (i + 1)) / queue_count;
+        SDL_AtomicUnlock(&queue.lock);
+    }
+
+    SDL_LockMutex(job_mutex);
+    generation++;
+    active_workers = thread_count;
+    SDL_CondBroadcast(start_cond);
+    SDL_UnlockMutex(job_mutex);
+
+    run_batches(0);
+
+    // the workers may still be running their last batch
+    SDL_LockMutex(job_mutex);
+    while (active_workers > 0)
+        SDL_CondWait(done_cond, job_mutex);
+    SDL_UnlockMutex(job_mutex);
+}
+
+#else
+
+void Jobs::init()
+{
+}
+
+void Jobs::parallel_for(int count, int /* batch_size */, JobFunction func,
+                        void * data)
+{
+    if (count <= 0)
+        return;
+    func(data, 0, count);
+}
+
+#endif
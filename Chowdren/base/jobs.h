@@ -0,0 +1,41 @@
+#ifndef CHOWDREN_JOBS_H
+#define CHOWDREN_JOBS_H
+
+#include "chowconfig.h"
+
+// Small job system for data-parallel loops, used for the integrate pass of
+// the object update (use_parallel_update config option). A loop is split
+// into batches that are dealt out to one queue per thread. Each thread
+// takes batches from the front of its own queue, and steals the back half
+// of another queue when its own runs dry. The calling thread works along,
+// and parallel_for returns once every batch is done.
+// Jobs may only write state that belongs to their own items, so the result
+// does not depend on which thread ran what. Without worker threads, the
+// loop runs on the calling thread.
+
+#if defined(CHOWDREN_PARALLEL_UPDATE) && defined(CHOWDREN_IS_DESKTOP) && \
+    !defined(CHOWDREN_IS_EMSCRIPTEN)
+#define CHOWDREN_JOB_THREADS
+#endif
+
+// maximum number of worker threads, besides the calling thread
+#ifndef CHOWDREN_MAX_JOB_THREADS
+#define CHOWDREN_MAX_JOB_THREADS 7
+#endif
+
+// instances per batch in the integrate pass
+#ifndef CHOWDREN_UPDATE_BATCH
+#define CHOWDREN_UPDATE_BATCH 64
+#endif
+
+typedef void (*JobFunction)(void * data, int start, int end);
+
+namespace Jobs
+{
+    void init();
+    // runs func over [0, count) in batches of batch_size items
+    void parallel_for(int count, int batch_size, JobFunction func,
+                      void * data);
+}
+
+#endif // CHOWDREN_JOBS_H
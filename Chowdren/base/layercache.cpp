@@ -0,0 +1,272 @@
+#include "layercache.h"
+
+#ifdef CHOWDREN_LAYER_CACHE
+
+#include "common.h"
+#include "include_gl.h"
+#include <algorithm>
+
+#define CHUNK_SIZE CHOWDREN_LAYER_CHUNK_SIZE
+#define MAX_CHUNKS (CHOWDREN_LAYER_CACHE_SIZE / (CHUNK_SIZE * CHUNK_SIZE * 4))
+
+// chunks of all layers, for the VRAM budget
+static vector<LayerChunk*> all_chunks;
+static unsigned int frame_count = 0;
+// chunks in use by the layers drawn so far this frame
+static int frame_chunks = 0;
+
+inline int get_chunk_coord(int value)
+{
+    // floor division, so negative coordinates get their own chunks
+    if (value >= 0)
+        return value / CHUNK_SIZE;
+    return (value + 1) / CHUNK_SIZE - 1;
+}
+
+inline void remove_from_list(vector<LayerChunk*> & list, LayerChunk * chunk)
+{
+    vector<LayerChunk*>::iterator it;
+    it = std::find(list.begin(), list.end(), chunk);
+    if (it == list.end())
+        return;
+    *it = list.back();
+    list.pop_back();
+}
+
+LayerCache::LayerCache()
+{
+}
+
+void LayerCache::begin_frame()
+{
+    frame_count++;
+    frame_chunks = 0;
+}
+
+LayerCache::~LayerCache()
+{
+    clear();
+}
+
+void LayerCache::clear()
+{
+    vector<LayerChunk*>::iterator it;
+    for (it = chunks.begin(); it != chunks.end(); ++it) {
+        LayerChunk * chunk = *it;
+        chunk->fbo.destroy();
+        remove_from_list(all_chunks, chunk);
+        delete chunk;
+    }
+    chunks.clear();
+}
+
+void LayerCache::invalidate()
+{
+    vector<LayerChunk*>::iterator it;
+    for (it = chunks.begin(); it != chunks.end(); ++it)
+        (*it)->dirty = true;
+}
+
+void LayerCache::invalidate(int v[4])
+{
+    int x1 = get_chunk_coord(v[0]);
+    int y1 = get_chunk_coord(v[1]);
+    int x2 = get_chunk_coord(v[2]);
+    int y2 = get_chunk_coord(v[3]);
+    vector<LayerChunk*>::iterator it;
+    for (it = chunks.begin(); it != chunks.end(); ++it) {
+        LayerChunk * chunk = *it;
+        if (chunk->x < x1 || chunk->x > x2 || chunk->y < y1 || chunk->y > y2)
+            continue;
+        chunk->dirty = true;
+    }
+}
+
+LayerChunk * LayerCache::get_chunk(int x, int y)
+{
+    vector<LayerChunk*>::iterator it;
+    for (it = chunks.begin(); it != chunks.end(); ++it) {
+        LayerChunk * chunk = *it;
+        if (chunk->x == x && chunk->y == y)
+            return chunk;
+    }
+
+    LayerChunk * chunk = NULL;
+    if (int(all_chunks.size()) < MAX_CHUNKS) {
+        chunk = new LayerChunk;
+        chunk->fbo.init(CHUNK_SIZE, CHUNK_SIZE);
+        all_chunks.push_back(chunk);
+    } else {
+        // reuse the least recently used chunk of any layer, as long as it
+        // is not used by this frame
+        for (it = all_chunks.begin(); it != all_chunks.end(); ++it) {
+            LayerChunk * other = *it;
+            if (other->last_used == frame_count)
+                continue;
+            if (chunk == NULL || other->last_used < chunk->last_used)
+                chunk = other;
+        }
+        if (chunk == NULL)
+            return NULL;
+        remove_from_list(chunk->cache->chunks, chunk);
+    }
+
+    chunk->cache = this;
+    chunk->x = x;
+    chunk->y = y;
+    chunk->dirty = true;
+    chunk->empty = true;
+    chunk->last_used = 0;
+    chunks.push_back(chunk);
+    return chunk;
+}
+
+struct StaticCallback
+{
+    FlatObjectList & list;
+    int * aabb;
+
+    StaticCallback(FlatObjectList & list, int v[4])
+    : list(list), aabb(v)
+    {
+    }
+
+    bool on_callback(void * data)
+    {
+        FrameObject * obj = (FrameObject*)data;
+        if (!(obj->flags & BACKGROUND) || !(obj->flags & VISIBLE) ||
+            obj->flags & DESTROYING || obj->effect != Render::NONE ||
+            !obj->can_bake())
+            return true;
+        if (!collide_box(obj, aabb))
+            return true;
+        list.push_back(obj);
+        return true;
+    }
+};
+
+inline bool sort_static_comp(FrameObject * obj1, FrameObject * obj2)
+{
+    return obj1->depth < obj2->depth;
+}
+
+static FlatObjectList static_objects;
+
+void LayerCache::bake(Layer * layer, LayerChunk * chunk)
+{
+    chunk->dirty = false;
+
+    int x1 = chunk->x * CHUNK_SIZE;
+    int y1 = chunk->y * CHUNK_SIZE;
+    int v[4] = {x1, y1, x1 + CHUNK_SIZE, y1 + CHUNK_SIZE};
+
+    static_objects.clear();
+    StaticCallback callback(static_objects, v);
+    layer->broadphase.query(v, callback);
+
+    Background * back = layer->back;
+    chunk->empty = static_objects.empty() &&
+                   (back == NULL || back->items.empty());
+    if (chunk->empty)
+        return;
+
+    std::sort(static_objects.begin(), static_objects.end(),
+              sort_static_comp);
+
+    chunk->fbo.bind();
+    int old_offset[2] = {Render::offset[0], Render::offset[1]};
+    int old_view[4];
+    memcpy(old_view, render_data.viewport, sizeof(old_view));
+    Render::set_view(0, 0, CHUNK_SIZE, CHUNK_SIZE);
+    Render::set_offset(-x1, -y1);
+    // Render::clear() keeps the target opaque, chunks start transparent
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // store premultiplied alpha, so drawing the chunk blends the same as
+    // drawing the content directly
+    Render::set_effect(Render::PREMULTIPLY);
+
+    FlatObjectList::const_iterator it;
+    for (it = static_objects.begin(); it != static_objects.end(); ++it)
+        (*it)->draw();
+    if (back != NULL)
+        back->draw(v);
+
+    Render::disable_effect();
+    Render::set_view(old_view[0], old_view[1], old_view[2], old_view[3]);
+    Render::set_offset(old_offset[0], old_offset[1]);
+    chunk->fbo.unbind();
+}
+
+static vector<LayerChunk*> visible_chunks;
+
+bool LayerCache::draw(Layer * layer, int v[4])
+{
+    bool has_static = layer->back != NULL && !layer->back->items.empty();
+    FlatObjectList::const_iterator it;
+    for (it = layer->draw_list.begin(); it != layer->draw_list.end(); ++it) {
+        FrameObject * obj = *it;
+        if (!(obj->flags & BACKGROUND))
+            break;
+        if (obj->effect != Render::NONE || !obj->can_bake())
+            return false;
+        has_static = true;
+    }
+    if (!has_static)
+        return false;
+
+    int x1 = get_chunk_coord(v[0]);
+    int y1 = get_chunk_coord(v[1]);
+    int x2 = get_chunk_coord(v[2] - 1);
+    int y2 = get_chunk_coord(v[3] - 1);
+
+    // the budget is shared by all layers drawn this frame. once it runs
+    // out, the remaining layers are drawn directly instead of evicting
+    // each other's chunks every frame
+    int count = (x2 - x1 + 1) * (y2 - y1 + 1);
+    if (frame_chunks + count > MAX_CHUNKS)
+        return false;
+
+    visible_chunks.clear();
+    vector<LayerChunk*>::const_iterator chunk_it;
+    for (int y = y1; y <= y2; y++)
+    for (int x = x1; x <= x2; x++) {
+        LayerChunk * chunk = get_chunk(x, y);
+        if (chunk == NULL) {
+            // give the chunks back, so other layers can still use them
+            for (chunk_it = visible_chunks.begin();
+                 chunk_it != visible_chunks.end(); ++chunk_it)
+                (*chunk_it)->last_used = frame_count - 1;
+            return false;
+        }
+        chunk->last_used = frame_count;
+        visible_chunks.push_back(chunk);
+    }
+    frame_chunks += count;
+
+    for (chunk_it = visible_chunks.begin(); chunk_it != visible_chunks.end();
+         ++chunk_it) {
+        LayerChunk * chunk = *chunk_it;
+        if (chunk->dirty)
+            bake(layer, chunk);
+    }
+
+    Render::set_effect(Render::PREMULTIPLIED);
+    for (chunk_it = visible_chunks.begin(); chunk_it != visible_chunks.end();
+         ++chunk_it) {
+        LayerChunk * chunk = *chunk_it;
+        if (chunk->empty)
+            continue;
+        int cx = chunk->x * CHUNK_SIZE;
+        int cy = chunk->y * CHUNK_SIZE;
+        // the FBO content is upside down
+        Render::draw_tex(cx, cy, cx + CHUNK_SIZE, cy + CHUNK_SIZE,
+                         Color(255, 255, 255, 255), chunk->fbo.get_tex(),
+                         0.0f, 1.0f, 1.0f, 0.0f);
+    }
+    Render::disable_effect();
+    return true;
+}
+
+#endif // CHOWDREN_LAYER_CACHE
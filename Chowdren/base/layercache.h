@@ -0,0 +1,69 @@
+#ifndef CHOWDREN_LAYERCACHE_H
+#define CHOWDREN_LAYERCACHE_H
+
+#include "chowconfig.h"
+
+// Chunk cache for the static content of a layer, i.e. background instances
+// and pasted items. The content is baked into square FBO tiles once, and
+// only the chunks touched by a paste, destroy or backdrop change are baked
+// again. Enabled with the use_layer_cache config option (desktop only).
+// Frames where a visible background instance uses an effect are drawn
+// without the cache, since effects cannot be baked.
+
+#if defined(CHOWDREN_LAYER_CACHE) && (!defined(CHOWDREN_IS_DESKTOP) || \
+                                      defined(CHOWDREN_LAYER_WRAP) || \
+                                      defined(CHOWDREN_EMULATE_WIIU))
+#undef CHOWDREN_LAYER_CACHE
+#endif
+
+#ifdef CHOWDREN_LAYER_CACHE
+
+#include "types.h"
+#include "fbo.h"
+
+#ifndef CHOWDREN_LAYER_CHUNK_SIZE
+#define CHOWDREN_LAYER_CHUNK_SIZE 512
+#endif
+
+// VRAM budget for all layers, in bytes
+#ifndef CHOWDREN_LAYER_CACHE_SIZE
+#define CHOWDREN_LAYER_CACHE_SIZE (64 * 1024 * 1024)
+#endif
+
+class Layer;
+class LayerCache;
+
+struct LayerChunk
+{
+    LayerCache * cache;
+    // chunk coordinates
+    int x, y;
+    Framebuffer fbo;
+    bool dirty;
+    bool empty;
+    unsigned int last_used;
+};
+
+class LayerCache
+{
+public:
+    vector<LayerChunk*> chunks;
+
+    LayerCache();
+    ~LayerCache();
+    // call before the layers are drawn
+    static void begin_frame();
+    void clear();
+    void invalidate();
+    void invalidate(int v[4]);
+    // returns false if the static content has to be drawn directly
+    bool draw(Layer * layer, int v[4]);
+
+private:
+    LayerChunk * get_chunk(int x, int y);
+    void bake(Layer * layer, LayerChunk * chunk);
+};
+
+#endif // CHOWDREN_LAYER_CACHE
+
+#endif // CHOWDREN_LAYERCACHE_H
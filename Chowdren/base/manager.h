@@ -26,6 +26,8 @@ public:
     Color fade_color;
     float fade_dir;
     float fade_value;
+    // frame whose images were last passed to Frame::prefetch_images
+    int prefetch_frame;
     int score;
     int lives;
     bool player_died;
@@ -10,6 +10,9 @@
 #include "path.h"
 #include "media.h"
 #include "datastream.h"
+#include "trace.h"
+#include "types.h"
+#include "platform.h"
 
 inline double clamp_sound(double val)
 {
@@ -30,10 +33,34 @@ class SoundData
 {
 public:
     unsigned int id;
+    // known after the first load, used by virtual voices
+    double duration;
+    int sample_rate;
+    // decoded while playing, i.e. music and other long sounds
+    bool streamed;
+
+    SoundData(unsigned int id, bool streamed)
+    : id(id), duration(-1.0), sample_rate(0), streamed(streamed)
+    {
+    }
+
+    void set_info(ChowdrenAudio::SoundBase * sound)
+    {
+        duration = sound->get_duration();
+        sample_rate = sound->get_sample_rate();
+    }
 
-    SoundData(unsigned int id)
-    : id(id)
+    void load_info()
     {
+        if (duration >= 0.0)
+            return;
+        duration = 0.0;
+        ChowdrenAudio::SoundBase * sound = NULL;
+        load(&sound);
+        if (sound == NULL)
+            return;
+        set_info(sound);
+        sound->destroy();
     }
 
     virtual void load(ChowdrenAudio::SoundBase ** source) {}
@@ -43,38 +70,37 @@ public:
 class SoundFile : public SoundData
 {
 public:
-    Media::AudioType type;
-    std::string filename;
-    size_t size;
+    ChowdrenAudio::StreamSource * stream;
 
     SoundFile(unsigned int id, const std::string & filename,
               Media::AudioType type, size_t size)
-    : SoundData(id), type(type), filename(filename), size(size)
+    : SoundData(id, true)
     {
+        stream = ChowdrenAudio::add_stream_source(0, filename, type, size);
     }
 
     void load(ChowdrenAudio::SoundBase ** source)
     {
-        *source = new ChowdrenAudio::SoundStream(filename, type, size);
+        *source = new ChowdrenAudio::SoundStream(stream);
     }
 };
 
 class SoundCache : public SoundData
 {
 public:
-    Media::AudioType type;
-    size_t offset;
-    size_t size;
+    ChowdrenAudio::StreamSource * stream;
 
     SoundCache(unsigned int id, size_t offset, Media::AudioType type,
                size_t size)
-    : SoundData(id), type(type), offset(offset), size(size)
+    : SoundData(id, true)
     {
+        stream = ChowdrenAudio::add_stream_source(offset, std::string(), type,
+                                                  size);
     }
 
     void load(ChowdrenAudio::SoundBase ** source)
     {
-        *source = new ChowdrenAudio::SoundStream(offset, type, size);
+        *source = new ChowdrenAudio::SoundStream(stream);
     }
 };
 
@@ -85,12 +111,21 @@ public:
 
     SoundMemory(unsigned int id, FSFile & fp, Media::AudioType type,
                 size_t size)
-    : SoundData(id), buffer(NULL)
+    : SoundData(id, false), buffer(NULL)
     {
         // load immediately
         buffer = new ChowdrenAudio::Sample(fp, type, size);
     }
 
+#ifdef CHOWDREN_ASSET_MMAP
+    SoundMemory(unsigned int id, const unsigned char * data,
+                Media::AudioType type, size_t size)
+    : SoundData(id, false), buffer(NULL)
+    {
+        buffer = new ChowdrenAudio::Sample(data, type, size);
+    }
+#endif
+
     void load(ChowdrenAudio::SoundBase ** source)
     {
         *source = new ChowdrenAudio::Sound(*buffer);
@@ -102,35 +137,145 @@ public:
     }
 };
 
+// sounds played by filename, so they are only decoded once
+typedef hash_map<std::string, SoundData*> SoundFileCache;
+static SoundFileCache file_cache;
+
+static SoundData * create_file_data(unsigned int id,
+                                    const std::string & filename,
+                                    size_t size);
+
 // Channel
 
-Channel::Channel()
-: locked(false), volume(100), frequency(0), pan(0), sound(NULL)
+Channel::Channel(unsigned int index)
+: id(INVALID_ASSET_ID), index(index), locked(false), sound(NULL),
+  volume(100), frequency(0), pan(0), priority(0), fixed_priority(0),
+  has_fixed_priority(false),
+  data(NULL), looping(false), is_virtual(false),
+  virtual_paused(false), virtual_position(0.0), virtual_time(0.0),
+  prev_sample(NULL), next_sample(NULL)
 {
 
 }
 
+void Channel::set_id(unsigned int new_id)
+{
+    if (new_id == id)
+        return;
+
+    // unlink from the old sample
+    if (id != INVALID_ASSET_ID) {
+        if (prev_sample != NULL)
+            prev_sample->next_sample = next_sample;
+        else if (media.sample_channels[id] == this)
+            media.sample_channels[id] = next_sample;
+        if (next_sample != NULL)
+            next_sample->prev_sample = prev_sample;
+    }
+    prev_sample = next_sample = NULL;
+
+    id = new_id;
+    if (id == INVALID_ASSET_ID)
+        return;
+    // keep the list ordered by index, so get_sample returns the lowest
+    // channel like before
+    Channel * next = media.sample_channels[id];
+    while (next != NULL && next->index < index) {
+        prev_sample = next;
+        next = next->next_sample;
+    }
+    next_sample = next;
+    if (next != NULL)
+        next->prev_sample = this;
+    if (prev_sample != NULL)
+        prev_sample->next_sample = this;
+    else
+        media.sample_channels[id] = this;
+}
+
 void Channel::play(SoundData * data, int loop)
 {
     stop();
-    id = data->id;
+    set_id(data->id);
+    this->data = data;
+    looping = loop == 0;
+    if (loop > 1)
+        std::cout << "Invalid number of loops (" << loop << ")" << std::endl;
+
+    if (media.real_voices < CHOWDREN_REAL_VOICES) {
+        start_sound(0.0, false);
+        return;
+    }
+
+    // out of real voices, start silently and let update_voices decide
+    data->load_info();
+    is_virtual = true;
+    virtual_paused = false;
+    virtual_position = 0.0;
+    virtual_time = platform_get_time();
+}
+
+void Channel::start_sound(double offset, bool paused)
+{
     data->load(&sound);
     if (sound == NULL) {
         std::cout << "Ignored play" << std::endl;
         return;
     }
+    media.real_voices++;
+    data->set_info(sound);
     set_volume(volume);
     set_pan(pan);
     if (frequency != 0)
         set_frequency(frequency);
-    sound->set_loop(loop == 0);
-    if (loop > 1)
-        std::cout << "Invalid number of loops (" << loop << ")" << std::endl;
+    sound->set_loop(looping);
     sound->play();
+    if (offset > 0.0)
+        sound->set_playing_offset(offset);
+    if (paused)
+        sound->pause();
+}
+
+double Channel::get_virtual_position()
+{
+    if (virtual_paused)
+        return virtual_position;
+    double rate = 1.0;
+    if (frequency != 0 && data->sample_rate > 0)
+        rate = frequency / data->sample_rate;
+    return virtual_position + (platform_get_time() - virtual_time) * rate;
+}
+
+void Channel::make_virtual()
+{
+    virtual_position = sound->get_playing_offset();
+    virtual_paused = sound->get_status() ==
+                     ChowdrenAudio::SoundBase::Paused;
+    virtual_time = platform_get_time();
+    sound->destroy();
+    sound = NULL;
+    is_virtual = true;
+    media.real_voices--;
+}
+
+void Channel::make_real()
+{
+    double offset = get_virtual_position();
+    if (looping && data->duration > 0.0)
+        offset = fmod(offset, data->duration);
+    is_virtual = false;
+    start_sound(offset, virtual_paused);
 }
 
 void Channel::resume()
 {
+    if (is_virtual) {
+        if (!virtual_paused)
+            return;
+        virtual_paused = false;
+        virtual_time = platform_get_time();
+        return;
+    }
     if (is_invalid())
         return;
     if (sound->get_status() != ChowdrenAudio::SoundBase::Paused)
@@ -140,6 +285,13 @@ void Channel::resume()
 
 void Channel::pause()
 {
+    if (is_virtual) {
+        if (virtual_paused || is_stopped())
+            return;
+        virtual_position = get_virtual_position();
+        virtual_paused = true;
+        return;
+    }
     if (is_invalid())
         return;
     if (sound->get_status() != ChowdrenAudio::SoundBase::Playing)
@@ -149,24 +301,32 @@ void Channel::pause()
 
 void Channel::stop()
 {
+    is_virtual = false;
     if (sound == NULL)
         return;
     sound->destroy();
     sound = NULL;
+    // recounted by update_voices
+    media.real_voices = std::max(0, media.real_voices - 1);
 }
 
 void Channel::set_volume(double value)
 {
     volume = clamp_sound(value);
-    if (is_invalid())
+    if (is_invalid() || is_virtual)
         return;
     sound->set_volume(volume / 100.0);
 }
 
 void Channel::set_frequency(double value)
 {
+    if (is_virtual) {
+        // keep the position continuous across the rate change
+        virtual_position = get_virtual_position();
+        virtual_time = platform_get_time();
+    }
     frequency = value;
-    if (is_invalid())
+    if (is_invalid() || is_virtual)
         return;
     sound->set_frequency(value);
 }
@@ -175,6 +335,8 @@ double Channel::get_frequency()
 {
     if (frequency != 0)
         return frequency;
+    if (is_virtual)
+        return data->sample_rate;
     if (is_invalid())
         return 0.0;
     return sound->get_sample_rate();
@@ -182,6 +344,11 @@ double Channel::get_frequency()
 
 void Channel::set_position(double value)
 {
+    if (is_virtual) {
+        virtual_position = value / 1000.0;
+        virtual_time = platform_get_time();
+        return;
+    }
     if (is_invalid())
         return;
     sound->set_playing_offset(value / 1000.0);
@@ -189,6 +356,12 @@ void Channel::set_position(double value)
 
 double Channel::get_position()
 {
+    if (is_virtual) {
+        double pos = get_virtual_position();
+        if (looping && data->duration > 0.0)
+            pos = fmod(pos, data->duration);
+        return std::min(pos, data->duration) * 1000.0;
+    }
     if (is_invalid())
         return 0.0;
     return sound->get_playing_offset() * 1000.0;
@@ -196,6 +369,8 @@ double Channel::get_position()
 
 double Channel::get_duration()
 {
+    if (is_virtual)
+        return data->duration * 1000.0;
     if (is_invalid())
         return 0.0;
     return sound->get_duration() * 1000.0;
@@ -204,7 +379,7 @@ double Channel::get_duration()
 void Channel::set_pan(double value)
 {
     pan = value;
-    if (is_invalid())
+    if (is_invalid() || is_virtual)
         return;
     value /= 100;
     if (value > 1.0)
@@ -216,11 +391,15 @@ void Channel::set_pan(double value)
 
 bool Channel::is_invalid()
 {
+    if (is_virtual)
+        return false;
     return sound == NULL || sound->closed;
 }
 
 bool Channel::is_stopped()
 {
+    if (is_virtual)
+        return !looping && get_virtual_position() >= data->duration;
     if (is_invalid())
         return true;
     return sound->get_status() == ChowdrenAudio::SoundBase::Stopped;
@@ -232,6 +411,17 @@ void Media::init()
 {
     ChowdrenAudio::open_audio();
 
+    real_voices = 0;
+    for (int i = 0; i < CHANNEL_COUNT; i++)
+        channels.push_back(new Channel(i));
+
+#ifdef CHOWDREN_CHANNEL_PRIORITIES
+    static const int priorities[][2] = {CHOWDREN_CHANNEL_PRIORITIES};
+    for (unsigned int i = 0; i < sizeof(priorities) / sizeof(priorities[0]);
+         i++)
+        set_channel_priority(priorities[i][0], priorities[i][1]);
+#endif
+
     AssetFile fp;
     fp.open();
     for (int i = 0; i < SOUND_COUNT; i++) {
@@ -244,43 +434,155 @@ void Media::stop()
 {
     stop_samples();
 
+    for (unsigned int i = 0; i < channels.size(); i++)
+        delete channels[i];
+    channels.clear();
+    for (int i = 0; i < SOUND_ARRAY_SIZE; i++)
+        sample_channels[i] = NULL;
+
     for (int i = 0; i < SOUND_COUNT; i++) {
         delete sounds[i];
     }
 
+    SoundFileCache::const_iterator it;
+    for (it = file_cache.begin(); it != file_cache.end(); ++it)
+        delete it->second;
+    file_cache.clear();
+
     ChowdrenAudio::close_audio();
 }
 
+// default voice priorities, combined. a priority set for the channel
+// replaces them when the channel is played explicitly
+#define PRIORITY_EXPLICIT 1
+#define PRIORITY_LOOPING 2
+#define PRIORITY_STREAMED 4
+
 void Media::play(SoundData * data, int channel, int loop)
 {
-    if (channel == -1) {
-        for (channel = 0; channel < 32; channel++) {
-            Channel & channelp = channels[channel];
+    bool is_explicit = channel != -1;
+    if (!is_explicit) {
+        int count = channels.size();
+        for (channel = 0; channel < count; channel++) {
+            Channel & channelp = *channels[channel];
             if (!channelp.is_stopped() || channelp.locked)
                 continue;
-            // unspecified channel does not inherit settings
-            channelp.volume = 100;
-            channelp.frequency = 0;
-            channelp.pan = 0;
             break;
         }
-        if (channel == 32)
-            return;
+        // all channels are busy, add a virtual one
+        Channel & channelp = *get_channel(channel);
+        // unspecified channel does not inherit settings
+        channelp.volume = 100;
+        channelp.frequency = 0;
+        channelp.pan = 0;
+    }
+    Channel * channelp = get_channel(channel);
+    int priority = 0;
+    if (is_explicit)
+        priority |= PRIORITY_EXPLICIT;
+    if (loop == 0)
+        priority |= PRIORITY_LOOPING;
+    if (data->streamed)
+        priority |= PRIORITY_STREAMED;
+    if (is_explicit && channelp->has_fixed_priority)
+        priority = channelp->fixed_priority;
+    channelp->priority = priority;
+    channelp->play(data, loop);
+}
+
+Channel * Media::get_channel(unsigned int channel)
+{
+    while (channel >= channels.size())
+        channels.push_back(new Channel(channels.size()));
+    return channels[channel];
+}
+
+void Media::set_channel_priority(unsigned int channel, int priority)
+{
+    Channel * channelp = get_channel(channel);
+    channelp->priority = priority;
+    channelp->fixed_priority = priority;
+    channelp->has_fixed_priority = true;
+}
+
+inline double get_audibility(Channel * channel)
+{
+    return channel->volume * (1.0 - fabs(channel->pan) / 200.0);
+}
+
+// sorts the voices that should get a real source first
+struct VoiceComp
+{
+    bool operator()(Channel * a, Channel * b) const
+    {
+        if (a->priority != b->priority)
+            return a->priority > b->priority;
+        double audibility_a = get_audibility(a);
+        double audibility_b = get_audibility(b);
+        if (audibility_a != audibility_b)
+            return audibility_a > audibility_b;
+        // keep real voices real, so equal voices do not swap every frame
+        return !a->is_virtual && b->is_virtual;
+    }
+};
+
+static vector<Channel*> active_voices;
+
+void Media::update_voices()
+{
+    active_voices.clear();
+    int real = 0;
+    vector<Channel*>::const_iterator it;
+    for (it = channels.begin(); it != channels.end(); ++it) {
+        Channel * channel = *it;
+        if (channel->is_stopped()) {
+            channel->is_virtual = false;
+            continue;
+        }
+        if (!channel->is_virtual)
+            real++;
+        active_voices.push_back(channel);
+    }
+    real_voices = real;
+    if (real == int(active_voices.size()))
+        return;
+
+    int count = active_voices.size();
+    if (count > CHOWDREN_REAL_VOICES) {
+        count = CHOWDREN_REAL_VOICES;
+        std::nth_element(active_voices.begin(), active_voices.begin() + count,
+                         active_voices.end(), VoiceComp());
+    }
+
+    // free the sources first, then hand them to the louder voices
+    for (int i = count; i < int(active_voices.size()); i++) {
+        Channel * channel = active_voices[i];
+        if (!channel->is_virtual)
+            channel->make_virtual();
+    }
+    for (int i = 0; i < count; i++) {
+        Channel * channel = active_voices[i];
+        if (channel->is_virtual)
+            channel->make_real();
     }
-    channels[channel].play(data, loop);
 }
 
 void Media::play(const std::string & in, int channel, int loop)
 {
     std::string filename = convert_path(in);
+    SoundFileCache::const_iterator it = file_cache.find(filename);
+    if (it != file_cache.end()) {
+        play(it->second, channel, loop);
+        return;
+    }
     size_t size = platform_get_file_size(filename.c_str());
     if (size <= 0) {
         std::cout << "Audio file does not exist: " << filename << std::endl;
         return;
     }
-    AudioType type = get_audio_type(filename);
-    SoundFile data(INVALID_ASSET_ID, filename, type, size);
-    play(&data, channel, loop);
+    SoundData * data = create_file_data(INVALID_ASSET_ID, filename, size);
+    file_cache[filename] = data;
+    play(data, channel, loop);
 }
 
 void Media::play_id(unsigned int id, int channel, int loop)
@@ -292,68 +594,63 @@ void Media::lock(unsigned int channel)
 {
     if (!is_channel_valid(channel))
         return;
-    channels[channel].locked = true;
+    channels[channel]->locked = true;
 }
 
 void Media::unlock(unsigned int channel)
 {
     if (!is_channel_valid(channel))
         return;
-    channels[channel].locked = false;
+    channels[channel]->locked = false;
 }
 
 void Media::set_channel_volume(unsigned int channel, double volume)
 {
     if (!is_channel_valid(channel))
         return;
-    channels[channel].set_volume(volume);
+    channels[channel]->set_volume(volume);
 }
 
 void Media::set_channel_frequency(unsigned int channel, double freq)
 {
     if (!is_channel_valid(channel))
         return;
-    channels[channel].set_frequency(freq);
+    channels[channel]->set_frequency(freq);
 }
 
 void Media::set_channel_pan(unsigned int channel, double pan)
 {
     if (!is_channel_valid(channel))
         return;
-    channels[channel].set_pan(pan);
+    channels[channel]->set_pan(pan);
 }
 
 void Media::stop_channel(unsigned int channel)
 {
     if (!is_channel_valid(channel))
         return;
-    channels[channel].stop();
+    channels[channel]->stop();
 }
 
 void Media::resume_channel(unsigned int channel)
 {
     if (!is_channel_valid(channel))
         return;
-    channels[channel].resume();
+    channels[channel]->resume();
 }
 
 void Media::pause_channel(unsigned int channel)
 {
     if (!is_channel_valid(channel))
         return;
-    channels[channel].pause();
+    channels[channel]->pause();
 }
 
 Channel * Media::get_sample(unsigned int id)
 {
     if (id == INVALID_ASSET_ID)
         return NULL;
-    for (int i = 0; i < 32; i++) {
-        if (channels[i].id != id)
-            continue;
-        return &channels[i];
-    }
-    return NULL;
+    return sample_channels[id];
 }
 
 void Media::set_sample_volume(unsigned int id, double volume)
@@ -414,21 +711,21 @@ void Media::stop_sample(unsigned int id)
 
 void Media::stop_samples()
 {
-    for (int i = 0; i < 32; i++) {
+    for (unsigned int i = 0; i < channels.size(); i++) {
         stop_channel(i);
     }
 }
 
 void Media::pause_samples()
 {
-    for (int i = 0; i < 32; i++) {
+    for (unsigned int i = 0; i < channels.size(); i++) {
         pause_channel(i);
     }
 }
 
 void Media::resume_samples()
 {
-    for (int i = 0; i < 32; i++) {
+    for (unsigned int i = 0; i < channels.size(); i++) {
         resume_channel(i);
     }
 }
@@ -437,65 +734,67 @@ double Media::get_channel_position(unsigned int channel)
 {
     if (!is_channel_valid(channel))
         return 0.0;
-    return channels[channel].get_position();
+    return channels[channel]->get_position();
 }
 
 double Media::get_channel_frequency(unsigned int channel)
 {
     if (!is_channel_valid(channel))
         return 0.0;
-    return channels[channel].get_frequency();
+    return channels[channel]->get_frequency();
 }
 
 void Media::set_channel_position(unsigned int channel, double pos)
 {
     if (!is_channel_valid(channel))
         return;
-    return channels[channel].set_position(pos);
+    return channels[channel]->set_position(pos);
 }
 
 double Media::get_channel_duration(unsigned int channel)
 {
     if (!is_channel_valid(channel))
         return 0.0;
-    return channels[channel].get_duration();
+    return channels[channel]->get_duration();
 }
 
 double Media::get_channel_volume(unsigned int channel)
 {
     if (!is_channel_valid(channel))
         return 0.0;
-    return channels[channel].volume;
+    return channels[channel]->volume;
 }
 
 double Media::get_channel_pan(unsigned int channel)
 {
     if (!is_channel_valid(channel))
         return 0.0;
-    return channels[channel].pan;
+    return channels[channel]->pan;
 }
 
 bool Media::is_channel_playing(unsigned int channel)
 {
     if (!is_channel_valid(channel))
         return false;
-    return !channels[channel].is_stopped();
+    return !channels[channel]->is_stopped();
 }
 
 bool Media::is_sample_playing(unsigned int id)
 {
-    for (int i = 0; i < 32; i++) {
-        if (channels[i].is_stopped())
-            continue;
-        if (channels[i].id == id)
+    if (id == INVALID_ASSET_ID)
+        return false;
+    Channel * channel = sample_channels[id];
+    while (channel != NULL) {
+        if (!channel->is_stopped())
             return true;
+        channel = channel->next_sample;
     }
     return false;
 }
 
 bool Media::is_channel_valid(unsigned int channel)
 {
-    return channel < 32;
+    return channel < channels.size();
 }
 
 #ifdef CHOWDREN_IS_DESKTOP
@@ -511,27 +810,30 @@ bool Media::is_channel_valid(unsigned int channel)
 #define OGG_STREAM_THRESHOLD (OGG_STREAM_THRESHOLD_MB * 1024 * 1024)
 #define WAV_STREAM_THRESHOLD (WAV_STREAM_THRESHOLD_MB * 1024 * 1024)
 
-void Media::add_file(unsigned int id, const std::string & fn)
+static SoundData * create_file_data(unsigned int id,
+                                    const std::string & filename, size_t size)
 {
-    std::string filename = convert_path(fn);
-    AudioType type = get_audio_type(filename);
-    size_t size = platform_get_file_size(filename.c_str());
-
-    bool is_wav = type == WAV;
-    SoundData * data;
+    Media::AudioType type = get_audio_type(filename);
+    bool is_wav = type == Media::WAV;
     if ((is_wav && size <= WAV_STREAM_THRESHOLD) ||
         (!is_wav && size <= OGG_STREAM_THRESHOLD))
     {
         FSFile fp(filename.c_str(), "r");
-        data = new SoundMemory(id, fp, type, size);
-    } else {
-        data = new SoundFile(id, filename, type, size);
+        return new SoundMemory(id, fp, type, size);
     }
-    sounds[id] = data;
+    return new SoundFile(id, filename, type, size);
 }
 
-void Media::add_cache(unsigned int id, FSFile & fp)
+void Media::add_file(unsigned int id, const std::string & fn)
 {
+    std::string filename = convert_path(fn);
+    size_t size = platform_get_file_size(filename.c_str());
+    sounds[id] = create_file_data(id, filename, size);
+}
+
+void Media::add_cache(unsigned int id, AssetFile & fp)
+{
+    TRACE_ZONE("Media::add_cache");
     FileStream stream(fp);
     AudioType type = (AudioType)stream.read_uint32();
     if (type == NONE)
@@ -543,6 +845,12 @@ void Media::add_cache(unsigned int id, FSFile & fp)
     if ((is_wav && size <= WAV_STREAM_THRESHOLD) ||
         (!is_wav && size <= OGG_STREAM_THRESHOLD))
     {
+#ifdef CHOWDREN_ASSET_MMAP
+        const unsigned char * view = fp.read_view(size);
+        if (view != NULL)
+            data = new SoundMemory(id, view, type, size);
+        else
+#endif
         data = new SoundMemory(id, fp, type, size);
     } else {
         data = new SoundCache(id, fp.tell(), type, size);
@@ -2,6 +2,16 @@
 #define CHOWDREN_MEDIA_H
 
 #include "assetfile.h"
+#include "types.h"
+
+// number of channels that can be addressed by events
+#define CHANNEL_COUNT 32
+
+// voices with a real audio source. channels past this are kept virtual,
+// i.e. silent with their position advanced by time
+#ifndef CHOWDREN_REAL_VOICES
+#define CHOWDREN_REAL_VOICES 32
+#endif
 
 void set_sounds_path(const std::string & path);
 
@@ -16,12 +26,35 @@ class Channel
 {
 public:
     unsigned int id;
+    unsigned int index;
     bool locked;
     ChowdrenAudio::SoundBase * sound;
     double volume, frequency, pan;
+    // voices with a higher priority get a real source first. derived when
+    // a sample starts, unless set with Media::set_channel_priority
+    int priority;
+    int fixed_priority;
+    bool has_fixed_priority;
+
+    // virtual voice state
+    SoundData * data;
+    bool looping;
+    bool is_virtual;
+    bool virtual_paused;
+    double virtual_position;
+    double virtual_time;
+
+    // channels that played the same sample, lowest index first
+    Channel * prev_sample;
+    Channel * next_sample;
 
-    Channel();
+    Channel(unsigned int index);
     void play(SoundData * data, int loop);
+    void start_sound(double offset, bool paused);
+    void make_real();
+    void make_virtual();
+    double get_virtual_position();
+    void set_id(unsigned int id);
     void resume();
     void pause();
     void stop();
@@ -40,7 +73,9 @@ class Media
 {
 public:
     SoundData * sounds[SOUND_ARRAY_SIZE];
-    Channel channels[32];
+    vector<Channel*> channels;
+    Channel * sample_channels[SOUND_ARRAY_SIZE];
+    int real_voices;
 
     enum AudioType
     {
@@ -52,6 +87,9 @@ public:
 
     void init();
     void stop();
+    void update_voices();
+    Channel * get_channel(unsigned int channel);
+    void set_channel_priority(unsigned int channel, int priority);
     void play(SoundData * data, int channel = -1, int loop = 1);
     void play(const std::string & filename, int channel = -1, int loop = 1);
     void play_id(unsigned int id, int channel = -1, int loop = 1);
@@ -84,7 +122,7 @@ public:
     bool is_channel_playing(unsigned int channel);
     bool is_channel_valid(unsigned int channel);
     void add_file(unsigned int id, const std::string & fn);
-    void add_cache(unsigned int id, FSFile & fp);
+    void add_cache(unsigned int id, AssetFile & fp);
     void add_data(unsigned int id, FSFile & fp, size_t size, AudioType type);
     double get_main_volume();
     void set_main_volume(double volume);
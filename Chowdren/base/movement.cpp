@@ -209,24 +209,19 @@ bool Movement::test_position(int x, int y)
 {
     if (!back_col && collisions.empty())
         return false;
-    int old_x = instance->x;
-    int old_y = instance->y;
-    instance->set_position(x, y);
-    bool ret = false;
-    if (back_col)
-        ret = instance->overlaps_background();
-    if (!ret) {
-        FlatObjectList::const_iterator it;
-        for (it = collisions.begin(); it != collisions.end(); ++it) {
-            FrameObject * obj = *it;
-            if (!instance->overlaps(obj))
-                continue;
-            ret = true;
-            break;
-        }
+    // test at an offset instead of moving the instance, so probing does not
+    // move the broadphase proxy or clear the collision cache
+    int dx = x - instance->x;
+    int dy = y - instance->y;
+    if (back_col && instance->overlaps_background(dx, dy))
+        return true;
+    FlatObjectList::const_iterator it;
+    for (it = collisions.begin(); it != collisions.end(); ++it) {
+        FrameObject * obj = *it;
+        if (instance->overlaps(obj, dx, dy))
+            return true;
     }
-    instance->set_position(old_x, old_y);
-    return ret;
+    return false;
 }
 
 static const int fix_pos_table[] = {
@@ -11,6 +11,9 @@ Active::Active(int x, int y, int type_id)
   animation_direction(0), stopped(false), flash_interval(0.0f),
   animation_finished(-1), transparent(false), image(NULL), direction_data(NULL)
 {
+#ifdef CHOWDREN_PARALLEL_UPDATE
+    integrated = false;
+#endif
     sprite_col.instance = this;
     collision = &sprite_col;
 }
@@ -173,31 +176,9 @@ void Active::update_action_point()
     action_y -= sprite_col.new_hotspot_y;
 }
 
-void Active::update()
+// advances the animation counter, returns true if the frame image changed
+bool Active::advance_animation()
 {
-#ifdef CHOWDREN_DEFER_COLLISIONS
-    flags |= DEFER_COLLISIONS;
-    memcpy(old_aabb, sprite_col.aabb, sizeof(old_aabb));
-#endif
-    if (flags & FADEOUT && animation_finished == DISAPPEARING) {
-        FrameObject::destroy();
-        return;
-    }
-
-    update_flash(flash_interval, flash_time);
-
-    animation_finished = -1;
-
-    if (forced_animation == -1 && animation != current_animation) {
-        current_animation = animation;
-        animation_frame = 0;
-        update_direction();
-    }
-
-    if (forced_frame != -1 || stopped || loop_count == 0) {
-        return;
-    }
-
     counter += int(get_speed() * frame->timer_mul);
     int old_frame = animation_frame;
 
@@ -221,9 +202,69 @@ void Active::update()
             forced_speed = -1;
             forced_direction = -1;
         }
+        return false;
+    }
+    return animation_frame != old_frame;
+}
+
+#ifdef CHOWDREN_PARALLEL_UPDATE
+
+// Runs on a job thread before update(). Only the steady case is handled
+// here, i.e. a running animation without a pending change, and only this
+// instance is touched. update() does the rest in the serial pass.
+void Active::integrate()
+{
+    integrated = false;
+    if (flags & FADEOUT && animation_finished == DISAPPEARING)
+        return;
+    if (forced_animation == -1 && animation != current_animation)
+        return;
+    if (forced_frame != -1 || stopped || loop_count == 0)
+        return;
+    animation_finished = -1;
+    integrated_frame = advance_animation();
+    integrated = true;
+}
+
+#endif
+
+void Active::update()
+{
+#ifdef CHOWDREN_DEFER_COLLISIONS
+    flags |= DEFER_COLLISIONS;
+    memcpy(old_aabb, sprite_col.aabb, sizeof(old_aabb));
+#endif
+
+#ifdef CHOWDREN_PARALLEL_UPDATE
+    if (integrated) {
+        integrated = false;
+        update_flash(flash_interval, flash_time);
+        if (integrated_frame)
+            update_frame();
         return;
     }
-    if (animation_frame != old_frame)
+#endif
+
+    if (flags & FADEOUT && animation_finished == DISAPPEARING) {
+        FrameObject::destroy();
+        return;
+    }
+
+    update_flash(flash_interval, flash_time);
+
+    animation_finished = -1;
+
+    if (forced_animation == -1 && animation != current_animation) {
+        current_animation = animation;
+        animation_frame = 0;
+        update_direction();
+    }
+
+    if (forced_frame != -1 || stopped || loop_count == 0) {
+        return;
+    }
+
+    if (advance_animation())
         update_frame();
 }
 
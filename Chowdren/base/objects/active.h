@@ -34,6 +34,12 @@ public:
     int old_aabb[4];
 #endif
 
+#ifdef CHOWDREN_PARALLEL_UPDATE
+    // set by integrate() when update() only has to finish the frame
+    bool integrated;
+    bool integrated_frame;
+#endif
+
     Animations * animations;
 
     int animation, current_animation;
@@ -68,7 +74,11 @@ public:
     void update_frame();
     void update_direction(Direction * dir = NULL);
     void update_action_point();
+    bool advance_animation();
     void update();
+#ifdef CHOWDREN_PARALLEL_UPDATE
+    void integrate();
+#endif
     void draw();
     int get_action_x();
     int get_action_y();
@@ -2,9 +2,60 @@
 #include "chowconfig.h"
 #include "fileio.h"
 #include "datastream.h"
+#include "platform.h"
 #include <algorithm>
 #include "stringcommon.h"
 
+// ArrayStringPool
+
+ArrayStringPool::ArrayStringPool()
+{
+    strings.push_back(std::string());
+    refs.push_back(0);
+}
+
+unsigned int ArrayStringPool::add(const std::string & value)
+{
+    if (value.empty())
+        return 0;
+    hash_map<std::string, unsigned int>::const_iterator it;
+    it = lookup.find(value);
+    if (it != lookup.end()) {
+        refs[it->second]++;
+        return it->second;
+    }
+    unsigned int index;
+    if (free_list.empty()) {
+        index = strings.size();
+        strings.push_back(value);
+        refs.push_back(1);
+    } else {
+        index = free_list.back();
+        free_list.pop_back();
+        strings[index] = value;
+        refs[index] = 1;
+    }
+    lookup[value] = index;
+    return index;
+}
+
+void ArrayStringPool::release(unsigned int index)
+{
+    if (index == 0 || --refs[index] > 0)
+        return;
+    lookup.erase(strings[index]);
+    strings[index].clear();
+    free_list.push_back(index);
+}
+
+void ArrayStringPool::clear()
+{
+    strings.resize(1);
+    refs.resize(1);
+    free_list.clear();
+    lookup.clear();
+}
+
 // ArrayObject
 
 ArrayObject::ArrayObject(int x, int y, int type_id)
@@ -32,15 +83,34 @@ void ArrayObject::initialize(bool numeric, int offset, int x, int y, int z)
 #define TEXT_FLAG 2
 #define BASE1_FLAG 4
 
+// numeric cells can be copied straight from the file data
+#if !defined(IS_BIG_ENDIAN) && !defined(CHOWDREN_ARRAYEXT_DOUBLES)
+#define ARRAY_COPY_NUMBERS
+#endif
+
+inline int read_array_int(const char * data)
+{
+    const unsigned char * p = (const unsigned char*)data;
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
+}
+
+inline void write_array_int(std::string & out, int value)
+{
+    char data[4] = {char(value), char(value >> 8), char(value >> 16),
+                    char(value >> 24)};
+    out.append(data, 4);
+}
+
 void ArrayObject::load(const std::string & filename)
 {
-    FSFile fp(convert_path(filename).c_str(), "r");
-    if (!fp.is_open()) {
+    // read the whole file at once, the cells are copied from memory
+    std::string src;
+    if (!read_file(convert_path(filename).c_str(), src)) {
         std::cout << "Could not load data.array " << filename << std::endl;
         return;
     }
 
-    FileStream stream(fp);
+    StringStream stream(src);
 
     std::string magic;
     stream.read_string(magic, sizeof(CT_ARRAY_MAGIC));
@@ -70,51 +140,114 @@ void ArrayObject::load(const std::string & filename)
     data.is_numeric = (flags & NUMERIC_FLAG) != 0;
     data.offset = int((flags & BASE1_FLAG) != 0);
 
-    delete[] data.array;
-    delete[] data.strings;
-    data.array = NULL;
-    data.strings = NULL;
     clear();
 
-    for (int i = 0; i < data.x_size * data.y_size * data.z_size; i++) {
-        if (data.is_numeric) {
-            data.array[i] = ArrayNumber(stream.read_int32());
-        } else {
-            stream.read_string(data.strings[i], stream.read_int32());
+    int x_size = data.x_size;
+    const char * p = src.data() + stream.pos;
+    const char * end = src.data() + src.size();
+
+    if (data.is_numeric) {
+        size_t size = size_t(x_size) * data.y_size * data.z_size * 4;
+        if (size_t(end - p) < size) {
+            std::cout << "Truncated array file: " << filename << std::endl;
+            return;
         }
+        for (int z = 0; z < data.z_size; z++)
+        for (int y = 0; y < data.y_size; y++)
+        for (int x = 0; x < x_size; x += ARRAY_TILE_SIZE) {
+            // one tile row at a time
+            int count = std::min(ARRAY_TILE_SIZE, x_size - x);
+            ArrayNumber * dst = &data.numbers.get_ref(x, y, z);
+#ifdef ARRAY_COPY_NUMBERS
+            memcpy(dst, p, count * 4);
+            p += count * 4;
+#else
+            for (int i = 0; i < count; i++) {
+                dst[i] = ArrayNumber(read_array_int(p));
+                p += 4;
+            }
+#endif
+        }
+        return;
     }
 
-    fp.close();
+    ArrayStringPool & pool = *data.pool;
+    std::string value;
+    for (int z = 0; z < data.z_size; z++)
+    for (int y = 0; y < data.y_size; y++)
+    for (int x = 0; x < x_size; x++) {
+        if (end - p < 4)
+            return;
+        int len = read_array_int(p);
+        p += 4;
+        if (len <= 0)
+            continue;
+        if (end - p < len)
+            return;
+        value.assign(p, len);
+        p += len;
+        data.strings.get_ref(x, y, z) = pool.add(value);
+    }
 }
 
 void ArrayObject::save(const std::string & filename)
 {
-    FSFile fp(convert_path(filename).c_str(), "w");
-    FileStream stream(fp);
-
-    stream.write(CT_ARRAY_MAGIC, sizeof(CT_ARRAY_MAGIC));
-    stream.write_int16(ARRAY_MAJOR_VERSION);
-    stream.write_int16(ARRAY_MINOR_VERSION);
-    stream.write_int32(data.x_size);
-    stream.write_int32(data.y_size);
-    stream.write_int32(data.z_size);
+    // build the file in memory and write it at once
+    std::string out;
+    out.append(CT_ARRAY_MAGIC, sizeof(CT_ARRAY_MAGIC));
+    char version[4] = {ARRAY_MAJOR_VERSION, 0, ARRAY_MINOR_VERSION, 0};
+    out.append(version, 4);
+    write_array_int(out, data.x_size);
+    write_array_int(out, data.y_size);
+    write_array_int(out, data.z_size);
 
     int flags = 0;
     if (data.is_numeric)
         flags |= NUMERIC_FLAG;
     if (data.offset != 0)
         flags |= BASE1_FLAG;
-    stream.write_int32(flags);
-
-    for (int i = 0; i < data.x_size * data.y_size * data.z_size; i++) {
-        if (data.is_numeric) {
-            stream.write_int32(int(data.array[i]));
-        } else {
-            stream.write_int32(data.strings[i].size());
-            stream.write_string(data.strings[i]);
+    write_array_int(out, flags);
+
+    int x_size = data.x_size;
+    if (data.is_numeric) {
+        out.reserve(out.size() +
+                    size_t(x_size) * data.y_size * data.z_size * 4);
+        for (int z = 0; z < data.z_size; z++)
+        for (int y = 0; y < data.y_size; y++)
+        for (int x = 0; x < x_size; x += ARRAY_TILE_SIZE) {
+            int count = std::min(ARRAY_TILE_SIZE, x_size - x);
+            ArrayNumber * tile = data.numbers.get_tile(x, y, z);
+            if (tile == NULL) {
+                out.append(count * 4, '\0');
+                continue;
+            }
+            ArrayNumber * src = tile + (y & ARRAY_TILE_MASK) *
+                                ARRAY_TILE_SIZE;
+#ifdef ARRAY_COPY_NUMBERS
+            out.append((const char*)src, count * 4);
+#else
+            for (int i = 0; i < count; i++)
+                write_array_int(out, int(src[i]));
+#endif
+        }
+    } else {
+        const ArrayStringPool & pool = *data.pool;
+        for (int z = 0; z < data.z_size; z++)
+        for (int y = 0; y < data.y_size; y++)
+        for (int x = 0; x < x_size; x++) {
+            unsigned int index = data.strings.get(x, y, z);
+            const std::string & value = pool.strings[index];
+            write_array_int(out, value.size());
+            out += value;
         }
     }
 
+    FSFile fp(convert_path(filename).c_str(), "w");
+    if (!fp.is_open()) {
+        std::cout << "Could not save array " << filename << std::endl;
+        return;
+    }
+    fp.write(&out[0], out.size());
     fp.close();
 
     std::cout << "saved: " << filename << std::endl;
@@ -123,31 +256,39 @@ void ArrayObject::save(const std::string & filename)
 ArrayNumber ArrayObject::get_value(int x, int y, int z)
 {
     adjust_pos(x, y, z);
-    if (!is_valid(x, y, z))
+    if (!is_valid(x, y, z) || !data.is_numeric)
         return 0;
-    return data.array[get_index(x, y, z)];
+    return data.numbers.get(x, y, z);
 }
 
 const std::string & ArrayObject::get_string(int x, int y, int z)
 {
     adjust_pos(x, y, z);
-    if (!is_valid(x, y, z))
+    if (!is_valid(x, y, z) || data.is_numeric)
         return empty_string;
-    return data.strings[get_index(x, y, z)];
+    return data.pool->strings[data.strings.get(x, y, z)];
 }
 
 void ArrayObject::set_value(ArrayNumber value, int x, int y, int z)
 {
     adjust_pos(x, y, z);
+    if (x < 0 || y < 0 || z < 0 || !data.is_numeric)
+        return;
     expand(x, y, z);
-    data.array[get_index(x, y, z)] = value;
+    data.numbers.get_ref(x, y, z) = value;
 }
 
 void ArrayObject::set_string(const std::string & value, int x, int y, int z)
 {
     adjust_pos(x, y, z);
+    if (x < 0 || y < 0 || z < 0 || data.is_numeric)
+        return;
     expand(x, y, z);
-    data.strings[get_index(x, y, z)] = value;
+    // add first, the value may be the string that is released
+    unsigned int index = data.pool->add(value);
+    unsigned int & cell = data.strings.get_ref(x, y, z);
+    data.pool->release(cell);
+    cell = index;
 }
 
 void ArrayObject::expand(int x, int y, int z)
@@ -158,46 +299,16 @@ void ArrayObject::expand(int x, int y, int z)
     if (x == data.x_size && y == data.y_size && z == data.z_size)
         return;
 
-#ifndef NDEBUG
-    // probably good to signify that something should be preallocated
-    std::cout << "Expanding " << get_name() << "from " <<
-        "(" << data.x_size << ", " << data.y_size << ", " << data.z_size << ")" <<
-        " to" <<
-        "(" << x << ", " << y << ", " << z << ")" << std::endl;
-#endif
-
-    int old_x = data.x_size;
-    int old_y = data.y_size;
-    int old_z = data.z_size;
-
     data.x_size = x;
     data.y_size = y;
     data.z_size = z;
 
-    if (data.is_numeric) {
-        ArrayNumber * old_array = data.array;
-        data.array = NULL;
-        clear();
-        for (int x = 0; x < old_x; x++)
-        for (int y = 0; y < old_y; y++)
-        for (int z = 0; z < old_z; z++) {
-            ArrayNumber value = old_array[x + y * old_x + z * old_x * old_y];
-            data.array[get_index(x, y, z)] = value;
-        }
-        delete[] old_array;
-    } else {
-        std::string * old_array = data.strings;
-        data.strings = NULL;
-        clear();
-        for (int x = 0; x < old_x; x++)
-        for (int y = 0; y < old_y; y++)
-        for (int z = 0; z < old_z; z++) {
-            const std::string & value = old_array[x + y * old_x +
-                                                  z * old_x * old_y];
-            data.strings[get_index(x, y, z)] = value;
-        }
-        delete[] old_array;
-    }
+    // the new cells are in tiles that were never written, or in the
+    // unused part of a tile, so they are already 0
+    if (data.is_numeric)
+        data.numbers.reserve(x, y, z);
+    else
+        data.strings.reserve(x, y, z);
 }
 
 ArrayObject::~ArrayObject()
@@ -206,23 +317,22 @@ ArrayObject::~ArrayObject()
         global_data->value = data;
         return;
     }
-    if (data.is_numeric)
-        delete[] data.array;
-    else
-        delete[] data.strings;
+    data.numbers.destroy();
+    data.strings.destroy();
+    delete data.pool;
 }
 
 void ArrayObject::clear()
 {
+    data.numbers.clear();
+    data.strings.clear();
     if (data.is_numeric) {
-        delete[] data.array;
-        data.array = new ArrayNumber[data.x_size *
-                                     data.y_size *
-                                     data.z_size]();
+        data.numbers.reserve(data.x_size, data.y_size, data.z_size);
     } else {
-        delete[] data.strings;
-        data.strings = new std::string[data.x_size *
-                                       data.y_size *
-                                       data.z_size];
+        data.strings.reserve(data.x_size, data.y_size, data.z_size);
+        if (data.pool == NULL)
+            data.pool = new ArrayStringPool;
+        else
+            data.pool->clear();
     }
 }
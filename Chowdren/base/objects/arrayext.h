@@ -3,6 +3,8 @@
 
 #include "frameobject.h"
 #include <string>
+#include <deque>
+#include <algorithm>
 #include "datastream.h"
 #include "types.h"
 
@@ -12,6 +14,119 @@ typedef double ArrayNumber;
 typedef int ArrayNumber;
 #endif
 
+#define ARRAY_TILE_BITS 4
+#define ARRAY_TILE_SIZE (1 << ARRAY_TILE_BITS)
+#define ARRAY_TILE_MASK (ARRAY_TILE_SIZE - 1)
+#define ARRAY_TILE_CELLS (ARRAY_TILE_SIZE * ARRAY_TILE_SIZE)
+
+// Cells are stored in tiles of ARRAY_TILE_SIZE * ARRAY_TILE_SIZE cells on
+// one z layer. A tile is allocated on the first write to it, and growing
+// the array only reallocates the table of tile pointers. Copies share the
+// tiles, so the owner frees them with destroy().
+template <class T>
+struct ArrayTiles
+{
+    T ** tiles;
+    // table size in tiles
+    int width, height, depth;
+
+    ArrayTiles()
+    : tiles(NULL), width(0), height(0), depth(0)
+    {
+    }
+
+    T *& get_tile(int x, int y, int z)
+    {
+        return tiles[(x >> ARRAY_TILE_BITS) +
+                     (y >> ARRAY_TILE_BITS) * width +
+                     z * width * height];
+    }
+
+    T get(int x, int y, int z)
+    {
+        T * tile = get_tile(x, y, z);
+        if (tile == NULL)
+            return T();
+        return tile[(x & ARRAY_TILE_MASK) +
+                    (y & ARRAY_TILE_MASK) * ARRAY_TILE_SIZE];
+    }
+
+    T & get_ref(int x, int y, int z)
+    {
+        T *& tile = get_tile(x, y, z);
+        if (tile == NULL)
+            tile = new T[ARRAY_TILE_CELLS]();
+        return tile[(x & ARRAY_TILE_MASK) +
+                    (y & ARRAY_TILE_MASK) * ARRAY_TILE_SIZE];
+    }
+
+    void reserve(int x_size, int y_size, int z_size)
+    {
+        int w = (x_size + ARRAY_TILE_MASK) >> ARRAY_TILE_BITS;
+        int h = (y_size + ARRAY_TILE_MASK) >> ARRAY_TILE_BITS;
+        int d = z_size;
+        if (w <= width && h <= height && d <= depth)
+            return;
+        // grow by doubling, so writing one cell further each time is cheap
+        if (w > width)
+            w = std::max(w, width * 2);
+        if (h > height)
+            h = std::max(h, height * 2);
+        if (d > depth)
+            d = std::max(d, depth * 2);
+        w = std::max(w, width);
+        h = std::max(h, height);
+        d = std::max(d, depth);
+
+        T ** new_tiles = new T*[w * h * d]();
+        for (int z = 0; z < depth; z++)
+        for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            new_tiles[x + y * w + z * w * h] =
+                tiles[x + y * width + z * width * height];
+        delete[] tiles;
+        tiles = new_tiles;
+        width = w;
+        height = h;
+        depth = d;
+    }
+
+    // frees the tiles, so all cells are 0 again
+    void clear()
+    {
+        int count = width * height * depth;
+        for (int i = 0; i < count; i++) {
+            delete[] tiles[i];
+            tiles[i] = NULL;
+        }
+    }
+
+    void destroy()
+    {
+        clear();
+        delete[] tiles;
+        tiles = NULL;
+        width = height = depth = 0;
+    }
+};
+
+// Strings of a text array. Cells store an index into the pool, and equal
+// strings share one entry. Index 0 is the empty string.
+class ArrayStringPool
+{
+public:
+    // a deque, so references to the strings stay valid while adding
+    std::deque<std::string> strings;
+    vector<unsigned int> refs;
+    vector<unsigned int> free_list;
+    hash_map<std::string, unsigned int> lookup;
+
+    ArrayStringPool();
+    unsigned int add(const std::string & value);
+    void release(unsigned int index);
+    void clear();
+};
+
 class ArrayObject : public FrameObject
 {
 public:
@@ -20,15 +135,16 @@ public:
     struct ArrayData
     {
         ArrayData()
-        : offset(0), is_numeric(0), array(NULL), strings(NULL),
+        : offset(0), is_numeric(0), pool(NULL),
           x_size(0), y_size(0), z_size(0)
         {
         }
 
         int offset;
         bool is_numeric;
-        ArrayNumber * array;
-        std::string * strings;
+        ArrayTiles<ArrayNumber> numbers;
+        ArrayTiles<unsigned int> strings;
+        ArrayStringPool * pool;
         int x_size, y_size, z_size;
         int x_pos, y_pos, z_pos;
     };
@@ -67,11 +183,6 @@ public:
         z -= data.offset;
     }
 
-    inline int get_index(int x, int y, int z)
-    {
-        return x + y * data.x_size + z * data.x_size * data.y_size;
-    }
-
     inline bool is_valid(int x, int y, int z)
     {
         return x >= 0 && y >= 0 && z >= 0 &&
@@ -2,10 +2,80 @@
 #include "objects/blowfish.cpp"
 #include "fileio.h"
 #include <iostream>
+#include <algorithm>
 #include "stringcommon.h"
+#include "benchmark.h"
 
 #define ARRAY_MAGIC "ASSBF1.0"
 
+// ArrayMap
+
+struct KeyLess
+{
+    bool operator()(const std::string * a, const std::string * b) const
+    {
+        return *a < *b;
+    }
+
+    bool operator()(const std::string * a, const std::string & b) const
+    {
+        return *a < b;
+    }
+};
+
+// true if key comes after all keys starting with prefix
+struct PrefixLess
+{
+    bool operator()(const std::string & prefix, const std::string * key) const
+    {
+        return key->compare(0, prefix.size(), prefix) > 0;
+    }
+};
+
+void ArrayMap::update_index()
+{
+    if (sorted == keys.size())
+        return;
+    std::sort(keys.begin() + sorted, keys.end(), KeyLess());
+    std::inplace_merge(keys.begin(), keys.begin() + sorted, keys.end(),
+                       KeyLess());
+    sorted = keys.size();
+}
+
+void ArrayMap::erase(iterator it)
+{
+    const std::string * key = &it->first;
+    vector<const std::string*>::iterator sorted_end = keys.begin() + sorted;
+    vector<const std::string*>::iterator pos;
+    pos = std::lower_bound(keys.begin(), sorted_end, *key, KeyLess());
+    if (pos != sorted_end && *pos == key) {
+        keys.erase(pos);
+        sorted--;
+    } else
+        keys.erase(std::find(sorted_end, keys.end(), key));
+    items.erase(it);
+}
+
+void ArrayMap::get_prefix_range(const std::string & prefix,
+                                unsigned int * start, unsigned int * end)
+{
+    update_index();
+    vector<const std::string*>::iterator first, last;
+    first = std::lower_bound(keys.begin(), keys.end(), prefix, KeyLess());
+    last = std::upper_bound(first, keys.end(), prefix, PrefixLess());
+    *start = first - keys.begin();
+    *end = last - keys.begin();
+}
+
+unsigned int ArrayMap::get_index(const std::string & key)
+{
+    update_index();
+    return std::lower_bound(keys.begin(), keys.end(), key, KeyLess()) -
+           keys.begin();
+}
+
+// AssociateArray
+
 AssociateArray::AssociateArray(int x, int y, int type_id)
 : FrameObject(x, y, type_id), store()
 {
@@ -157,14 +227,9 @@ bool AssociateArray::count_prefix(const std::string & key, int count)
 
 int AssociateArray::count_prefix(const std::string & key)
 {
-    int n = 0;
-    ArrayMap::const_iterator it;
-    for (it = map->begin(); it != map->end(); it++) {
-        const std::string & other = it->first;
-        if (other.compare(0, key.size(), key) == 0)
-            n++;
-    }
-    return n;
+    unsigned int start, end;
+    map->get_prefix_range(key, &start, &end);
+    return end - start;
 }
 
 void AssociateArray::remove_key(const std::string & key)
@@ -182,40 +247,36 @@ void AssociateArray::remove_key(const std::string & key)
     map->erase(it);
 }
 
+// keys are walked in sorted order
+
 ArrayAddress AssociateArray::get_first()
 {
-    ArrayMap::const_iterator it;
-    it = map->begin();
-    if (it == map->end())
+    map->update_index();
+    if (map->keys.empty())
         return ArrayAddress();
-    return ArrayAddress(it);
+    return ArrayAddress(map->keys[0]);
 }
 
 ArrayAddress AssociateArray::get_prefix(const std::string & prefix, int index,
                                         ArrayAddress start)
 {
-    ArrayMap::const_iterator it;
-    if (start.null)
-        it = map->begin();
-    else
-        it = start.it;
-
-    for (; it != map->end(); it++) {
-        const std::string & other = it->first;
-        if (other.compare(0, prefix.size(), prefix) != 0)
-            continue;
-        if (index == 0)
-            return ArrayAddress(it);
-        index--;
-    }
-    return ArrayAddress();
+    if (index < 0)
+        return ArrayAddress();
+    unsigned int first, last;
+    map->get_prefix_range(prefix, &first, &last);
+    if (start.key != NULL)
+        first = std::max(first, map->get_index(*start.key));
+    unsigned int pos = first + index;
+    if (pos >= last)
+        return ArrayAddress();
+    return ArrayAddress(map->keys[pos]);
 }
 
 const std::string & AssociateArray::get_key(ArrayAddress addr)
 {
-    if (addr.null)
+    if (addr.key == NULL)
         return empty_string;
-    return addr.it->first;
+    return *addr.key;
 }
 
 void AssociateArray::save(BaseStream & stream, int method)
@@ -352,6 +413,82 @@ bool AssociateArray::has_key(int index, const std::string & key)
     return true;
 }
 
+#ifdef CHOWDREN_BENCHMARK
+
+#include <stdio.h>
+#include "platform.h"
+
+#define BENCHMARK_PREFIXES 3
+
+static const char * benchmark_prefixes[BENCHMARK_PREFIXES] = {
+    "item_", "quest_", "flag_"
+};
+
+void AssociateArray::run_benchmark(int count)
+{
+    ArrayMap map;
+    AssociateArray array(0, 0, 0);
+    array.map = &map;
+
+    double t = platform_get_time();
+    for (int i = 0; i < count; i++) {
+        std::string key = benchmark_prefixes[i % BENCHMARK_PREFIXES];
+        key += number_to_string(i);
+        array.set_value(key, i);
+        array.set_string(key, key);
+    }
+    double insert_time = platform_get_time() - t;
+
+    t = platform_get_time();
+    std::stringstream ss;
+    DataStream stream(ss);
+    array.save(stream, 0);
+    std::string data = ss.str();
+    double save_time = platform_get_time() - t;
+
+    t = platform_get_time();
+    array.clear();
+    array.load_data(data.substr(sizeof(ARRAY_MAGIC)-1), 0);
+    double load_time = platform_get_time() - t;
+
+    // the first query builds the index
+    t = platform_get_time();
+    int matches = 0;
+    for (int i = 0; i < BENCHMARK_PREFIXES; i++)
+        matches += array.count_prefix(benchmark_prefixes[i]);
+    double count_time = platform_get_time() - t;
+
+    // listing all keys of a prefix, the way events do it
+    t = platform_get_time();
+    size_t key_size = 0;
+    for (int i = 0; i < BENCHMARK_PREFIXES; i++) {
+        std::string prefix = benchmark_prefixes[i];
+        int n = array.count_prefix(prefix);
+        for (int j = 0; j < n; j++) {
+            ArrayAddress addr = array.get_prefix(prefix, j,
+                                                 array.get_first());
+            key_size += array.get_key(addr).size();
+        }
+    }
+    double list_time = platform_get_time() - t;
+
+    fprintf(stdout, "{\n");
+    fprintf(stdout, "    \"keys\": %d,\n", count);
+    fprintf(stdout, "    \"matches\": %d,\n", matches);
+    fprintf(stdout, "    \"key_bytes\": %lu,\n", (unsigned long)key_size);
+    fprintf(stdout, "    \"insert_ms\": %.4f,\n", insert_time * 1000.0);
+    fprintf(stdout, "    \"save_ms\": %.4f,\n", save_time * 1000.0);
+    fprintf(stdout, "    \"load_ms\": %.4f,\n", load_time * 1000.0);
+    fprintf(stdout, "    \"count_prefix_ms\": %.4f,\n", count_time * 1000.0);
+    fprintf(stdout, "    \"list_prefix_ms\": %.4f\n", list_time * 1000.0);
+    fprintf(stdout, "}\n");
+
+    // keep the destructor from deleting the map, like DefaultArray does
+    array.map = &global_map;
+}
+
+#endif
+
 ArrayMap AssociateArray::global_map;
 
 static ArrayMap default_map;
@@ -18,25 +18,86 @@ public:
     }
 };
 
-// #include <boost/container/flat_map.hpp>
-// typedef boost::container::flat_map<std::string, AssociateArrayItem> ArrayMap;
+typedef hash_map<std::string, AssociateArrayItem> ArrayItems;
 
-//// XXX is this faster?
-typedef hash_map<std::string, AssociateArrayItem> ArrayMap;
+// Hashed items with a sorted index of their keys, so the keys with a given
+// prefix are a range found with a binary search. New keys are appended to
+// the index and merged in on the next prefix query.
+class ArrayMap
+{
+public:
+    typedef ArrayItems::iterator iterator;
+    typedef ArrayItems::const_iterator const_iterator;
+
+    ArrayItems items;
+    // keys of items, the first 'sorted' of them in order
+    vector<const std::string*> keys;
+    unsigned int sorted;
+
+    ArrayMap()
+    : sorted(0)
+    {
+    }
+
+    iterator begin()
+    {
+        return items.begin();
+    }
+
+    iterator end()
+    {
+        return items.end();
+    }
+
+    iterator find(const std::string & key)
+    {
+        return items.find(key);
+    }
+
+    size_t size() const
+    {
+        return items.size();
+    }
+
+    AssociateArrayItem & operator[](const std::string & key)
+    {
+        iterator it = items.find(key);
+        if (it != items.end())
+            return it->second;
+        it = items.insert(ArrayItems::value_type(key,
+                                                 AssociateArrayItem())).first;
+        keys.push_back(&it->first);
+        return it->second;
+    }
+
+    void clear()
+    {
+        items.clear();
+        keys.clear();
+        sorted = 0;
+    }
+
+    void erase(iterator it);
+    void update_index();
+    // index range of the keys starting with prefix
+    void get_prefix_range(const std::string & prefix, unsigned int * start,
+                          unsigned int * end);
+    // index of an existing key
+    unsigned int get_index(const std::string & key);
+};
 
 class ArrayAddress
 {
 public:
-    ArrayMap::const_iterator it;
-    bool null;
+    const std::string * key;
 
-    ArrayAddress(const ArrayMap::const_iterator & it)
-    : it(it), null(false)
+    ArrayAddress(const std::string * key)
+    : key(key)
     {
     }
 
     ArrayAddress()
-    : null(true)
+    : key(NULL)
     {
     }
 };
@@ -86,6 +147,11 @@ public:
     void set_string(int store, const std::string & key,
                     const std::string & value);
     bool has_key(int store, const std::string & key);
+
+#ifdef CHOWDREN_BENCHMARK
+    // times loading, saving and prefix queries on generated keys
+    static void run_benchmark(int keys);
+#endif
 };
 
 extern FrameObject * default_assarray_instance;
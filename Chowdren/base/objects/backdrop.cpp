@@ -27,3 +27,15 @@ void Backdrop::draw()
 #endif
     draw_image(image, x + image->hotspot_x, y + image->hotspot_y, blend_color);
 }
+
+#ifdef CHOWDREN_LAYER_CACHE
+bool Backdrop::can_bake()
+{
+#if defined(CHOWDREN_IS_WIIU) || defined(CHOWDREN_EMULATE_WIIU)
+    // depends on the remote being drawn
+    return remote == CHOWDREN_HYBRID_TARGET;
+#else
+    return true;
+#endif
+}
+#endif
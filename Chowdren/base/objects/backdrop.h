@@ -17,6 +17,9 @@ public:
     Backdrop(int x, int y, int type_id);
     ~Backdrop();
     void draw();
+#ifdef CHOWDREN_LAYER_CACHE
+    bool can_bake();
+#endif
 };
 
 #endif // CHOWDREN_BACKDROP_H
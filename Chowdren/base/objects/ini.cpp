@@ -76,9 +76,159 @@ static void encrypt_ini_data(std::string & data, const std::string & key)
     }
 }
 
+// Saving. Files are written to a temporary file first and then renamed, so
+// a crash while writing does not lose the old file. With
+// CHOWDREN_AUTOSAVE_ON_CHANGE, changes only mark the INI as dirty, and the
+// dirty INIs are saved once at the end of the frame. The writes happen on a
+// writer thread on desktop, where a queued save of a file is replaced by a
+// newer save of the same file.
+
+// the writer is an SDL thread, and Steam Cloud writes stay on the main thread
+#if defined(CHOWDREN_AUTOSAVE_ON_CHANGE) && defined(CHOWDREN_IS_DESKTOP) && \
+    !defined(CHOWDREN_IS_EMSCRIPTEN) && !defined(CHOWDREN_AUTO_STEAMCLOUD)
+#define CHOWDREN_INI_WRITER
+#include <SDL_thread.h>
+#include <SDL_mutex.h>
+#endif
+
+struct INISave
+{
+    std::string filename;
+    std::string data;
+    bool compress;
+};
+
+static void write_ini_file(const INISave & save)
+{
+#ifdef CHOWDREN_AUTO_STEAMCLOUD
+    // remote storage writes are already atomic
+    const std::string & path = save.filename;
+#else
+    std::string path = save.filename + ".tmp";
+#endif
+    if (save.compress) {
+        if (!compress_huffman(save.data, path.c_str()))
+            return;
+    } else {
+        FSFile fp(path.c_str(), "w");
+        if (!fp.is_open()) {
+            std::cout << "Could not save INI file: " << save.filename
+                << std::endl;
+            return;
+        }
+        if (!save.data.empty())
+            fp.write(&save.data[0], save.data.size());
+        fp.close();
+    }
+#ifndef CHOWDREN_AUTO_STEAMCLOUD
+    if (!platform_rename_file(path, save.filename))
+        std::cout << "Could not replace INI file: " << save.filename
+            << std::endl;
+#endif
+}
+
+#ifdef CHOWDREN_INI_WRITER
+
+struct INIWriter
+{
+    SDL_mutex * mutex;
+    // signaled when saves are queued
+    SDL_cond * queue_cond;
+    // signaled when the queue is empty and nothing is being written
+    SDL_cond * done_cond;
+    SDL_Thread * thread;
+    vector<INISave*> queue;
+    bool writing;
+};
+
+static INIWriter * ini_writer = NULL;
+
+static int ini_writer_thread(void * data)
+{
+    INIWriter & writer = *ini_writer;
+    SDL_LockMutex(writer.mutex);
+    while (true) {
+        if (writer.queue.empty()) {
+            writer.writing = false;
+            SDL_CondBroadcast(writer.done_cond);
+            SDL_CondWait(writer.queue_cond, writer.mutex);
+            continue;
+        }
+        INISave * save = writer.queue.front();
+        writer.queue.erase(writer.queue.begin());
+        writer.writing = true;
+        SDL_UnlockMutex(writer.mutex);
+
+        write_ini_file(*save);
+        delete save;
+
+        SDL_LockMutex(writer.mutex);
+    }
+    return 0;
+}
+
+static void queue_ini_save(INISave * save)
+{
+    if (ini_writer == NULL) {
+        ini_writer = new INIWriter;
+        ini_writer->mutex = SDL_CreateMutex();
+        ini_writer->queue_cond = SDL_CreateCond();
+        ini_writer->done_cond = SDL_CreateCond();
+        ini_writer->writing = false;
+        ini_writer->thread = SDL_CreateThread(ini_writer_thread, "INI writer",
+                                              NULL);
+    }
+    INIWriter & writer = *ini_writer;
+    SDL_LockMutex(writer.mutex);
+    vector<INISave*>::iterator it;
+    for (it = writer.queue.begin(); it != writer.queue.end(); ++it) {
+        if ((*it)->filename != save->filename)
+            continue;
+        // not written yet, so only the newest data matters
+        delete *it;
+        *it = save;
+        save = NULL;
+        break;
+    }
+    if (save != NULL)
+        writer.queue.push_back(save);
+    writer.writing = true;
+    SDL_CondSignal(writer.queue_cond);
+    SDL_UnlockMutex(writer.mutex);
+}
+
+static void wait_ini_saves()
+{
+    if (ini_writer == NULL)
+        return;
+    INIWriter & writer = *ini_writer;
+    SDL_LockMutex(writer.mutex);
+    while (writer.writing)
+        SDL_CondWait(writer.done_cond, writer.mutex);
+    SDL_UnlockMutex(writer.mutex);
+}
+
+#else
+
+static void queue_ini_save(INISave * save)
+{
+    write_ini_file(*save);
+    delete save;
+}
+
+static void wait_ini_saves()
+{
+}
+
+#endif
+
+#ifdef CHOWDREN_AUTOSAVE_ON_CHANGE
+static vector<INI*> dirty_inis;
+#endif
+
 INI::INI(int x, int y, int type_id)
 : FrameObject(x, y, type_id), overwrite(false), auto_save(false),
-  use_compression(false)
+  use_compression(false), dirty(false)
 {
 }
 
@@ -171,21 +321,27 @@ const std::string & INI::get_string(const std::string & group,
     return get_string_default(group, item, empty_string);
 }
 
+// returns NULL if there is no such group or item
+inline const OptionMap::value_type * get_item_at(const SectionMap & data,
+                                                 const std::string & group,
+                                                 unsigned int index)
+{
+    SectionMap::const_iterator it = data.find(group);
+    if (it == data.end())
+        return NULL;
+    const OptionMap & items = (*it).second;
+    if (index >= items.size())
+        return NULL;
+    return &*(items.begin() + index);
+}
+
 const std::string & INI::get_string_index(const std::string & group,
                                           unsigned int index)
 {
-    SectionMap::const_iterator it = data->find(group);
-    if (it == data->end())
+    const OptionMap::value_type * item = get_item_at(*data, group, index);
+    if (item == NULL)
         return empty_string;
-    OptionMap::const_iterator new_it = (*it).second.begin();
-    int current_index = 0;
-    while (new_it != (*it).second.end()) {
-        if (current_index == index)
-            return (*new_it).second;
-        ++new_it;
-        current_index++;
-    }
-    return empty_string;
+    return item->second;
 }
 
 const std::string & INI::get_string_index(unsigned int index)
@@ -196,18 +352,10 @@ const std::string & INI::get_string_index(unsigned int index)
 const std::string & INI::get_item_name(const std::string & group,
                                        unsigned int index)
 {
-    SectionMap::const_iterator it = data->find(group);
-    if (it == data->end())
+    const OptionMap::value_type * item = get_item_at(*data, group, index);
+    if (item == NULL)
         return empty_string;
-    OptionMap::const_iterator new_it = (*it).second.begin();
-    int current_index = 0;
-    while (new_it != (*it).second.end()) {
-        if (current_index == index)
-            return (*new_it).first;
-        ++new_it;
-        current_index++;
-    }
-    return empty_string;
+    return item->first;
 }
 
 const std::string & INI::get_item_name(unsigned int index)
@@ -217,15 +365,9 @@ const std::string & INI::get_item_name(unsigned int index)
 
 const std::string & INI::get_group_name(unsigned int index)
 {
-    SectionMap::const_iterator it = data->begin();
-    int current_index = 0;
-    while (it != data->end()) {
-        if (current_index == index)
-            return (*it).first;
-        ++it;
-        current_index++;
-    }
-    return empty_string;
+    if (index >= data->size())
+        return empty_string;
+    return (*(data->begin() + index)).first;
 }
 
 double INI::get_value(const std::string & group, const std::string & item,
@@ -247,18 +389,10 @@ double INI::get_value(const std::string & item, double def)
 
 double INI::get_value_index(const std::string & group, unsigned int index)
 {
-    SectionMap::const_iterator it = data->find(group);
-    if (it == data->end())
+    const OptionMap::value_type * item = get_item_at(*data, group, index);
+    if (item == NULL)
         return 0.0;
-    OptionMap::const_iterator new_it = (*it).second.begin();
-    int current_index = 0;
-    while (new_it != (*it).second.end()) {
-        if (current_index == index)
-            return string_to_double((*new_it).second);
-        ++new_it;
-        current_index++;
-    }
-    return 0.0;
+    return string_to_double(item->second);
 }
 
 double INI::get_value_index(unsigned int index)
@@ -303,7 +437,10 @@ void INI::set_string(const std::string & item, const std::string & value)
 void INI::load_file(const std::string & fn, bool read_only, bool merge,
                     bool overwrite)
 {
-#ifndef CHOWDREN_AUTOSAVE_ON_CHANGE
+#ifdef CHOWDREN_AUTOSAVE_ON_CHANGE
+    // the file may be one of the pending saves
+    flush_saves(true);
+#else
     if (auto_save)
         save_file(false);
 #endif
@@ -372,16 +509,28 @@ void INI::merge_file(const std::string & fn, bool overwrite)
 }
 
 void INI::get_data(std::stringstream & out)
+{
+    std::string value;
+    get_data(value);
+    out << value;
+}
+
+void INI::get_data(std::string & out)
 {
     SectionMap::const_iterator it1;
     OptionMap::const_iterator it2;
     for (it1 = data->begin(); it1 != data->end(); ++it1) {
-        out << "[" << (*it1).first << "]" << std::endl;
+        out += "[";
+        out += (*it1).first;
+        out += "]\n";
         for (it2 = (*it1).second.begin(); it2 != (*it1).second.end();
              ++it2) {
-            out << (*it2).first << "=" << (*it2).second << std::endl;
+            out += (*it2).first;
+            out += "=";
+            out += (*it2).second;
+            out += "\n";
         }
-        out << std::endl;
+        out += "\n";
     }
 }
 
@@ -401,33 +550,25 @@ void INI::save_file(const std::string & fn, bool force)
         return;
     filename = convert_path(fn);
     platform_create_directories(get_path_dirname(filename));
-    std::stringstream out;
-    get_data(out);
-    std::string outs = out.str();
 
+    INISave * save = new INISave;
+    save->filename = filename;
+    save->compress = use_compression;
+    get_data(save->data);
     if (!encrypt_key.empty())
-        encrypt_ini_data(outs, encrypt_key);
+        encrypt_ini_data(save->data, encrypt_key);
+    queue_ini_save(save);
 
-    if (use_compression) {
-        compress_huffman(outs, filename.c_str());
-        return;
-    }
-
-    FSFile fp(filename.c_str(), "w");
-    if (!fp.is_open()) {
-        std::cout << "Could not save INI file: " << filename << std::endl;
-        return;
-    }
-	if (!outs.empty())
-        fp.write(&outs[0], outs.size());
-    fp.close();
+#ifdef CHOWDREN_AUTOSAVE_ON_CHANGE
+    dirty = false;
+#endif
 }
 
 std::string INI::as_string()
 {
-    std::stringstream out;
+    std::string out;
     get_data(out);
-    return out.str();
+    return out;
 }
 
 void INI::save_file(bool force)
@@ -438,10 +579,27 @@ void INI::save_file(bool force)
 void INI::save_auto()
 {
 #ifdef CHOWDREN_AUTOSAVE_ON_CHANGE
-    if (!auto_save)
+    if (!auto_save || dirty)
         return;
-    save_file(false);
+    dirty = true;
+    dirty_inis.push_back(this);
+#endif
+}
+
+void INI::flush_saves(bool wait)
+{
+#ifdef CHOWDREN_AUTOSAVE_ON_CHANGE
+    vector<INI*>::const_iterator it;
+    for (it = dirty_inis.begin(); it != dirty_inis.end(); ++it) {
+        INI * ini = *it;
+        if (ini->dirty)
+            ini->save_file(false);
+        ini->dirty = false;
+    }
+    dirty_inis.clear();
 #endif
+    if (wait)
+        wait_ini_saves();
 }
 
 int INI::get_item_count(const std::string & section)
@@ -516,23 +674,26 @@ void INI::delete_pattern(const std::string & group, const std::string & item,
     for (it1 = data->begin(); it1 != data->end(); ++it1) {
         if (!match_wildcard(group, (*it1).first))
             continue;
+        // rebuild the group with the items that are kept, since erasing
+        // the items one by one moves the following items every time
         OptionMap & option_map = (*it1).second;
-        it2 = option_map.begin();
-        while (it2 != option_map.end()) {
-            if (!match_wildcard(item, (*it2).first) ||
-                !match_wildcard(value, (*it2).second)) {
-                ++it2;
+        OptionMap kept;
+        for (it2 = option_map.begin(); it2 != option_map.end(); ++it2) {
+            if (match_wildcard(item, (*it2).first) &&
+                match_wildcard(value, (*it2).second))
                 continue;
-            }
-            option_map.erase(it2++);
+            std::swap(kept[(*it2).first], (*it2).second);
         }
+        option_map.swap(kept);
     }
     save_auto();
 }
 
+#ifdef CHOWDREN_INI_KEEP_ORDER
+
 void INI::sort_group_by_name(const std::string & group)
 {
-    std::cout << "Sort by name not implemented" << std::endl;
+    // already sorted
 }
 
 void INI::sort_group_by_value(const std::string & group)
@@ -540,8 +701,47 @@ void INI::sort_group_by_value(const std::string & group)
     std::cout << "Sort by value not implemented" << std::endl;
 }
 
+#else
+
+inline bool sort_item_name_comp(const OptionMap::value_type & a,
+                                const OptionMap::value_type & b)
+{
+    return a.first < b.first;
+}
+
+inline bool sort_item_value_comp(const OptionMap::value_type & a,
+                                 const OptionMap::value_type & b)
+{
+    return a.second < b.second;
+}
+
+void INI::sort_group_by_name(const std::string & group)
+{
+    SectionMap::iterator it = data->find(group);
+    if (it == data->end())
+        return;
+    (*it).second.sort(sort_item_name_comp);
+    save_auto();
+}
+
+void INI::sort_group_by_value(const std::string & group)
+{
+    SectionMap::iterator it = data->find(group);
+    if (it == data->end())
+        return;
+    (*it).second.sort(sort_item_value_comp);
+    save_auto();
+}
+
+#endif
+
 void INI::close()
 {
+#ifdef CHOWDREN_AUTOSAVE_ON_CHANGE
+    // write the last changes before the filename is gone
+    if (dirty)
+        save_file(false);
+#endif
     data->clear();
     filename.clear();
 }
@@ -604,12 +804,24 @@ void INI::merge_map(const SectionMap & data2, bool overwrite)
 void INI::merge_map(SectionMap & data2, const std::string & src_group,
                     const std::string & dst_group, bool overwrite)
 {
-    OptionMap & items = data2[src_group];
+    SectionMap::iterator src_it = data2.find(src_group);
+    if (src_it == data2.end() || (*src_it).second.empty()) {
+        save_auto();
+        return;
+    }
+    // adding the destination group moves the groups around if data2 is
+    // our own data, so look up the source again afterwards
+    OptionMap & dst = (*data)[dst_group];
+    const OptionMap & items = (*data2.find(src_group)).second;
+    if (&items == &dst) {
+        save_auto();
+        return;
+    }
     OptionMap::const_iterator it;
     for (it = items.begin(); it != items.end(); ++it) {
-        if (!overwrite && has_item(dst_group, (*it).first))
+        if (!overwrite && dst.find((*it).first) != dst.end())
             continue;
-        (*data)[dst_group][(*it).first] = (*it).second;
+        dst[(*it).first] = (*it).second;
     }
     save_auto();
 }
@@ -661,7 +873,14 @@ void INI::set_auto(bool save, bool load)
 
 INI::~INI()
 {
-#ifndef CHOWDREN_AUTOSAVE_ON_CHANGE
+#ifdef CHOWDREN_AUTOSAVE_ON_CHANGE
+    if (dirty)
+        save_file(false);
+    // an explicit save clears dirty but leaves the INI queued, and a later
+    // change can queue it again
+    dirty_inis.erase(std::remove(dirty_inis.begin(), dirty_inis.end(), this),
+                     dirty_inis.end());
+#else
     if (auto_save)
         save_file(false);
 #endif
@@ -5,11 +5,15 @@
 #include "types.h"
 #include "assetfile.h"
 
+// both maps have random access iterators, so the nth group or item is
+// begin() + n. flat_map keeps the entries sorted by name, IndexedMap keeps
+// them in insertion order
 #ifdef CHOWDREN_INI_KEEP_ORDER
 #include <boost/container/flat_map.hpp>
 #define ini_map boost::container::flat_map
 #else
-#define ini_map hash_map
+#include "indexedmap.h"
+#define ini_map IndexedMap
 #endif
 
 typedef ini_map<std::string, std::string> OptionMap;
@@ -33,6 +37,8 @@ public:
     std::string filename;
     std::string encrypt_key;
     unsigned int search_time;
+    // changed since the last autosave
+    bool dirty;
 
     INI(int x, int y, int type_id);
     static void reset_global_data();
@@ -78,12 +84,16 @@ public:
     void load_file(TempPath path);
     void merge_file(const std::string & fn, bool overwrite);
     void get_data(std::stringstream & out);
+    void get_data(std::string & out);
     void save_file(const std::string & fn, bool force = true);
     void set_encryption_key(const std::string & key);
     void set_compression(bool value);
     std::string as_string();
     void save_file(bool force = true);
     void save_auto();
+    // queues the saves of all changed INIs, called at the end of a frame.
+    // with wait, also blocks until the files are written
+    static void flush_saves(bool wait = false);
     void close();
     int get_item_count(const std::string & section);
     int get_item_count();
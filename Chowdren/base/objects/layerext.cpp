@@ -91,6 +91,7 @@ void LayerObject::sort_alt_decreasing(int index, double def)
     Layer * layer = &frame->layers[current_layer];
     layer->instances.sort(sort_func);
     layer->reset_depth();
+    layer->invalidate_draw_list();
 }
 
 void LayerObject::set_rgb(int index, Color color)
@@ -120,3 +120,11 @@ void QuickBackdrop::draw()
         end_draw();
     }
 }
+
+#ifdef CHOWDREN_LAYER_CACHE
+bool QuickBackdrop::can_bake()
+{
+    // patterns only draw the tiles visible to the camera, with a scissor
+    return image == NULL;
+}
+#endif
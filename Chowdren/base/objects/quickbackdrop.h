@@ -20,6 +20,9 @@ public:
     QuickBackdrop(int x, int y, int type_id);
     ~QuickBackdrop();
     void draw();
+#ifdef CHOWDREN_LAYER_CACHE
+    bool can_bake();
+#endif
 
 #ifdef CHOWDREN_LAYER_WRAP
     int x_offset, y_offset;
@@ -113,6 +113,8 @@ void SurfaceObject::draw()
             // XXX this is a hack, generalize it
 			if (effect == Render::SUBPX)
                 hh->set_filter(true);
+            if (effect != Render::NONE)
+                hh->set_standalone();
             hh->upload_texture();
             Texture t = hh->tex;
 
@@ -126,7 +128,8 @@ void SurfaceObject::draw()
 
             Render::draw_tex(draw_x + off_x, draw_y + off_y, 
                              draw_x + off_x + w, draw_y + off_y + h,
-                             blend_color, t);
+                             blend_color, t, hh->tex_x1, hh->tex_y1,
+                             hh->tex_x2, hh->tex_y2);
 
             for (int i = -1; i <= 1; i += 2) {
                 int x1 = draw_x + display_width * i;
@@ -138,7 +141,9 @@ void SurfaceObject::draw()
                     continue;
                 int xx1 = x1 + off_x;
                 int yy1 = y1 + off_y;
-                Render::draw_tex(xx1, yy1, xx1 + w, yy1 + h, blend_color, t);
+                Render::draw_tex(xx1, yy1, xx1 + w, yy1 + h, blend_color, t,
+                                 hh->tex_x1, hh->tex_y1,
+                                 hh->tex_x2, hh->tex_y2);
             }
             end_draw();
         }
@@ -6,7 +6,8 @@
 
 Text::Text(int x, int y, int type_id)
 : FrameObject(x, y, type_id), initialized(false), current_paragraph(0),
-  draw_text_set(false), layout(NULL), scale(1.0f)
+  draw_text_set(false), layout(NULL), scale(1.0f), mesh_font(NULL),
+  layout_box_set(false)
 {
     collision = new InstanceBox(this);
 }
@@ -38,42 +39,73 @@ void Text::draw()
     }
 
     update_draw_text();
-    FTTextureFont::color = blend_color;
+    update_mesh();
+    Render::set_effect(Render::FONT);
+    mesh.draw(int(x + mesh_x), int(y + mesh_y), blend_color);
+    Render::disable_effect();
+}
+
+void Text::update_mesh()
+{
+    if (mesh.valid && mesh_font == font && mesh_width == width &&
+        mesh_height == height && mesh_alignment == alignment)
+        return;
+    mesh_font = font;
+    mesh_width = width;
+    mesh_height = height;
+    mesh_alignment = alignment;
+
+    // the glyphs are laid out at the origin. positions are whole pixels, so
+    // moving the mesh gives the same result as laying out in place
     if (layout != NULL) {
-        FTBBox bb = layout->BBox(draw_text.c_str(), -1);
-        double off_y = y + font->Ascender();
-        layout->Render(draw_text.c_str(), -1, FTPoint(x, int(off_y)));
-    } else {
-        FTBBox box = font->BBox(draw_text.c_str(), -1, FTPoint());
-        double box_w = box.Upper().X() - box.Lower().X();
-        // double box_h = box.Upper().Y() - box.Lower().Y();
-        double off_x = x;
-        double off_y = y + font->Ascender();
-
-        if (alignment & ALIGN_HCENTER)
-            off_x += 0.5 * (width - box_w);
-        else if (alignment & ALIGN_RIGHT)
-            off_x += width - box_w;
-
-        if (alignment & ALIGN_VCENTER) {
-            off_y += height * 0.5 - font->LineHeight() * 0.5;
-        } else if (alignment & ALIGN_BOTTOM) {
-            off_y += font->LineHeight();
-        }
+        layout->BuildMesh(draw_text.c_str(), -1, mesh);
+        mesh_x = 0.0f;
+        mesh_y = font->Ascender();
+        return;
+    }
+
+    font->BuildMesh(draw_text.c_str(), -1, mesh);
+    FTBBox box = font->BBox(draw_text.c_str(), -1, FTPoint());
+    double box_w = box.Upper().X() - box.Lower().X();
+    // double box_h = box.Upper().Y() - box.Lower().Y();
+    double off_x = 0.0;
+    double off_y = font->Ascender();
+
+    if (alignment & ALIGN_HCENTER)
+        off_x += 0.5 * (width - box_w);
+    else if (alignment & ALIGN_RIGHT)
+        off_x += width - box_w;
+
+    if (alignment & ALIGN_VCENTER) {
+        off_y += height * 0.5 - font->LineHeight() * 0.5;
+    } else if (alignment & ALIGN_BOTTOM) {
+        off_y += font->LineHeight();
+    }
 
 #ifdef CHOWDREN_BIG_FONT_OFFY
-        if (font == big_font)
-            off_y += CHOWDREN_BIG_FONT_OFFY;
+    if (font == big_font)
+        off_y += CHOWDREN_BIG_FONT_OFFY;
 #endif
-        font->Render(draw_text.c_str(), -1, FTPoint(int(off_x), int(off_y)),
-                     FTPoint());
+    mesh_x = off_x;
+    mesh_y = off_y;
+}
+
+const FTBBox & Text::get_layout_box()
+{
+    update_draw_text();
+    if (!layout_box_set) {
+        layout_box = layout->BBox(draw_text.c_str(), text.size());
+        layout_box_set = true;
     }
+    return layout_box;
 }
 
 void Text::set_string(const std::string & value)
 {
     text = value;
     draw_text_set = false;
+    mesh.valid = false;
+    layout_box_set = false;
 }
 
 void Text::set_paragraph(unsigned int index)
@@ -162,6 +194,8 @@ void Text::set_width(int w)
         layout->SetFont(font);
     }
     layout->SetLineLength(w);
+    mesh.valid = false;
+    layout_box_set = false;
 }
 
 void Text::set_scale(float scale)
@@ -174,8 +208,7 @@ int Text::get_width()
 {
     if (layout == NULL)
         return width;
-    update_draw_text();
-    FTBBox bb = layout->BBox(draw_text.c_str(), text.size());
+    const FTBBox & bb = get_layout_box();
     return (int)(bb.Upper().X() - bb.Lower().X());
 }
 
@@ -183,8 +216,7 @@ int Text::get_height()
 {
     if (layout == NULL)
         return height;
-    update_draw_text();
-    FTBBox bb = layout->BBox(draw_text.c_str(), text.size());
+    const FTBBox & bb = get_layout_box();
     return (int)(bb.Upper().Y() - bb.Lower().Y());
 }
 
@@ -25,6 +25,15 @@ public:
     FTSimpleLayout * layout;
     float scale;
 
+    // laid out glyphs, rebuilt when the text, font, size or alignment
+    // changes
+    TextMesh mesh;
+    FTTextureFont * mesh_font;
+    int mesh_width, mesh_height, mesh_alignment;
+    float mesh_x, mesh_y;
+    FTBBox layout_box;
+    bool layout_box_set;
+
     Text(int x, int y, int type_id);
     ~Text();
     void add_line(const std::string & text);
@@ -43,6 +52,8 @@ public:
     int get_width();
     int get_height();
     void update_draw_text();
+    void update_mesh();
+    const FTBBox & get_layout_box();
 };
 
 class FontInfo
@@ -10,7 +10,8 @@
 TextBlitter::TextBlitter(int x, int y, int type_id)
 : FrameObject(x, y, type_id), flash_interval(0.0f), x_spacing(0), y_spacing(0),
   x_scroll(0), y_scroll(0), anim_type(BLITTER_ANIMATION_NONE),
-  charmap_ref(true), callback_line_count(0), draw_image(NULL)
+  charmap_ref(true), callback_line_count(0), draw_image(NULL),
+  mesh_image(NULL), mesh_tex(0)
 {
     collision = new InstanceBox(this);
 }
@@ -50,6 +51,7 @@ void TextBlitter::initialize(const std::string & map_string)
     }
 
     image->upload_texture();
+    mesh.valid = false;
 }
 
 int TextBlitter::get_x_align()
@@ -88,6 +90,7 @@ void TextBlitter::set_x_align(int value)
             alignment |= ALIGN_RIGHT;
             break;
     }
+    mesh.valid = false;
 }
 
 void TextBlitter::set_y_align(int value)
@@ -104,26 +107,31 @@ void TextBlitter::set_y_align(int value)
             alignment |= ALIGN_BOTTOM;
             break;
     }
+    mesh.valid = false;
 }
 
 void TextBlitter::set_x_spacing(int value)
 {
     x_spacing = value;
+    mesh.valid = false;
 }
 
 void TextBlitter::set_y_spacing(int value)
 {
     y_spacing = value;
+    mesh.valid = false;
 }
 
 void TextBlitter::set_x_scroll(int value)
 {
     x_scroll = value;
+    mesh.valid = false;
 }
 
 void TextBlitter::set_y_scroll(int value)
 {
     y_scroll = value;
+    mesh.valid = false;
 }
 
 void TextBlitter::set_width(int w)
@@ -139,6 +147,7 @@ void TextBlitter::set_height(int h)
 {
     height = h;
     collision->update_aabb();
+    mesh.valid = false;
 }
 
 void TextBlitter::set_text(const std::string & value)
@@ -158,6 +167,7 @@ void TextBlitter::append_text(const std::string & value)
 void TextBlitter::update_lines()
 {
     lines.clear();
+    mesh.valid = false;
 
     if (text.empty()) {
         lines.push_back(LineReference(NULL, 0));
@@ -338,8 +348,32 @@ void TextBlitter::draw()
         draw_image->upload_texture();
     }
 
+    // effects expect the image to fill its texture
+    if (effect != Render::NONE) {
+        image->set_standalone();
+        image->upload_texture();
+    }
+
     begin_draw();
 
+    if (anim_type == BLITTER_ANIMATION_SINWAVE || has_callback) {
+        draw_lines(image, false);
+    } else {
+        if (!mesh.valid || mesh_image != image || mesh_tex != image->tex) {
+            mesh_image = image;
+            mesh_tex = image->tex;
+            mesh.clear();
+            draw_lines(image, true);
+            mesh.valid = true;
+        }
+        mesh.draw(x, y, blend_color);
+    }
+
+    end_draw();
+}
+
+void TextBlitter::draw_lines(Image * image, bool build)
+{
     int x_add = char_width + x_spacing;
     int y_add = char_height + y_spacing;
 
@@ -372,14 +406,24 @@ void TextBlitter::draw()
             c -= char_offset;
             int ci = charmap[c];
             int img_x = (ci * char_width) % image_width;
-            img_x = clamp(img_x + x_off, 0, image->width);
+            img_x = clamp(img_x + x_off, 0, int(image->width));
             int img_y = ((ci * char_width) / image_width) * char_height;
-            img_y = clamp(img_y + y_off, 0, image->height);
-
-            float t_x1 = float(img_x) / float(image->width);
-            float t_x2 = float(img_x+char_width) / float(image->width);
-            float t_y1 = float(img_y) / float(image->height);
-            float t_y2 = float(img_y+char_height) / float(image->height);
+            img_y = clamp(img_y + y_off, 0, int(image->height));
+
+            float t_x1 = image->get_tex_x(float(img_x) / image->width);
+            float t_x2 = image->get_tex_x(float(img_x+char_width) /
+                                          image->width);
+            float t_y1 = image->get_tex_y(float(img_y) / image->height);
+            float t_y2 = image->get_tex_y(float(img_y+char_height) /
+                                          image->height);
+
+            if (build) {
+                // relative to the object, so the mesh can move with it
+                mesh.add(image->tex, xx - x, yy - y, xx - x + char_width,
+                         yy - y + char_height, t_x1, t_y1, t_x2, t_y2);
+                xx += x_add;
+                continue;
+            }
 
             Color color = blend_color;
             int yyy = yy;
@@ -404,8 +448,6 @@ void TextBlitter::draw()
 
         yy += y_add;
     }
-
-    end_draw();
 }
 
 class DefaultBlitter : public TextBlitter
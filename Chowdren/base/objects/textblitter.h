@@ -6,6 +6,7 @@
 #include <string>
 #include "color.h"
 #include "image.h"
+#include "font.h"
 
 enum BlitterAnimation
 {
@@ -62,6 +63,11 @@ public:
     Image * draw_image;
     ReplacedImages replacer;
 
+    // character quads for text without animation or callbacks
+    TextMesh mesh;
+    Image * mesh_image;
+    Texture mesh_tex;
+
     TextBlitter(int x, int y, int type_id);
     ~TextBlitter();
     void initialize(const std::string & charmap);
@@ -80,6 +86,7 @@ public:
     void set_width(int width);
     void set_height(int height);
     void draw();
+    void draw_lines(Image * image, bool build);
     void update();
     void flash(float value);
     std::string get_line(int index);
@@ -1,8 +1,155 @@
 #include "frameobject.h"
 #include "bitarray.h"
+#include <algorithm>
 
 // XXX move this into gencol.py
 
+// the AABB that FrameObject::overlaps uses when obj is the other object
+static inline int * get_overlap_aabb(FrameObject * obj);
+
+// Candidate pairs for the list vs list overlap tests. The instances of one
+// side are sorted by their left edge, so only instances whose AABB overlaps
+// are passed to the narrow phase. The AABB test is the same one
+// collide_direct starts with, and candidates are returned in the order they
+// were added, so selection, saved collisions and collision_flags behave
+// exactly like the full N*M loop.
+
+#define OVERLAP_SWEEP_MIN 8
+
+struct OverlapEntry
+{
+    FrameObject * obj;
+    int aabb[4];
+    int order;
+    int index;
+};
+
+inline bool sort_overlap_x(const OverlapEntry & a, const OverlapEntry & b)
+{
+    return a.aabb[0] < b.aabb[0];
+}
+
+inline bool sort_overlap_order(OverlapEntry * a, OverlapEntry * b)
+{
+    return a->order < b->order;
+}
+
+class OverlapCandidates
+{
+public:
+    vector<OverlapEntry> entries;
+    vector<OverlapEntry*> found;
+    int max_width;
+
+    void clear()
+    {
+        entries.clear();
+        max_width = 0;
+    }
+
+    void add(FrameObject * obj, int index, int * aabb)
+    {
+        OverlapEntry entry;
+        entry.obj = obj;
+        entry.aabb[0] = aabb[0];
+        entry.aabb[1] = aabb[1];
+        entry.aabb[2] = aabb[2];
+        entry.aabb[3] = aabb[3];
+        entry.order = entries.size();
+        entry.index = index;
+        max_width = std::max(max_width, aabb[2] - aabb[0]);
+        entries.push_back(entry);
+    }
+
+    // adds the selected instances of list. the entries are tested as the
+    // first argument of overlaps() if 'first' is set, otherwise as the other
+    // object. instances without collision are deselected
+    void add_selection(ObjectList & list, int offset, bool first)
+    {
+        for (ObjectIterator it(list); !it.end(); ++it) {
+            FrameObject * obj = *it;
+            if (obj->collision == NULL) {
+                it.deselect();
+                continue;
+            }
+            int * aabb;
+            if (first)
+                aabb = obj->collision->aabb;
+            else
+                aabb = get_overlap_aabb(obj);
+            add(obj, offset + it.index - 1, aabb);
+        }
+    }
+
+    // adds all instances of list, tested as the other object
+    void add_all(ObjectList & list, int offset)
+    {
+        ObjectList::iterator it;
+        int index = offset;
+        for (it = list.begin(); it != list.end(); ++it, ++index) {
+            FrameObject * obj = it->obj;
+            if (obj->collision == NULL)
+                continue;
+            add(obj, index, get_overlap_aabb(obj));
+        }
+    }
+
+    void sort()
+    {
+        std::sort(entries.begin(), entries.end(), sort_overlap_x);
+    }
+
+    // fills 'found' with the entries that overlap aabb, in the order they
+    // were added
+    void query(int * aabb)
+    {
+        found.clear();
+
+        // entries can only overlap if they start after aabb[0] - max_width
+        int x = aabb[0] - max_width;
+        int lo = 0;
+        int hi = entries.size();
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (entries[mid].aabb[0] < x)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        for (int i = lo; i < int(entries.size()); i++) {
+            OverlapEntry & entry = entries[i];
+            if (entry.aabb[0] >= aabb[2])
+                break;
+            if (!collides(entry.aabb, aabb))
+                continue;
+            found.push_back(&entry);
+        }
+
+        std::sort(found.begin(), found.end(), sort_overlap_order);
+    }
+};
+
+static OverlapCandidates overlap_candidates;
+
+inline bool has_list(QualifierList & list, ObjectList * other)
+{
+    for (int i = 0; i < list.count; i++) {
+        if (list.items[i] == other)
+            return true;
+    }
+    return false;
+}
+
+inline bool has_list(QualifierList & list1, QualifierList & list2)
+{
+    for (int i = 0; i < list1.count; i++) {
+        if (has_list(list2, list1.items[i]))
+            return true;
+    }
+    return false;
+}
+
 // FrameObject vs FrameObject
 
 template <bool save>
@@ -30,6 +177,12 @@ inline bool overlap_impl(ObjectList & list1, ObjectList & list2)
 
     StackBitArray temp = CREATE_BITARRAY_ZERO(size);
 
+    // when both sides are the same list, deselecting from list1 changes
+    // what the inner loop sees, so only use candidates for distinct lists
+    OverlapCandidates & candidates = overlap_candidates;
+    bool use_candidates = &list1 != &list2 && size >= OVERLAP_SWEEP_MIN;
+    bool has_candidates = false;
+
     bool ret = false;
     for (ObjectIterator it1(list1); !it1.end(); ++it1) {
         FrameObject * instance = *it1;
@@ -39,16 +192,35 @@ inline bool overlap_impl(ObjectList & list1, ObjectList & list2)
             continue;
         }
         bool added = false;
-        for (ObjectIterator it2(list2); !it2.end(); ++it2) {
-            FrameObject * other = *it2;
-            if (other->collision == NULL) {
-                it2.deselect();
-                continue;
+        if (use_candidates) {
+            if (!has_candidates) {
+                candidates.clear();
+                candidates.add_selection(list2, 0, false);
+                candidates.sort();
+                has_candidates = true;
+            }
+            candidates.query(col->aabb);
+            vector<OverlapEntry*>::const_iterator it2;
+            for (it2 = candidates.found.begin();
+                 it2 != candidates.found.end(); ++it2) {
+                OverlapEntry * entry = *it2;
+                if (!overlap_impl<save>(instance, entry->obj))
+                    continue;
+                temp.set(entry->index);
+                added = ret = true;
+            }
+        } else {
+            for (ObjectIterator it2(list2); !it2.end(); ++it2) {
+                FrameObject * other = *it2;
+                if (other->collision == NULL) {
+                    it2.deselect();
+                    continue;
+                }
+                if (!overlap_impl<save>(instance, other))
+                    continue;
+                temp.set(it2.index-1);
+                added = ret = true;
             }
-            if (!overlap_impl<save>(instance, other))
-                continue;
-            temp.set(it2.index-1);
-            added = ret = true;
         }
         if (!added)
             it1.deselect();
@@ -133,6 +305,11 @@ inline bool overlap_impl(QualifierList & list1, ObjectList & list2)
         return false;
     StackBitArray temp = CREATE_BITARRAY_ZERO(size);
 
+    OverlapCandidates & candidates = overlap_candidates;
+    bool use_candidates = !has_list(list1, &list2) &&
+                          size >= OVERLAP_SWEEP_MIN;
+    bool has_candidates = false;
+
     bool ret = false;
     for (ObjectIterator it1(list2); !it1.end(); ++it1) {
         FrameObject * instance = *it1;
@@ -141,21 +318,45 @@ inline bool overlap_impl(QualifierList & list1, ObjectList & list2)
             continue;
         }
         bool added = false;
-        int temp_offset = 0;
-        for (int i = 0; i < list1.count; i++) {
-            ObjectList & list = *list1.items[i];
-            for (ObjectIterator it2(list); !it2.end(); ++it2) {
-                FrameObject * other = *it2;
-                if (other->collision == NULL) {
-                    it2.deselect();
-                    continue;
+        if (use_candidates) {
+            if (!has_candidates) {
+                candidates.clear();
+                int temp_offset = 0;
+                for (int i = 0; i < list1.count; i++) {
+                    ObjectList & list = *list1.items[i];
+                    candidates.add_selection(list, temp_offset, true);
+                    temp_offset += list.size();
                 }
-                if (!overlap_impl<save>(other, instance))
+                candidates.sort();
+                has_candidates = true;
+            }
+            candidates.query(get_overlap_aabb(instance));
+            vector<OverlapEntry*>::const_iterator it2;
+            for (it2 = candidates.found.begin();
+                 it2 != candidates.found.end(); ++it2) {
+                OverlapEntry * entry = *it2;
+                if (!overlap_impl<save>(entry->obj, instance))
                     continue;
                 added = ret = true;
-                temp.set(temp_offset + it2.index - 1);
+                temp.set(entry->index);
+            }
+        } else {
+            int temp_offset = 0;
+            for (int i = 0; i < list1.count; i++) {
+                ObjectList & list = *list1.items[i];
+                for (ObjectIterator it2(list); !it2.end(); ++it2) {
+                    FrameObject * other = *it2;
+                    if (other->collision == NULL) {
+                        it2.deselect();
+                        continue;
+                    }
+                    if (!overlap_impl<save>(other, instance))
+                        continue;
+                    added = ret = true;
+                    temp.set(temp_offset + it2.index - 1);
+                }
+                temp_offset += list.size();
             }
-            temp_offset += list.size();
         }
         if (!added)
             it1.deselect();
@@ -185,6 +386,11 @@ inline bool overlap_impl(ObjectList & list1, QualifierList & list2)
         return false;
     StackBitArray temp = CREATE_BITARRAY_ZERO(size);
 
+    OverlapCandidates & candidates = overlap_candidates;
+    bool use_candidates = !has_list(list2, &list1) &&
+                          size >= OVERLAP_SWEEP_MIN;
+    bool has_candidates = false;
+
     bool ret = false;
     for (ObjectIterator it1(list1); !it1.end(); ++it1) {
         FrameObject * instance = *it1;
@@ -193,21 +399,45 @@ inline bool overlap_impl(ObjectList & list1, QualifierList & list2)
             continue;
         }
         bool added = false;
-        int temp_offset = 0;
-        for (int i = 0; i < list2.count; i++) {
-            ObjectList & list = *list2.items[i];
-            for (ObjectIterator it2(list); !it2.end(); ++it2) {
-                FrameObject * other = *it2;
-                if (other->collision == NULL) {
-                    it2.deselect();
-                    continue;
+        if (use_candidates) {
+            if (!has_candidates) {
+                candidates.clear();
+                int temp_offset = 0;
+                for (int i = 0; i < list2.count; i++) {
+                    ObjectList & list = *list2.items[i];
+                    candidates.add_selection(list, temp_offset, false);
+                    temp_offset += list.size();
                 }
-                if (!overlap_impl<save>(instance, other))
+                candidates.sort();
+                has_candidates = true;
+            }
+            candidates.query(instance->collision->aabb);
+            vector<OverlapEntry*>::const_iterator it2;
+            for (it2 = candidates.found.begin();
+                 it2 != candidates.found.end(); ++it2) {
+                OverlapEntry * entry = *it2;
+                if (!overlap_impl<save>(instance, entry->obj))
                     continue;
                 added = ret = true;
-                temp.set(temp_offset + it2.index - 1);
+                temp.set(entry->index);
+            }
+        } else {
+            int temp_offset = 0;
+            for (int i = 0; i < list2.count; i++) {
+                ObjectList & list = *list2.items[i];
+                for (ObjectIterator it2(list); !it2.end(); ++it2) {
+                    FrameObject * other = *it2;
+                    if (other->collision == NULL) {
+                        it2.deselect();
+                        continue;
+                    }
+                    if (!overlap_impl<save>(instance, other))
+                        continue;
+                    added = ret = true;
+                    temp.set(temp_offset + it2.index - 1);
+                }
+                temp_offset += list.size();
             }
-            temp_offset += list.size();
         }
         if (!added)
             it1.deselect();
@@ -303,6 +533,11 @@ inline bool overlap_impl(QualifierList & list1, QualifierList & list2)
         return false;
     StackBitArray temp = CREATE_BITARRAY_ZERO(size);
 
+    OverlapCandidates & candidates = overlap_candidates;
+    bool use_candidates = !has_list(list1, list2) &&
+                          size >= OVERLAP_SWEEP_MIN;
+    bool has_candidates = false;
+
     bool ret = false;
     for (QualifierIterator it1(list2); !it1.end(); ++it1) {
         FrameObject * instance = *it1;
@@ -312,21 +547,45 @@ inline bool overlap_impl(QualifierList & list1, QualifierList & list2)
         }
         bool added = false;
 
-        int temp_offset = 0;
-        for (int i = 0; i < list1.count; i++) {
-            ObjectList & list = *list1.items[i];
-            for (ObjectIterator it2(list); !it2.end(); ++it2) {
-                FrameObject * other = *it2;
-                if (other->collision == NULL) {
-                    it2.deselect();
-                    continue;
+        if (use_candidates) {
+            if (!has_candidates) {
+                candidates.clear();
+                int temp_offset = 0;
+                for (int i = 0; i < list1.count; i++) {
+                    ObjectList & list = *list1.items[i];
+                    candidates.add_selection(list, temp_offset, true);
+                    temp_offset += list.size();
                 }
-                if (!overlap_impl<save>(other, instance))
+                candidates.sort();
+                has_candidates = true;
+            }
+            candidates.query(get_overlap_aabb(instance));
+            vector<OverlapEntry*>::const_iterator it2;
+            for (it2 = candidates.found.begin();
+                 it2 != candidates.found.end(); ++it2) {
+                OverlapEntry * entry = *it2;
+                if (!overlap_impl<save>(entry->obj, instance))
                     continue;
                 added = ret = true;
-                temp.set(temp_offset + it2.index - 1);
+                temp.set(entry->index);
+            }
+        } else {
+            int temp_offset = 0;
+            for (int i = 0; i < list1.count; i++) {
+                ObjectList & list = *list1.items[i];
+                for (ObjectIterator it2(list); !it2.end(); ++it2) {
+                    FrameObject * other = *it2;
+                    if (other->collision == NULL) {
+                        it2.deselect();
+                        continue;
+                    }
+                    if (!overlap_impl<save>(other, instance))
+                        continue;
+                    added = ret = true;
+                    temp.set(temp_offset + it2.index - 1);
+                }
+                temp_offset += list.size();
             }
-            temp_offset += list.size();
         }
         if (!added)
             it1.deselect();
@@ -566,29 +825,32 @@ public:
         (this->*e)();\
     }
 
-void Frame::test_collisions(ObjectList & a, ObjectList & b,
-                            int flag1, int flag2, EventFunction e)
-{
-    StackBitArray temp = CREATE_BITARRAY_ZERO(b.size());
-    ObjectPairs pairs;
+// collision events. the second list does not change while testing, so the
+// candidates are always used
 
-    ObjectList::iterator it1, it2;
-    int index;
-    for (it1 = a.begin(); it1 != a.end(); ++it1) {
-        FrameObject * col_instance_1 = it1->obj;
+template <bool save>
+inline void test_collision_candidates(FrameObject * col_instance_1,
+                                      BaseBitArray & temp, ObjectPairs & pairs,
+                                      int flag1, int flag2)
+{
 #ifndef CHOWDREN_REPEATED_COLLISIONS
-        bool has_col = false;
-        index = 0;
+    bool has_col = false;
 #endif
-        for (it2 = b.begin(); it2 != b.end(); ++it2, ++index) {
-            FrameObject * col_instance_2 = it2->obj;
+    if (col_instance_1->collision != NULL) {
+        OverlapCandidates & candidates = overlap_candidates;
+        candidates.query(col_instance_1->collision->aabb);
+        vector<OverlapEntry*>::const_iterator it;
+        for (it = candidates.found.begin(); it != candidates.found.end();
+             ++it) {
+            OverlapEntry * entry = *it;
+            FrameObject * col_instance_2 = entry->obj;
             if (col_instance_1 == col_instance_2)
                 continue;
-            if (!check_overlap(col_instance_1, col_instance_2))
+            if (!overlap_impl<save>(col_instance_1, col_instance_2))
                 continue;
 #ifndef CHOWDREN_REPEATED_COLLISIONS
             has_col = true;
-            temp.set(index);
+            temp.set(entry->index);
             if ((col_instance_1->collision_flags & flag1) &&
                 (col_instance_2->collision_flags & flag2))
                 continue;
@@ -597,19 +859,34 @@ void Frame::test_collisions(ObjectList & a, ObjectList & b,
 #endif
             pairs.add(col_instance_1, col_instance_2);
         }
+    }
 
 #ifndef CHOWDREN_REPEATED_COLLISIONS
-        if (!has_col)
-            col_instance_1->collision_flags &= ~flag1;
+    if (!has_col)
+        col_instance_1->collision_flags &= ~flag1;
 #endif
-    }
+}
+
+void Frame::test_collisions(ObjectList & a, ObjectList & b,
+                            int flag1, int flag2, EventFunction e)
+{
+    StackBitArray temp = CREATE_BITARRAY_ZERO(b.size());
+    ObjectPairs pairs;
+
+    overlap_candidates.clear();
+    overlap_candidates.add_all(b, 0);
+    overlap_candidates.sort();
+
+    ObjectList::iterator it;
+    for (it = a.begin(); it != a.end(); ++it)
+        test_collision_candidates<false>(it->obj, temp, pairs, flag1, flag2);
 
 #ifndef CHOWDREN_REPEATED_COLLISIONS
-    index = 0;
-    for (it2 = b.begin(); it2 != b.end(); ++it2, ++index) {
+    int index = 0;
+    for (it = b.begin(); it != b.end(); ++it, ++index) {
         if (temp.get(index))
             continue;
-        it2->obj->collision_flags &= ~flag2;
+        it->obj->collision_flags &= ~flag2;
     }
 #endif
 
@@ -622,44 +899,20 @@ void Frame::test_collisions_save(ObjectList & a, ObjectList & b,
     StackBitArray temp = CREATE_BITARRAY_ZERO(b.size());
     ObjectPairs pairs;
 
-    ObjectList::iterator it1, it2;
-    int index;
-    for (it1 = a.begin(); it1 != a.end(); ++it1) {
-        FrameObject * col_instance_1 = it1->obj;
-#ifndef CHOWDREN_REPEATED_COLLISIONS
-        bool has_col = false;
-        index = 0;
-#endif
-        for (it2 = b.begin(); it2 != b.end(); ++it2, ++index) {
-            FrameObject * col_instance_2 = it2->obj;
-            if (col_instance_1 == col_instance_2)
-                continue;
-            if (!check_overlap_save(col_instance_1, col_instance_2))
-                continue;
-#ifndef CHOWDREN_REPEATED_COLLISIONS
-            has_col = true;
-            temp.set(index);
-            if ((col_instance_1->collision_flags & flag1) &&
-                (col_instance_2->collision_flags & flag2))
-                continue;
-            col_instance_1->collision_flags |= flag1;
-            col_instance_2->collision_flags |= flag2;
-#endif
-            pairs.add(col_instance_1, col_instance_2);
-        }
+    overlap_candidates.clear();
+    overlap_candidates.add_all(b, 0);
+    overlap_candidates.sort();
 
-#ifndef CHOWDREN_REPEATED_COLLISIONS
-        if (!has_col)
-            col_instance_1->collision_flags &= ~flag1;
-#endif
-    }
+    ObjectList::iterator it;
+    for (it = a.begin(); it != a.end(); ++it)
+        test_collision_candidates<true>(it->obj, temp, pairs, flag1, flag2);
 
 #ifndef CHOWDREN_REPEATED_COLLISIONS
-    index = 0;
-    for (it2 = b.begin(); it2 != b.end(); ++it2, ++index) {
+    int index = 0;
+    for (it = b.begin(); it != b.end(); ++it, ++index) {
         if (temp.get(index))
             continue;
-        it2->obj->collision_flags &= ~flag2;
+        it->obj->collision_flags &= ~flag2;
     }
 #endif
 
@@ -672,45 +925,21 @@ void Frame::test_collisions(QualifierList & a, ObjectList & b,
     StackBitArray temp = CREATE_BITARRAY_ZERO(b.size());
     ObjectPairs pairs;
 
-    ObjectList::iterator it1, it2;
-    int index;
-    for (int i = 0; i < a.count; ++i)
-    for (it1 = a.items[i]->begin(); it1 != a.items[i]->end(); ++it1) {
-        FrameObject * col_instance_1 = it1->obj;
-#ifndef CHOWDREN_REPEATED_COLLISIONS
-        bool has_col = false;
-        index = 0;
-#endif
-        for (it2 = b.begin(); it2 != b.end(); ++it2, ++index) {
-            FrameObject * col_instance_2 = it2->obj;
-            if (col_instance_1 == col_instance_2)
-                continue;
-            if (!check_overlap(col_instance_1, col_instance_2))
-                continue;
-#ifndef CHOWDREN_REPEATED_COLLISIONS
-            has_col = true;
-            temp.set(index);
-            if ((col_instance_1->collision_flags & flag1) &&
-                (col_instance_2->collision_flags & flag2))
-                continue;
-            col_instance_1->collision_flags |= flag1;
-            col_instance_2->collision_flags |= flag2;
-#endif
-            pairs.add(col_instance_1, col_instance_2);
-        }
+    overlap_candidates.clear();
+    overlap_candidates.add_all(b, 0);
+    overlap_candidates.sort();
 
-#ifndef CHOWDREN_REPEATED_COLLISIONS
-        if (!has_col)
-            col_instance_1->collision_flags &= ~flag1;
-#endif
-    }
+    ObjectList::iterator it;
+    for (int i = 0; i < a.count; ++i)
+    for (it = a.items[i]->begin(); it != a.items[i]->end(); ++it)
+        test_collision_candidates<false>(it->obj, temp, pairs, flag1, flag2);
 
 #ifndef CHOWDREN_REPEATED_COLLISIONS
-    index = 0;
-    for (it2 = b.begin(); it2 != b.end(); ++it2, ++index) {
+    int index = 0;
+    for (it = b.begin(); it != b.end(); ++it, ++index) {
         if (temp.get(index))
             continue;
-        it2->obj->collision_flags &= ~flag2;
+        it->obj->collision_flags &= ~flag2;
     }
 #endif
 
@@ -723,45 +952,21 @@ void Frame::test_collisions_save(QualifierList & a, ObjectList & b,
     StackBitArray temp = CREATE_BITARRAY_ZERO(b.size());
     ObjectPairs pairs;
 
-    ObjectList::iterator it1, it2;
-    int index;
-    for (int i = 0; i < a.count; ++i)
-    for (it1 = a.items[i]->begin(); it1 != a.items[i]->end(); ++it1) {
-        FrameObject * col_instance_1 = it1->obj;
-#ifndef CHOWDREN_REPEATED_COLLISIONS
-        bool has_col = false;
-        index = 0;
-#endif
-        for (it2 = b.begin(); it2 != b.end(); ++it2, ++index) {
-            FrameObject * col_instance_2 = it2->obj;
-            if (col_instance_1 == col_instance_2)
-                continue;
-            if (!check_overlap_save(col_instance_1, col_instance_2))
-                continue;
-#ifndef CHOWDREN_REPEATED_COLLISIONS
-            has_col = true;
-            temp.set(index);
-            if ((col_instance_1->collision_flags & flag1) &&
-                (col_instance_2->collision_flags & flag2))
-                continue;
-            col_instance_1->collision_flags |= flag1;
-            col_instance_2->collision_flags |= flag2;
-#endif
-            pairs.add(col_instance_1, col_instance_2);
-        }
+    overlap_candidates.clear();
+    overlap_candidates.add_all(b, 0);
+    overlap_candidates.sort();
 
-#ifndef CHOWDREN_REPEATED_COLLISIONS
-        if (!has_col)
-            col_instance_1->collision_flags &= ~flag1;
-#endif
-    }
+    ObjectList::iterator it;
+    for (int i = 0; i < a.count; ++i)
+    for (it = a.items[i]->begin(); it != a.items[i]->end(); ++it)
+        test_collision_candidates<true>(it->obj, temp, pairs, flag1, flag2);
 
 #ifndef CHOWDREN_REPEATED_COLLISIONS
-    index = 0;
-    for (it2 = b.begin(); it2 != b.end(); ++it2, ++index) {
+    int index = 0;
+    for (it = b.begin(); it != b.end(); ++it, ++index) {
         if (temp.get(index))
             continue;
-        it2->obj->collision_flags &= ~flag2;
+        it->obj->collision_flags &= ~flag2;
     }
 #endif
 
@@ -774,49 +979,26 @@ void Frame::test_collisions(QualifierList & a, QualifierList & b,
     StackBitArray temp = CREATE_BITARRAY_ZERO(b.size());
     ObjectPairs pairs;
 
-    ObjectList::iterator it1, it2;
-    int index;
-    for (int i = 0; i < a.count; ++i)
-    for (it1 = a.items[i]->begin(); it1 != a.items[i]->end(); ++it1) {
-        FrameObject * col_instance_1 = it1->obj;
-#ifndef CHOWDREN_REPEATED_COLLISIONS
-        bool has_col = false;
-        index = 0;
-#endif
-        for (int ii = 0; ii < b.count; ++ii)
-        for (it2 = b.items[ii]->begin(); it2 != b.items[ii]->end(); ++it2,
-                                                                    ++index)
-        {
-            FrameObject * col_instance_2 = it2->obj;
-            if (col_instance_1 == col_instance_2)
-                continue;
-            if (!check_overlap(col_instance_1, col_instance_2))
-                continue;
-#ifndef CHOWDREN_REPEATED_COLLISIONS
-            has_col = true;
-            temp.set(index);
-            if ((col_instance_1->collision_flags & flag1) &&
-                (col_instance_2->collision_flags & flag2))
-                continue;
-            col_instance_1->collision_flags |= flag1;
-            col_instance_2->collision_flags |= flag2;
-#endif
-            pairs.add(col_instance_1, col_instance_2);
-        }
-
-#ifndef CHOWDREN_REPEATED_COLLISIONS
-        if (!has_col)
-            col_instance_1->collision_flags &= ~flag1;
-#endif
+    overlap_candidates.clear();
+    int offset = 0;
+    for (int i = 0; i < b.count; ++i) {
+        overlap_candidates.add_all(*b.items[i], offset);
+        offset += b.items[i]->size();
     }
+    overlap_candidates.sort();
+
+    ObjectList::iterator it;
+    for (int i = 0; i < a.count; ++i)
+    for (it = a.items[i]->begin(); it != a.items[i]->end(); ++it)
+        test_collision_candidates<false>(it->obj, temp, pairs, flag1, flag2);
 
 #ifndef CHOWDREN_REPEATED_COLLISIONS
-    index = 0;
+    int index = 0;
     for (int i = 0; i < b.count; ++i)
-    for (it2 = b.items[i]->begin(); it2 != b.items[i]->end(); ++it2, ++index) {
+    for (it = b.items[i]->begin(); it != b.items[i]->end(); ++it, ++index) {
         if (temp.get(index))
             continue;
-        it2->obj->collision_flags &= ~flag2;
+        it->obj->collision_flags &= ~flag2;
     }
 #endif
 
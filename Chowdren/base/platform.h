@@ -31,6 +31,8 @@ void platform_begin_draw();
 void platform_swap_buffers();
 void platform_prepare_frame_change();
 bool platform_remove_file(const std::string & path);
+// replaces dst if it exists
+bool platform_rename_file(const std::string & src, const std::string & dst);
 const std::string & platform_get_appdata_dir();
 const std::string & platform_get_language();
 void platform_set_vsync(bool value);
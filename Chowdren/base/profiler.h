@@ -2,9 +2,16 @@
 #define CHOWDREN_PROFILER_H
 
 #include "chowconfig.h"
+#include "trace.h"
 
 #ifdef CHOWDREN_USE_PROFILER
 #include "profiler/Shiny.h"
+#elif defined(CHOWDREN_USE_TRACE)
+// the existing profile points become trace zones
+#define PROFILE_BLOCK(x) TRACE_ZONE(#x)
+#define PROFILE_FUNC() TRACE_ZONE(__FUNCTION__)
+#define PROFILE_BEGIN(x) TRACE_BEGIN(#x)
+#define PROFILE_END() TRACE_END()
 #else
 #define PROFILE_BLOCK(x)
 #define PROFILE_FUNC()
@@ -1,3 +1,4 @@
 #include "renderplatform.cpp"
 
-int Render::offset[2];
\ No newline at end of file
+int Render::offset[2];
+RenderStats Render::stats;
\ No newline at end of file
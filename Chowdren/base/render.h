@@ -7,6 +7,8 @@ typedef unsigned int Texture;
 
 class FrameObject;
 
+struct RenderStats;
+
 class Render
 {
 public:
@@ -49,12 +51,35 @@ public:
         LAYERCOLOR,
         PERSPECTIVE,
         PIXELSCALE,
-        FONT
+        FONT,
+        // draws into a premultiplied alpha target
+        PREMULTIPLY,
+        // draws premultiplied alpha content
+        PREMULTIPLIED
+    };
+
+    // reasons for submitting the pending quad batch
+    enum FlushReason
+    {
+        FLUSH_TEXTURE = 0,
+        FLUSH_EFFECT,
+        FLUSH_BLEND,
+        FLUSH_SCISSOR,
+        FLUSH_VIEW,
+        FLUSH_FULL,
+        FLUSH_TARGET,
+        FLUSH_READBACK,
+        FLUSH_CLEAR,
+        FLUSH_FRAME_END,
+        FLUSH_EXTERNAL,
+        FLUSH_REASON_MAX
     };
 
     static int offset[2];
+    static RenderStats stats;
 
     static void init();
+    static void flush(int reason);
 
     static void set_view(int x, int y, int w, int h);
     static void set_offset(int x1, int y1);
@@ -69,6 +94,8 @@ public:
     static void draw_tex(int x1, int y1, int x2, int y2, Color color,
                          Texture tex);
     static void draw_tex(float * p, Color color, Texture tex);
+    static void draw_tex(float * p, Color color, Texture tex,
+                         float tx1, float ty1, float tx2, float ty2);
     static void draw_tex(int x1, int y1, int x2, int y2, Color color,
                          Texture tex,
                          float tx1, float ty1, float tx2, float ty2);
@@ -92,6 +119,11 @@ public:
 
     static Texture copy_rect(int x1, int y1, int x2, int y2);
 
+    // wrap direct GL calls, so the pending batch is submitted first and the
+    // cached texture/shader/blend state is applied again afterwards
+    static void begin_external();
+    static void end_external();
+
     enum Format
     {
         RGBA,
@@ -100,6 +132,8 @@ public:
 
     // textures
     static Texture create_tex(void * pixels, Format f, int width, int height);
+    static void update_tex(Texture tex, void * pixels, Format f,
+                           int x, int y, int width, int height);
     static void delete_tex(Texture tex);
     static void set_filter(Texture tex, bool linear);
 
@@ -109,6 +143,50 @@ public:
 #endif
 };
 
+struct RenderStats
+{
+    // quads submitted through the Render interface
+    int quads;
+    // actual draw calls issued to the driver
+    int draw_calls;
+    int flushes[Render::FLUSH_REASON_MAX];
+
+    void reset()
+    {
+        quads = draw_calls = 0;
+        for (int i = 0; i < Render::FLUSH_REASON_MAX; i++)
+            flushes[i] = 0;
+    }
+
+    static const char * get_reason_name(int reason)
+    {
+        switch (reason) {
+            case Render::FLUSH_TEXTURE:
+                return "texture";
+            case Render::FLUSH_EFFECT:
+                return "effect";
+            case Render::FLUSH_BLEND:
+                return "blend";
+            case Render::FLUSH_SCISSOR:
+                return "scissor";
+            case Render::FLUSH_VIEW:
+                return "view";
+            case Render::FLUSH_FULL:
+                return "full";
+            case Render::FLUSH_TARGET:
+                return "target";
+            case Render::FLUSH_READBACK:
+                return "readback";
+            case Render::FLUSH_CLEAR:
+                return "clear";
+            case Render::FLUSH_FRAME_END:
+                return "frame end";
+            default:
+                return "external";
+        }
+    }
+};
+
 #include "renderplatform.h"
 
 #endif // CHOWDREN_RENDER_H
\ No newline at end of file
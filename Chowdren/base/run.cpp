@@ -25,6 +25,11 @@ GameManager manager;
 #include "crossrand.h"
 #include "media.h"
 #include "crashdump.cpp"
+#include "jobs.h"
+
+#ifdef CHOWDREN_AUTOSAVE_ON_CHANGE
+#include "objects/ini.h"
+#endif
 
 #if defined(CHOWDREN_IS_DESKTOP)
 #include "SDL.h"
@@ -42,7 +47,8 @@ GameManager manager;
 GameManager::GameManager()
 : frame(NULL), window_created(false), fullscreen(false), off_x(0), off_y(0),
   x_size(WINDOW_WIDTH), y_size(WINDOW_HEIGHT), values(NULL), strings(NULL),
-  fade_value(0.0f), fade_dir(0.0f), lives(0), ignore_controls(false),
+  fade_value(0.0f), fade_dir(0.0f), prefetch_frame(-1), lives(0),
+  ignore_controls(false),
   player_press_flags(0), player_flags(0), joystick_press_flags(0),
   joystick_release_flags(0), joystick_flags(0), player_died(true)
 {
@@ -76,8 +82,13 @@ void GameManager::init()
     }
 #endif
 
+#ifdef CHOWDREN_USE_TRACE
+    Trace::init();
+#endif
+
     platform_init();
     media.init();
+    Jobs::init();
     set_window(false);
 
     // application setup
@@ -104,6 +115,15 @@ void GameManager::init()
     start_frame = 0;
 #endif
 
+#ifdef CHOWDREN_BENCHMARK
+    if (Benchmark::enabled) {
+        cross_srand(0);
+        Benchmark::init(*this);
+        set_frame(Benchmark::frame_index);
+        return;
+    }
+#endif
+
 #ifdef NDEBUG
     set_frame(0);
 #else
@@ -177,6 +197,11 @@ void GameManager::on_key(int key, bool state)
 
     if (state)
         frame->last_key = key;
+
+#ifdef CHOWDREN_BENCHMARK
+    if (Benchmark::recording)
+        Benchmark::record_input(false, key, state);
+#endif
 }
 
 void GameManager::on_mouse(int key, bool state)
@@ -185,6 +210,11 @@ void GameManager::on_mouse(int key, bool state)
         mouse.add(key);
     else
         mouse.remove(key);
+
+#ifdef CHOWDREN_BENCHMARK
+    if (Benchmark::recording)
+        Benchmark::record_input(true, key, state);
+#endif
 }
 
 int GameManager::update_frame()
@@ -199,6 +229,12 @@ int GameManager::update_frame()
         std::cout << "Bad frame: " << dt << " " << (1.0 / dt) << std::endl;
 #endif
 
+    // decode the images of the next frame while the current one fades out
+    if (frame->next_frame >= 0 && frame->next_frame != prefetch_frame) {
+        prefetch_frame = frame->next_frame;
+        frame->prefetch_images(prefetch_frame);
+    }
+
     if (fade_dir != 0.0f) {
         fade_value += fade_dir * (float)dt;
         if (fade_value <= 0.0f || fade_value >= 1.0f) {
@@ -274,6 +310,8 @@ void GameManager::draw()
 
     PROFILE_FUNC();
 
+    Render::stats.reset();
+
     PROFILE_BEGIN(platform_begin_draw);
     platform_begin_draw();
     PROFILE_END();
@@ -335,13 +373,24 @@ void GameManager::draw()
         std::string date(__DATE__);
         std::string tim(__TIME__);
         std::string val = date + " " + tim;
+        Render::begin_external();
         glPushMatrix();
         glTranslatef(50, 50, 0);
         glScalef(5, -5, 5);
         glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
         get_font(24)->Render(val.c_str(), val.size(), FTPoint(),
                              FTPoint());
+        Render::flush(Render::FLUSH_EXTERNAL);
         glPopMatrix();
+        Render::end_external();
+    }
+#endif
+
+#ifdef CHOWDREN_BENCHMARK
+    if (Benchmark::enabled && !Benchmark::recording) {
+        // nothing is presented, so wait for the GPU to get comparable times
+        glFinish();
+        return;
     }
 #endif
 
@@ -393,6 +442,9 @@ void GameManager::set_frame(int index)
     std::cout << "Setting frame: " << index << std::endl;
 
     frame->set_index(index);
+    if (index != prefetch_frame)
+        frame->prefetch_images(index);
+    prefetch_frame = -1;
 
     std::cout << "Frame set" << std::endl;
 }
@@ -520,6 +572,8 @@ void GameManager::map_axis(int axis,
 
 bool GameManager::update()
 {
+    TRACE_ZONE("frame");
+
 #ifdef SHOW_STATS
     bool show_stats = false;
     static int measure_time = 0;
@@ -536,6 +590,20 @@ bool GameManager::update()
 
     platform_poll_events();
 
+#ifdef CHOWDREN_BENCHMARK
+    if (Benchmark::enabled && !Benchmark::recording)
+        Benchmark::replay_input(*this);
+#endif
+
+#ifdef CHOWDREN_USE_TRACE
+    if (keyboard.is_pressed_once(CHOWDREN_TRACE_KEY)) {
+        if (Trace::enabled)
+            Trace::stop();
+        else
+            Trace::start();
+    }
+#endif
+
     // player controls
     int new_control = get_player_control_flags(1);
     player_press_flags = new_control & ~(player_flags);
@@ -621,7 +689,14 @@ bool GameManager::update()
     } else {
         double event_update_time = platform_get_time();
 
+        BENCHMARK_BEGIN(UPDATE);
         int ret = update_frame();
+        BENCHMARK_END(UPDATE);
+
+#ifdef CHOWDREN_AUTOSAVE_ON_CHANGE
+        // the changes of a frame are saved together
+        INI::flush_saves();
+#endif
 
 #ifdef SHOW_STATS
         if (show_stats)
@@ -638,9 +713,22 @@ bool GameManager::update()
             return false;
     }
 
+    media.update_voices();
+
     double draw_time = platform_get_time();
 
+    PROFILE_BEGIN(update_image_loader);
+    update_image_loader();
+    PROFILE_END();
+#ifdef CHOWDREN_BENCHMARK
+    if (Benchmark::draw) {
+        BENCHMARK_BEGIN(DRAW);
+        draw();
+        BENCHMARK_END(DRAW);
+    }
+#else
     draw();
+#endif
 
 #ifdef SHOW_STATS
     if (show_stats) {
@@ -653,7 +741,12 @@ bool GameManager::update()
     }
 #endif
 
+#ifdef CHOWDREN_BENCHMARK
+    if (!Benchmark::finish_frame(*this))
+        fps_limit.finish();
+#else
     fps_limit.finish();
+#endif
 
 #ifdef CHOWDREN_USE_PROFILER
     static int profile_time = 0;
@@ -685,10 +778,23 @@ void GameManager::run()
     while (true) {
         if (!update())
             break;
+#ifdef CHOWDREN_BENCHMARK
+        if (Benchmark::is_done())
+            break;
+#endif
     }
+#ifdef CHOWDREN_BENCHMARK
+    Benchmark::write_results();
+#endif
     frame->data->on_app_end();
     frame->data->on_end();
+#ifdef CHOWDREN_AUTOSAVE_ON_CHANGE
+    INI::flush_saves(true);
+#endif
     media.stop();
+#ifdef CHOWDREN_USE_TRACE
+    Trace::stop();
+#endif
     platform_exit();
 #endif
 }
@@ -1011,6 +1117,9 @@ int main(int argc, char *argv[])
     setvbuf(stdin, NULL, _IONBF, 0);
 
     std::ios::sync_with_stdio();
+#endif
+#ifdef CHOWDREN_BENCHMARK
+    Benchmark::parse_args(argc, argv);
 #endif
     manager.run();
     return 0;
@@ -31,6 +31,8 @@ void convert_vec4(int val, float & a, float & b, float & c, float & d)
                            set_blend_eqs(a, b);
 #define SET_BLEND_FUNC(a, b) has_blend_func = true;\
                              set_blend_func(a, b);
+#define SET_BLEND_FUNCS(a, b, c, d) has_blend_func = true;\
+                                   set_blend_funcs(a, b, c, d);
 
 static bool has_blend_eq = false;
 static bool has_blend_func = false;
@@ -90,6 +92,15 @@ void shader_set_effect(int effect, FrameObject * obj,
         case Render::FONT:
             font_shader.begin(NULL, 0, 0);
             break;
+        case Render::PREMULTIPLY:
+            texture_shader.begin(NULL, 0, 0);
+            SET_BLEND_FUNCS(FUNC_SRC_ALPHA, FUNC_ONE_MINUS_SRC_ALPHA,
+                            FUNC_ONE, FUNC_ONE_MINUS_SRC_ALPHA);
+            break;
+        case Render::PREMULTIPLIED:
+            texture_shader.begin(NULL, 0, 0);
+            SET_BLEND_FUNC(FUNC_ONE, FUNC_ONE_MINUS_SRC_ALPHA);
+            break;
         HANDLE_SHADER(PERSPECTIVE, perspective_shader);
         HANDLE_SHADER(MONOCHROME, monochrome_shader);
         HANDLE_SHADER(ZOOMOFFSET, zoomoffset_shader);
@@ -0,0 +1,212 @@
+#include "trace.h"
+
+#ifdef CHOWDREN_USE_TRACE
+
+#include <SDL_timer.h>
+#include <SDL_mutex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include "fileio.h"
+#include "types.h"
+
+#ifdef _MSC_VER
+#define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACE_THREAD_LOCAL __thread
+#endif
+
+#define TRACE_MAX_DEPTH 64
+#define TRACE_MAX_THREADS 32
+#define TRACE_DEFAULT_FILENAME "trace.json"
+
+struct TraceEvent
+{
+    const char * name;
+    uint64_t start;
+    uint64_t end;
+};
+
+// only written by its own thread. the events wrap around, so a trace
+// holds the last CHOWDREN_TRACE_EVENTS zones of each thread. allocated by
+// TRACE_THREAD, so nothing is allocated while recording, and threads that
+// never call it are not traced
+struct TraceBuffer
+{
+    int tid;
+    const char * thread_name;
+    // count is reset by its own thread, when the generation is behind
+    // trace_generation
+    volatile unsigned int generation;
+    volatile unsigned int count;
+    TraceEvent events[CHOWDREN_TRACE_EVENTS];
+
+    // open zones
+    int depth;
+    const char * names[TRACE_MAX_DEPTH];
+    uint64_t starts[TRACE_MAX_DEPTH];
+};
+
+bool Trace::enabled = false;
+
+static SDL_mutex * trace_mutex = NULL;
+static TraceBuffer * trace_buffers[TRACE_MAX_THREADS];
+static int trace_buffer_count = 0;
+// bumped by Trace::start
+static volatile unsigned int trace_generation = 0;
+static uint64_t trace_start = 0;
+static double trace_scale = 0.0;
+static const char * trace_filename = TRACE_DEFAULT_FILENAME;
+static TRACE_THREAD_LOCAL TraceBuffer * thread_buffer = NULL;
+
+static TraceBuffer * create_buffer()
+{
+    if (trace_mutex == NULL)
+        return NULL;
+    SDL_LockMutex(trace_mutex);
+    TraceBuffer * buffer = NULL;
+    if (trace_buffer_count < TRACE_MAX_THREADS) {
+        buffer = new TraceBuffer;
+        buffer->tid = trace_buffer_count + 1;
+        buffer->thread_name = NULL;
+        buffer->generation = trace_generation;
+        buffer->count = 0;
+        buffer->depth = 0;
+        trace_buffers[trace_buffer_count++] = buffer;
+    }
+    SDL_UnlockMutex(trace_mutex);
+    return buffer;
+}
+
+void Trace::init()
+{
+    trace_mutex = SDL_CreateMutex();
+    trace_start = SDL_GetPerformanceCounter();
+    trace_scale = 1000000.0 / double(SDL_GetPerformanceFrequency());
+    set_thread_name("Main");
+
+    const char * value = getenv("CHOWDREN_TRACE");
+    if (value == NULL || *value == '\0')
+        return;
+    if (strcmp(value, "1") != 0)
+        trace_filename = value;
+    start();
+}
+
+void Trace::set_thread_name(const char * name)
+{
+    if (thread_buffer == NULL)
+        thread_buffer = create_buffer();
+    if (thread_buffer == NULL)
+        return;
+    thread_buffer->thread_name = name;
+}
+
+void Trace::begin(const char * name)
+{
+    if (!enabled)
+        return;
+    TraceBuffer * buffer = thread_buffer;
+    if (buffer == NULL || buffer->depth >= TRACE_MAX_DEPTH)
+        return;
+    buffer->names[buffer->depth] = name;
+    buffer->starts[buffer->depth] = SDL_GetPerformanceCounter();
+    buffer->depth++;
+}
+
+void Trace::end()
+{
+    // zones opened before a stop are still closed, so the depth stays right
+    TraceBuffer * buffer = thread_buffer;
+    if (buffer == NULL || buffer->depth <= 0)
+        return;
+    buffer->depth--;
+    if (!enabled)
+        return;
+    unsigned int generation = trace_generation;
+    if (buffer->generation != generation) {
+        buffer->count = 0;
+        buffer->generation = generation;
+    }
+    unsigned int index = buffer->count & (CHOWDREN_TRACE_EVENTS - 1);
+    TraceEvent & event = buffer->events[index];
+    event.name = buffer->names[buffer->depth];
+    event.start = buffer->starts[buffer->depth];
+    event.end = SDL_GetPerformanceCounter();
+    buffer->count++;
+}
+
+void Trace::start()
+{
+    if (trace_mutex == NULL)
+        return;
+    // each thread drops its old events on its next zone
+    trace_generation++;
+    std::cout << "Trace started" << std::endl;
+    enabled = true;
+}
+
+void Trace::stop()
+{
+    if (!enabled)
+        return;
+    enabled = false;
+    write(trace_filename);
+}
+
+static void write_string(FSFile & fp, const char * value)
+{
+    fp.write(value, strlen(value));
+}
+
+void Trace::write(const char * filename)
+{
+    FSFile fp(filename, "w");
+    if (!fp.is_open()) {
+        std::cout << "Could not write trace " << filename << std::endl;
+        return;
+    }
+
+    SDL_LockMutex(trace_mutex);
+    char line[256];
+    bool first = true;
+    write_string(fp, "{\"traceEvents\":[\n");
+    for (int i = 0; i < trace_buffer_count; i++) {
+        TraceBuffer * buffer = trace_buffers[i];
+        if (buffer->thread_name != NULL) {
+            snprintf(line, sizeof(line),
+                     "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                     "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                     first ? "" : ",\n", buffer->tid, buffer->thread_name);
+            write_string(fp, line);
+            first = false;
+        }
+
+        // threads without zones since the start still hold the old events
+        unsigned int count = 0;
+        if (buffer->generation == trace_generation)
+            count = buffer->count;
+        unsigned int start = 0;
+        if (count > CHOWDREN_TRACE_EVENTS)
+            start = count - CHOWDREN_TRACE_EVENTS;
+        for (unsigned int n = start; n < count; n++) {
+            TraceEvent & event = buffer->events[n & (CHOWDREN_TRACE_EVENTS-1)];
+            double ts = double(event.start - trace_start) * trace_scale;
+            double dur = double(event.end - event.start) * trace_scale;
+            snprintf(line, sizeof(line),
+                     "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                     "\"ts\":%.3f,\"dur\":%.3f}",
+                     first ? "" : ",\n", event.name, buffer->tid, ts, dur);
+            write_string(fp, line);
+            first = false;
+        }
+    }
+    SDL_UnlockMutex(trace_mutex);
+
+    write_string(fp, "\n]}\n");
+    fp.close();
+    std::cout << "Wrote trace " << filename << std::endl;
+}
+
+#endif // CHOWDREN_USE_TRACE
@@ -0,0 +1,79 @@
+#ifndef CHOWDREN_TRACE_H
+#define CHOWDREN_TRACE_H
+
+#include "chowconfig.h"
+
+// Frame tracer. Zones are recorded into a fixed size ring buffer per thread
+// and written as Chrome trace JSON, for chrome://tracing or Perfetto. The
+// buffer of a thread is allocated by TRACE_THREAD, so only threads that
+// call it are traced.
+// Recording is toggled with CHOWDREN_TRACE_KEY, and the trace is written
+// when it stops. Setting the CHOWDREN_TRACE environment variable records
+// from startup, and a value other than "1" is used as the output filename.
+// Only available on desktop, since it uses SDL for timing and locking.
+
+#if defined(CHOWDREN_USE_TRACE) && (!defined(CHOWDREN_IS_DESKTOP) || \
+                                    defined(CHOWDREN_IS_EMSCRIPTEN))
+#undef CHOWDREN_USE_TRACE
+#endif
+
+#ifdef CHOWDREN_USE_TRACE
+
+// events per thread, must be a power of two
+#ifndef CHOWDREN_TRACE_EVENTS
+#define CHOWDREN_TRACE_EVENTS (1 << 16)
+#endif
+
+#ifndef CHOWDREN_TRACE_KEY
+#define CHOWDREN_TRACE_KEY SDLK_F11
+#endif
+
+namespace Trace
+{
+    extern bool enabled;
+
+    void init();
+    void set_thread_name(const char * name);
+    // names are not copied, so they have to be string literals
+    void begin(const char * name);
+    void end();
+    void start();
+    void stop();
+    void write(const char * filename);
+}
+
+struct TraceZone
+{
+    bool active;
+
+    TraceZone(const char * name)
+    : active(Trace::enabled)
+    {
+        if (active)
+            Trace::begin(name);
+    }
+
+    ~TraceZone()
+    {
+        if (active)
+            Trace::end();
+    }
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(trace_zone_, __LINE__)(name)
+#define TRACE_BEGIN(name) Trace::begin(name)
+#define TRACE_END() Trace::end()
+#define TRACE_THREAD(name) Trace::set_thread_name(name)
+
+#else
+
+#define TRACE_ZONE(name)
+#define TRACE_BEGIN(name)
+#define TRACE_END()
+#define TRACE_THREAD(name)
+
+#endif
+
+#endif // CHOWDREN_TRACE_H
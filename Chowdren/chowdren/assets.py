@@ -7,11 +7,17 @@ SOUND_COUNT offsets for each sound
 FONT_COUNT offsets for each font
 SHADER_COUNT offsets for each shader
 FILE_COUNT offsets for each internal file
+ATLAS_COUNT offsets for each atlas page
 
 Images:
     X, Y hotspot (short)
     X, Y action point (short)
-    PNG image
+    (with CHOWDREN_USE_ATLAS) atlas page (short), -1 if not packed
+    if packed:
+        X, Y, width, height in page (short)
+        U1, V1, U2, V2 in page (float)
+    else:
+        PNG image
 
 Sounds:
     uint32 type
@@ -27,6 +33,10 @@ Shaders:
 Files:
     uint32 size
     data
+
+Atlas pages:
+    uint32 size
+    PNG image
 """
 
 NONE_TYPE, WAV_TYPE, OGG_TYPE, NATIVE_TYPE = xrange(4)
@@ -51,6 +61,7 @@ def get_asset_name(typ, name, index=None):
 class Assets(object):
     def __init__(self, converter, skip=False):
         self.skip = skip
+        self.use_atlas = False
         if skip:
             return
 
@@ -65,6 +76,7 @@ class Assets(object):
         self.fonts = []
         self.shaders = []
         self.files = []
+        self.atlases = []
         self.shader_names = set()
 
         self.sound_ids = {}
@@ -78,7 +90,8 @@ class Assets(object):
         header = ByteReader()
         data = ByteReader()
         header_size = ((len(self.images) + len(self.sounds) + len(self.fonts) +
-                       len(self.shaders) + len(self.files)) * 4
+                       len(self.shaders) + len(self.files) +
+                       len(self.atlases)) * 4
                       + len(self.images) * 2)
 
         # image preload
@@ -106,6 +119,10 @@ class Assets(object):
             header.writeInt(data.tell() + header_size, True)
             data.write(packfile)
 
+        for atlas in self.atlases:
+            header.writeInt(data.tell() + header_size, True)
+            data.write(atlas)
+
         self.fp.write(str(header))
         self.fp.write(str(data))
 
@@ -114,9 +131,10 @@ class Assets(object):
         self.font_count = len(self.fonts)
         self.shader_count = len(self.shaders)
         self.file_count = len(self.files)
+        self.atlas_count = len(self.atlases)
 
         self.sounds = self.images = self.fonts = self.shaders = None
-        self.files = None
+        self.files = self.atlases = None
 
     def write_cache(self, cache):
         cache['sound_ids'] = self.sound_ids
@@ -149,6 +167,7 @@ class Assets(object):
         self.header.putdefine('FONT_COUNT', self.font_count)
         self.header.putdefine('SHADER_COUNT', self.shader_count)
         self.header.putdefine('FILE_COUNT', self.file_count)
+        self.header.putdefine('ATLAS_COUNT', self.atlas_count)
         self.header.close_guard('CHOWDREN_ASSETS_H')
         self.header.close()
 
@@ -206,11 +225,32 @@ class Assets(object):
     def get_sound_id(self, name):
         return self.sound_ids.get(name.lower(), 'INVALID_ASSET_ID')
 
-    def add_image(self, hot_x, hot_y, act_x, act_y, data):
+    def add_atlas(self, data):
+        index = len(self.atlases)
+        self.atlases.append(get_sized_data(data))
+        return index
+
+    def add_image(self, hot_x, hot_y, act_x, act_y, data, atlas=None):
         writer = ByteReader()
         writer.writeShort(hot_x)
         writer.writeShort(hot_y)
         writer.writeShort(act_x)
         writer.writeShort(act_y)
+        if self.use_atlas:
+            if atlas is None:
+                writer.writeShort(-1)
+            else:
+                page, x, y, w, h, page_w, page_h = atlas
+                writer.writeShort(page)
+                writer.writeShort(x)
+                writer.writeShort(y)
+                writer.writeShort(w)
+                writer.writeShort(h)
+                writer.writeFloat(x / float(page_w))
+                writer.writeFloat(y / float(page_h))
+                writer.writeFloat((x + w) / float(page_w))
+                writer.writeFloat((y + h) / float(page_h))
+                self.images.append(str(writer))
+                return
         writer.writeIntString(data)
         self.images.append(str(writer))
@@ -55,6 +55,11 @@ PROFILE_DRAW = PROFILE and False
 PROFILE_EVENTS = PROFILE and False
 PROFILE_OBJECTS = PROFILE and False
 
+# texture atlas settings
+ATLAS_SIZE = 1024
+ATLAS_MAX_IMAGE = 256
+ATLAS_PADDING = 1
+
 # enabled for porting
 NATIVE_EXTENSIONS = True
 
@@ -536,6 +541,7 @@ class EventFileWriter(MultiFileWriter):
         self.putln('#include "media.h"')
         self.putln('#include "objects.h"')
         self.putln('#include "bitarray.h"')
+        self.putln('#include "jobs.h"')
 
 class FrameDataWriter(MultiFileWriter):
     base_class = 'FrameData'
@@ -583,6 +589,23 @@ def fix_sound(data, extension):
     wav.close()
     return fp.getvalue()
 
+def extrude_image(image, pad):
+    # repeat the edges, so filtering does not bleed in neighbouring images
+    w, h = image.size
+    new_image = Image.new('RGBA', (w + pad * 2, h + pad * 2))
+    new_image.paste(image, (pad, pad))
+    top = image.crop((0, 0, w, 1))
+    bottom = image.crop((0, h - 1, w, h))
+    for i in xrange(pad):
+        new_image.paste(top, (pad, i))
+        new_image.paste(bottom, (pad, h + pad + i))
+    left = new_image.crop((pad, 0, pad + 1, h + pad * 2))
+    right = new_image.crop((w + pad - 1, 0, w + pad, h + pad * 2))
+    for i in xrange(pad):
+        new_image.paste(left, (i, 0))
+        new_image.paste(right, (w + pad + i, 0))
+    return new_image
+
 class Converter(object):
     debug = False
 
@@ -729,6 +752,9 @@ class Converter(object):
                 cPickle.dump(cache, fp, protocol=2)
             del cache
 
+        if self.config.use_texture_atlas():
+            self.add_define('CHOWDREN_USE_ATLAS')
+
         objects_header = self.open_code('objects.h')
         objects_header.start_guard('CHOWDREN_OBJECTS_H')
         objects_header.putln('#include "common.h"')
@@ -808,6 +834,7 @@ class Converter(object):
                                  lists_file, lists_header)
 
         # write object updates
+        parallel_update = self.config.use_parallel_update()
         update_calls = defaultdict(list)
         updated_objs = set()
         updaters = {}
@@ -843,6 +870,33 @@ class Converter(object):
 
             updaters[key] = func_name
 
+            # integrate pass on the job threads, see Active::integrate
+            is_parallel = (parallel_update and has_updates and
+                           writer.parallel_update)
+            if is_parallel:
+                integrate_name = func_name.replace('update_', 'integrate_', 1)
+                event_file.putlnc('static void %s(void * data, int start, '
+                                  'int end)', integrate_name)
+                event_file.start_brace()
+                event_file.putln('ObjectList & list = *(ObjectList*)data;')
+                event_file.putln('for (int i = start; i < end; i++) {')
+                event_file.indent()
+                event_file.putln('FrameObject * instance = list[i];')
+                event_file.putln('if (instance->flags & DESTROYING)')
+                event_file.indent()
+                event_file.putln('continue;')
+                event_file.dedent()
+                if has_sleep:
+                    event_file.putln('instance->update_inactive();')
+                    event_file.putln('if (instance->flags & INACTIVE)')
+                    event_file.indent()
+                    event_file.putln('continue;')
+                    event_file.dedent()
+                event_file.putlnc('((%s*)instance)->integrate();',
+                                  writer.class_name)
+                event_file.end_brace()
+                event_file.end_brace()
+
             event_file.putlnc('static void %s(ObjectList ** lists, int count)',
                               func_name)
             event_file.start_brace()
@@ -850,6 +904,10 @@ class Converter(object):
             event_file.putlnc('for (int i = 0; i < count; i++) {')
             event_file.indent()
             event_file.putln('ObjectList & list = *lists[i];')
+            if is_parallel:
+                event_file.putlnc('Jobs::parallel_for(list.size(), '
+                                  'CHOWDREN_UPDATE_BATCH, %s, &list);',
+                                  integrate_name)
             event_file.putlnc('for (it = list.begin(); '
                               'it != list.end(); ++it) {')
             event_file.indent()
@@ -859,7 +917,8 @@ class Converter(object):
             event_file.putln('continue;')
             event_file.dedent()
             if has_sleep:
-                event_file.putln('instance->update_inactive();')
+                if not is_parallel:
+                    event_file.putln('instance->update_inactive();')
                 event_file.putln('if (instance->flags & INACTIVE)')
                 event_file.indent()
                 event_file.putln('continue;')
@@ -914,6 +973,23 @@ class Converter(object):
         event_file.putln('data->frame = this;')
         event_file.end_brace()
 
+        if self.config.use_async_images():
+            event_file.putmeth('void prefetch_images', 'int index')
+            event_file.putln('switch (index) {')
+            event_file.indent()
+            for frame_index in self.processed_frames:
+                images = self.frame_images.get(frame_index - 1, ())
+                if not images:
+                    continue
+                event_file.putlnc('case %s:', frame_index - 1)
+                event_file.indent()
+                for image in sorted(images):
+                    event_file.putlnc('prefetch_image(%s);', image)
+                event_file.putln('break;')
+                event_file.dedent()
+            event_file.end_brace()
+            event_file.end_brace()
+
         if not self.assets.skip:
             handles = []
             for handle, frames in sorted(self.image_frames.iteritems(),
@@ -1019,12 +1095,29 @@ class Converter(object):
             config_file.putdefine('CHOWDREN_VSYNC')
         if PROFILE:
             config_file.putdefine('CHOWDREN_USE_PROFILER')
+        if self.config.use_trace():
+            config_file.putdefine('CHOWDREN_USE_TRACE')
+        if self.config.use_benchmark():
+            config_file.putdefine('CHOWDREN_BENCHMARK')
+        if self.config.use_layer_cache():
+            config_file.putdefine('CHOWDREN_LAYER_CACHE')
+        if self.config.use_parallel_update():
+            config_file.putdefine('CHOWDREN_PARALLEL_UPDATE')
+        channel_priorities = self.config.get_channel_priorities()
+        if channel_priorities:
+            value = ', '.join('{%s, %s}' % (channel - 1, priority)
+                              for (channel, priority)
+                              in sorted(channel_priorities.items()))
+            config_file.putln('#define CHOWDREN_CHANNEL_PRIORITIES %s'
+                              % value)
 
         # write all options/extension defines
         if self.config.use_iteration_index():
             config_file.putdefine('CHOWDREN_ITER_INDEX')
         if self.config.use_image_preload():
             config_file.putdefine('CHOWDREN_PRELOAD_IMAGES')
+        if self.config.use_async_images():
+            config_file.putdefine('CHOWDREN_ASYNC_IMAGES')
         if self.config.use_deferred_collisions():
             config_file.putdefine('CHOWDREN_DEFER_COLLISIONS')
 
@@ -1083,6 +1176,75 @@ class Converter(object):
         print 'EXPRESSIONS'
         print default_writers['expressions'].checked.most_common()
 
+    def get_atlas_groups(self, image_count):
+        # group images by the first frame that uses them, so a frame only
+        # needs a handful of atlas pages
+        groups = []
+        seen = set()
+        for game_index, game in enumerate(self.games):
+            for frame in game.frames:
+                group = []
+                for instance in getattr(frame.instances, 'items', ()):
+                    frameitem = instance.getObjectInfo(game.frameItems)
+                    common = frameitem.properties.loader
+                    handles = []
+                    image = getattr(common, 'image', None)
+                    if image is not None:
+                        handles.append(image)
+                    animations = getattr(common, 'animations', None)
+                    if animations is not None:
+                        loaded = animations.loadedAnimations
+                        for animation in loaded.itervalues():
+                            directions = animation.loadedDirections
+                            for direction in directions.itervalues():
+                                handles.extend(direction.frames)
+                    counters = getattr(common, 'counters', None)
+                    if counters is not None:
+                        handles.extend(getattr(counters, 'frames', ()))
+                    for handle in handles:
+                        index = self.image_indexes.get((handle, game_index))
+                        if index is None or index in seen:
+                            continue
+                        seen.add(index)
+                        group.append(index)
+                if group:
+                    groups.append(group)
+        rest = [index for index in xrange(image_count)
+                if index not in seen]
+        if rest:
+            groups.append(rest)
+        return groups
+
+    def create_atlases(self, images):
+        self.assets.use_atlas = True
+        entries = {}
+        for group in self.get_atlas_groups(len(images)):
+            padded = []
+            padded_indexes = {}
+            for index in group:
+                image = images[index]
+                w, h = image.size
+                if w > ATLAS_MAX_IMAGE or h > ATLAS_MAX_IMAGE:
+                    continue
+                new_image = extrude_image(image, ATLAS_PADDING)
+                padded_indexes[id(new_image)] = index
+                padded.append(new_image)
+            if not padded:
+                continue
+            for page in texpack.pack_images(padded, ATLAS_SIZE, ATLAS_SIZE):
+                page_index = self.assets.add_atlas(
+                    self.platform.get_image(page.get()))
+                for sprite in page.results:
+                    index = padded_indexes[id(sprite.image)]
+                    pad = ATLAS_PADDING
+                    entries[index] = (page_index,
+                                      sprite.x + pad, sprite.y + pad,
+                                      sprite.w - pad * 2, sprite.h - pad * 2,
+                                      ATLAS_SIZE, ATLAS_SIZE)
+        print 'Packed %s images into %s atlas pages' % (
+            len(entries), len(self.assets.atlases))
+        return entries
+
     def add_define(self, name, value=None):
         self.defines.add((name, value))
 
@@ -1129,10 +1291,10 @@ class Converter(object):
                 image_index += 1
 
         # use maxrects to create texture maps
-        # makedirs('./testmaxrects')
-        # maxrects = texpack.pack_images(maxrects_images, 1024, 1024)
-        # for file_index, rects in enumerate(maxrects):
-        #     rects.get().save('./testmaxrects/atlas%s.png' % file_index)
+        if self.config.use_texture_atlas():
+            atlas_entries = self.create_atlases(maxrects_images)
+        else:
+            atlas_entries = {}
 
         for i, (image, image_hash) in enumerate(new_entries):
             # image_hash = image_hash.encode('hex')
@@ -1144,9 +1306,13 @@ class Converter(object):
             # else:
             #     temp = self.platform.get_image(maxrects_images[i])
             #     open(cache_path, 'wb').write(temp)
-            temp = self.platform.get_image(maxrects_images[i])
+            atlas = atlas_entries.get(i, None)
+            if atlas is None:
+                temp = self.platform.get_image(maxrects_images[i])
+            else:
+                temp = None
             arg = (image.xHotspot, image.yHotspot,
-                   image.actionX, image.actionY, temp)
+                   image.actionX, image.actionY, temp, atlas)
             self.assets.add_image(*arg)
 
         self.image_count = image_index
@@ -1688,7 +1854,8 @@ class Converter(object):
 
         call_groups = first_groups + call_groups + last_groups
 
-        if PROFILE_GROUPS:
+        profile_groups = PROFILE_GROUPS or self.config.use_trace()
+        if profile_groups:
             prof_ids = defaultdict(int)
 
         for group in call_groups:
@@ -1697,7 +1864,7 @@ class Converter(object):
                 if container.is_static:
                     continue
                 if group.mark == 'NewGroup':
-                    if PROFILE_GROUPS:
+                    if profile_groups:
                         prof = get_method_name(container.name)
                         prof_ids[prof] += 1
                         prof = '%s_%s' % (prof, prof_ids[prof])
@@ -1712,7 +1879,7 @@ class Converter(object):
                     event_file.put_label(container.end_label)
                     self.container_tree.remove(container)
 
-                    if PROFILE_GROUPS:
+                    if profile_groups:
                         event_file.putlnc('PROFILE_END();')
                 continue
             event_file.putlnc('%s();', group.event_name)
@@ -2519,12 +2686,31 @@ class Converter(object):
                         write_conditions = conditions[start_index:
                                                       condition_index+1]
 
-                        selected_name = self.create_list(obj, writer)
+                        # OPTIMIZATION: filter simple conditions through a
+                        # selection bitset, see SelectionIterator
+                        iter_type = self.get_iter_type(obj)
+                        is_dense = (self.config.use_dense_selection() and
+                                    iter_type == 'ObjectIterator' and
+                                    all(item.dense_select
+                                        for item in write_conditions) and
+                                    not self.references_object(
+                                        write_conditions, obj))
+                        is_fresh = is_dense and self.is_cleared_list(obj)
+                        selected_name = self.create_list(obj, writer,
+                                                         not is_fresh)
                         has_multiple = True
                         self.set_iterator(obj, selected_name)
-                        iter_type = self.get_iter_type(obj)
-                        writer.putlnc('for (%s it(%s); !it.end(); '
-                                      '++it) {', iter_type, selected_name)
+                        if is_fresh:
+                            writer.putlnc('for (SelectionIterator it(%s, '
+                                          'true); !it.end(); ++it) {',
+                                          selected_name)
+                        elif is_dense:
+                            writer.putlnc('for (SelectionIterator it(%s); '
+                                          '!it.end(); ++it) {',
+                                          selected_name)
+                        else:
+                            writer.putlnc('for (%s it(%s); !it.end(); '
+                                          '++it) {', iter_type, selected_name)
                         writer.indent()
                         object_name = '(*it)'
 
@@ -2966,7 +3152,35 @@ class Converter(object):
             return True
         return False
 
-    def create_list(self, object_info, writer):
+    def references_object(self, conditions, object_info):
+        # true if a parameter reads the selection of object_info. this
+        # resolves to the current selection, which SelectionIterator only
+        # writes once the iteration ends
+        handles = set(item[0] for item in self.resolve_qualifier(object_info))
+        for condition in conditions:
+            for parameter in condition.parameters:
+                loader = parameter.loader
+                if getattr(loader, 'isExpression', False):
+                    items = [item for item in loader.items[:-1]
+                             if item.hasObjectInfo()]
+                elif hasattr(loader, 'objectInfo'):
+                    items = [loader]
+                else:
+                    continue
+                for item in items:
+                    obj = (item.objectInfo, item.objectType)
+                    for other in self.resolve_qualifier(obj):
+                        if other[0] in handles:
+                            return True
+        return False
+
+    def is_cleared_list(self, object_info):
+        # true if create_list() starts from a cleared selection
+        return (self.get_single(object_info) is None and
+                object_info not in self.has_selection and
+                not self.has_common_objects(object_info, self.has_selection))
+
+    def create_list(self, object_info, writer, clear=True):
         single = self.get_single(object_info)
         if single is not None:
             return single
@@ -2991,8 +3205,11 @@ class Converter(object):
 
         if has_col:
             writer.putln('// icache destruction')
-        else:
+        elif clear:
             clear_lists = (list_name,)
+        else:
+            # the caller clears the selection itself
+            clear_lists = ()
 
         for obj_list in clear_lists:
             writer.putlnc('%s.clear_selection();', obj_list)
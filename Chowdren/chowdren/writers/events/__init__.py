@@ -57,6 +57,9 @@ class ConditionWriter(ACBase):
     in_place = False
     pre_event = None
     post_event = None
+    # only reads the instance, so it may be filtered with a
+    # SelectionIterator
+    dense_select = False
 
     def write(self, writer):
         raise NotImplementedError()
@@ -216,9 +219,16 @@ def make_static_expression(v):
         method = v
     return NewExpression
 
-def make_comparison(v):
+def make_comparison(v, dense=False):
     class NewCondition(ComparisonWriter):
         value = v
+        dense_select = dense
+    return NewCondition
+
+def make_dense_method(v):
+    class NewCondition(ConditionMethodWriter):
+        method = v
+        dense_select = True
     return NewCondition
 
 def make_table(method_writer, table):
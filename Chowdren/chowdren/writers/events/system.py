@@ -2,7 +2,8 @@ from mmfparser.data.chunkloaders.objectinfo import SEMITRANSPARENT_EFFECT
 from chowdren.writers.events import (ActionWriter, ConditionWriter,
     ExpressionWriter, ComparisonWriter, ActionMethodWriter,
     ConditionMethodWriter, ExpressionMethodWriter, make_table,
-    make_expression, make_comparison, EmptyAction, FalseCondition)
+    make_expression, make_comparison, make_dense_method, EmptyAction,
+    FalseCondition)
 from chowdren.common import (get_method_name, to_c, make_color,
                              parse_direction, get_flag_direction,
                              TEMPORARY_GROUP_ID, is_qualifier)
@@ -516,6 +517,8 @@ class OnBackgroundCollision(CollisionCondition):
         writer.put('%s()' % func_name)
 
 class ObjectInvisible(ConditionWriter):
+    dense_select = True
+
     def write(self, writer):
         writer.put('flags & VISIBLE')
 
@@ -2092,19 +2095,21 @@ actions = make_table(ActionMethodWriter, {
 })
 
 conditions = make_table(ConditionMethodWriter, {
-    'CompareAlterableValue' : make_comparison('alterables->values.get(%s)'),
-    'CompareAlterableString' : make_comparison('alterables->strings.get(%s)'),
+    'CompareAlterableValue' : make_comparison('alterables->values.get(%s)',
+                                              True),
+    'CompareAlterableString' : make_comparison('alterables->strings.get(%s)',
+                                               True),
     'CompareGlobalValue' : make_comparison('global_values->get(%s)'),
     'CompareGlobalValueIntEqual' : make_comparison('global_values->get(%s)'),
     'CompareGlobalValueIntNotEqual' : make_comparison('global_values->get(%s)'),
     'CompareGlobalString' : make_comparison('global_strings->get(%s)'),
     'CompareCounter' : make_comparison('value'),
-    'CompareX' : make_comparison('get_x()'),
-    'CompareY' : make_comparison('get_y()'),
+    'CompareX' : make_comparison('get_x()', True),
+    'CompareY' : make_comparison('get_y()', True),
     'Compare' : make_comparison('%s'),
     'IsOverlapping' : IsOverlapping,
     'OnCollision' : OnCollision,
-    'ObjectVisible' : '.flags & VISIBLE',
+    'ObjectVisible' : make_dense_method('.flags & VISIBLE'),
     'ObjectInvisible' : ObjectInvisible,
     'WhileMousePressed' : 'is_mouse_pressed',
     'MouseOnObject' : MouseOnObject,
@@ -2150,8 +2155,8 @@ conditions = make_table(ConditionMethodWriter, {
     'PathFinished' : PathFinished,
     'NodeReached' : NodeReached,
     'CompareSpeed' : make_comparison('get_movement()->get_speed()'),
-    'FlagOn' : 'alterables->flags.is_on',
-    'FlagOff' : 'alterables->flags.is_off',
+    'FlagOn' : make_dense_method('alterables->flags.is_on'),
+    'FlagOff' : make_dense_method('alterables->flags.is_off'),
     'NearWindowBorder' : 'is_near_border',
     'AnimationFinished' : AnimationFinished,
     'StartOfFrame' : '.loop_count <= 1',
@@ -13,6 +13,8 @@ class ObjectWriter(BaseWriter):
     use_alterables = False
     has_color = False
     update = False
+    # update() is split into a thread-safe integrate() and the serial rest
+    parallel_update = False
     movement_count = 0
     default_instance = None
     has_collision_events = False
@@ -52,6 +52,7 @@ class Active(ObjectWriter):
     class_name = 'Active'
     use_alterables = True
     update = True
+    parallel_update = True
     default_instance = 'default_active_instance'
     filename = 'active'
     destruct = False
@@ -68,6 +68,32 @@ def use_image_flush(converter, frame):
 def use_image_preload(converter):
     return False
 
+def use_texture_atlas(converter):
+    return False
+
+def use_async_images(converter):
+    return False
+
+def use_trace(converter):
+    return False
+
+def use_benchmark(converter):
+    return False
+
+def use_layer_cache(converter):
+    return False
+
+def use_parallel_update(converter):
+    return False
+
+def use_dense_selection(converter):
+    return False
+
+def get_channel_priorities(converter):
+    # channel number -> voice priority. the default priorities are 0-7, see
+    # Media::play
+    return {}
+
 def add_defines(converter):
     pass
 